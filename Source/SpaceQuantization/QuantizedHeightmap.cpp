@@ -0,0 +1,171 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "QuantizedHeightmap.h"
+
+void FQuantizedHeightmap::Init(FIntVector2 InDimensions, int32 InResolution, EQuantizerGridLayout InLayout)
+{
+	Dimensions = InDimensions;
+	Resolution = InResolution;
+
+	Layout = InLayout;
+	BlockShift = Layout == EQuantizerGridLayout::Blocked ? BlockedShift : 0;
+	NumBlocks = FIntVector2(
+		FMath::DivideAndRoundUp(FMath::Max(Dimensions.X, 0), 1 << BlockShift),
+		FMath::DivideAndRoundUp(FMath::Max(Dimensions.Y, 0), 1 << BlockShift));
+
+	const int32 NumCells = Num();
+
+	Heights.SetNumZeroed(NumCells);
+	ValidCells.Init(false, NumCells);
+
+	CompactHeights.Empty();
+	bCompact = false;
+}
+
+
+void FQuantizedHeightmap::Reset()
+{
+	Dimensions = FIntVector2(0, 0);
+	Origin = FIntVector2(0, 0);
+	NumBlocks = FIntVector2(0, 0);
+
+	Heights.Empty();
+	ValidCells.Empty();
+
+	CompactHeights.Empty();
+	bCompact = false;
+}
+
+
+void FQuantizedHeightmap::Compact()
+{
+	if (bCompact)
+	{
+		return;
+	}
+
+	float MinHeight = MAX_flt;
+	float MaxHeight = -MAX_flt;
+
+	for (TConstSetBitIterator<> It(ValidCells); It; ++It)
+	{
+		MinHeight = FMath::Min(MinHeight, Heights[It.GetIndex()]);
+		MaxHeight = FMath::Max(MaxHeight, Heights[It.GetIndex()]);
+	}
+
+	//No valid cells, any range will do
+	if (MinHeight > MaxHeight)
+	{
+		MinHeight = MaxHeight = 0.f;
+	}
+
+	//Every code below the sentinel is a height, so the range is split into InvalidCompactHeight - 1 steps
+	CompactHeightOffset = MinHeight;
+	CompactHeightScale = FMath::Max(FMath::Abs(MaxHeight - MinHeight), UE_KINDA_SMALL_NUMBER) / (InvalidCompactHeight - 1);
+
+	CompactHeights.SetNumUninitialized(Num());
+
+	for (int32 Index = 0; Index < CompactHeights.Num(); Index++)
+	{
+		CompactHeights[Index] = ValidCells[Index] ? EncodeHeight(Heights[Index]) : InvalidCompactHeight;
+	}
+
+	Heights.Empty();
+	ValidCells.Empty();
+
+	bCompact = true;
+}
+
+
+void FQuantizedHeightmap::Expand()
+{
+	if (!bCompact)
+	{
+		return;
+	}
+
+	Heights.SetNumUninitialized(Num());
+	ValidCells.Init(false, Num());
+
+	for (int32 Index = 0; Index < CompactHeights.Num(); Index++)
+	{
+		const bool bValid = CompactHeights[Index] != InvalidCompactHeight;
+
+		Heights[Index] = bValid ? CompactHeightOffset + (float)CompactHeights[Index] * CompactHeightScale : 0.f;
+		ValidCells[Index] = bValid;
+	}
+
+	CompactHeights.Empty();
+
+	bCompact = false;
+}
+
+
+void FQuantizedHeightmap::SetLayout(EQuantizerGridLayout NewLayout)
+{
+	if (NewLayout == Layout)
+	{
+		return;
+	}
+
+	FQuantizedHeightmap Reordered;
+	Reordered.Init(Dimensions, Resolution, NewLayout);
+	Reordered.Origin = Origin;
+
+	if (bCompact)
+	{
+		Reordered.Heights.Empty();
+		Reordered.ValidCells.Empty();
+		Reordered.CompactHeights.Init(InvalidCompactHeight, Reordered.Num());
+		Reordered.CompactHeightOffset = CompactHeightOffset;
+		Reordered.CompactHeightScale = CompactHeightScale;
+		Reordered.bCompact = true;
+	}
+
+	for (int32 y = 0; y < Dimensions.Y; y++)
+	{
+		for (int32 x = 0; x < Dimensions.X; x++)
+		{
+			const int32 From = GetIndex(x, y);
+			const int32 To = Reordered.GetIndex(x, y);
+
+			if (bCompact)
+			{
+				Reordered.CompactHeights[To] = CompactHeights[From];
+			}
+			else
+			{
+				Reordered.Heights[To] = Heights[From];
+				Reordered.ValidCells[To] = ValidCells[From];
+			}
+		}
+	}
+
+	*this = MoveTemp(Reordered);
+}
+
+
+int32 FQuantizedHeightmap::SetValidCells(const TArray<uint8>& CellFlags)
+{
+	check(CellFlags.Num() == Num() && !bCompact);
+
+	int32 NumValid = 0;
+
+	for (int32 Index = 0; Index < CellFlags.Num(); Index++)
+	{
+		if (CellFlags[Index])
+		{
+			ValidCells[Index] = true;
+			NumValid++;
+		}
+	}
+
+	return NumValid;
+}
+
+
+SIZE_T FQuantizedHeightmap::GetAllocatedSize() const
+{
+	return Heights.GetAllocatedSize() + ValidCells.GetAllocatedSize() + CompactHeights.GetAllocatedSize();
+}
@@ -0,0 +1,252 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "QuantizedHeightmap.generated.h"
+
+/// <summary>
+/// Order the cells of a grid are stored in
+/// </summary>
+UENUM(BlueprintType)
+enum class EQuantizerGridLayout : uint8
+{
+	//Row after row, y * Dimensions.X + x
+	Linear,
+	//Rows of 8 x 8 cell blocks, every block contiguous so cells above and below are mostly in the same cache lines
+	Blocked
+};
+
+/// <summary>
+/// Dense grid of sampled terrain heights. Cells are stored contiguously, in the order of Layout, and every index
+/// goes through GetIndex and GetCell. Cells whose trace missed the terrain are cleared in ValidCells. Once sampled the
+/// grid can be compacted to 16 bit heights, which replace both Heights and ValidCells
+/// </summary>
+struct SPACEQUANTIZATION_API FQuantizedHeightmap
+{
+	//Compact height of cells whose trace missed the terrain
+	static constexpr uint16 InvalidCompactHeight = MAX_uint16;
+
+	//Blocks of the Blocked layout are 1 << BlockedShift cells wide
+	static constexpr int32 BlockedShift = 3;
+
+	//Number of cells in the X and Y axes
+	FIntVector2 Dimensions = FIntVector2(0, 0);
+
+	//How many units large each cell is
+	int32 Resolution = 1;
+
+	//Cell of the world grid that cell (0, 0) lies on, windows of a streamed heightmap start away from the world origin
+	FIntVector2 Origin = FIntVector2(0, 0);
+
+	EQuantizerGridLayout Layout = EQuantizerGridLayout::Linear;
+
+	//Blocks are 1 << BlockShift cells wide, a Linear grid is made of single cell blocks
+	int32 BlockShift = 0;
+
+	//Blocks in the X and Y axes, the last ones are padded with invalid cells
+	FIntVector2 NumBlocks = FIntVector2(0, 0);
+
+	//Height in Z axis of every cell
+	TArray<float> Heights;
+
+	//Set for every cell that has a sampled height
+	TBitArray<> ValidCells;
+
+	//Heights as steps of CompactHeightScale above CompactHeightOffset, or InvalidCompactHeight. Only used once compacted
+	TArray<uint16> CompactHeights;
+
+	float CompactHeightOffset = 0.f;
+	float CompactHeightScale = 1.f;
+
+	bool bCompact = false;
+
+	/// <summary>
+	/// Allocate storage for a grid of the passed size, every cell starts out invalid
+	/// </summary>
+	/// <param name="InDimensions"></param>
+	/// <param name="InResolution"></param>
+	/// <param name="InLayout"></param>
+	void Init(FIntVector2 InDimensions, int32 InResolution, EQuantizerGridLayout InLayout = EQuantizerGridLayout::Linear);
+
+	/// <summary>
+	/// Free all storage
+	/// </summary>
+	void Reset();
+
+	/// <summary>
+	/// Quantize every height to 16 bits and free the float heights and validity bits. The steps span the lowest to the
+	/// highest valid height, so no height is clamped whatever the source was
+	/// </summary>
+	void Compact();
+
+	/// <summary>
+	/// Decode compact heights back into float heights and validity bits
+	/// </summary>
+	void Expand();
+
+	/// <summary>
+	/// Move every cell to where NewLayout stores it. Indices taken before are no longer valid
+	/// </summary>
+	void SetLayout(EQuantizerGridLayout NewLayout);
+
+	FORCEINLINE bool IsCompact() const
+	{
+		return bCompact;
+	}
+
+	/// <summary>
+	/// Number of cells stored, the bound of every index. Includes the padding of partial blocks
+	/// </summary>
+	FORCEINLINE int32 Num() const
+	{
+		return (NumBlocks.X * NumBlocks.Y) << (BlockShift * 2);
+	}
+
+	FORCEINLINE bool IsEmpty() const
+	{
+		return Num() == 0;
+	}
+
+	/// <summary>
+	/// Whether the cell lies inside the grid
+	/// </summary>
+	FORCEINLINE bool IsInBounds(int32 X, int32 Y) const
+	{
+		return X >= 0 && Y >= 0 && X < Dimensions.X && Y < Dimensions.Y;
+	}
+
+	/// <summary>
+	/// Index of a cell in the height and validity arrays, cell must be in bounds. The same shifts and masks cover
+	/// every layout, they are all zero for Linear
+	/// </summary>
+	FORCEINLINE int32 GetIndex(int32 X, int32 Y) const
+	{
+		const int32 BlockMask = (1 << BlockShift) - 1;
+		const int32 Block = (Y >> BlockShift) * NumBlocks.X + (X >> BlockShift);
+
+		return (Block << (BlockShift * 2)) + ((Y & BlockMask) << BlockShift) + (X & BlockMask);
+	}
+
+	FORCEINLINE int32 GetIndex(FIntVector2 Cell) const
+	{
+		return GetIndex(Cell.X, Cell.Y);
+	}
+
+	/// <summary>
+	/// Cell coordinates of an index returned by GetIndex
+	/// </summary>
+	FORCEINLINE FIntVector2 GetCell(int32 Index) const
+	{
+		const int32 BlockMask = (1 << BlockShift) - 1;
+		const int32 Block = Index >> (BlockShift * 2);
+
+		const int32 BlockY = Block / NumBlocks.X;
+		const int32 BlockX = Block - BlockY * NumBlocks.X;
+
+		return FIntVector2((BlockX << BlockShift) + (Index & BlockMask), (BlockY << BlockShift) + ((Index >> BlockShift) & BlockMask));
+	}
+
+	/// <summary>
+	/// Whether the cell at Index has a sampled height
+	/// </summary>
+	FORCEINLINE bool IsValidIndex(int32 Index) const
+	{
+		return bCompact ? CompactHeights[Index] != InvalidCompactHeight : ValidCells[Index];
+	}
+
+	/// <summary>
+	/// Whether the cell is in bounds and has a sampled height
+	/// </summary>
+	FORCEINLINE bool IsCellValid(int32 X, int32 Y) const
+	{
+		return IsInBounds(X, Y) && IsValidIndex(GetIndex(X, Y));
+	}
+
+	/// <summary>
+	/// Height of a valid cell, one multiply-add to decode when compacted
+	/// </summary>
+	FORCEINLINE float GetHeight(int32 Index) const
+	{
+		return bCompact ? CompactHeightOffset + (float)CompactHeights[Index] * CompactHeightScale : Heights[Index];
+	}
+
+	/// <summary>
+	/// Store a sampled height and mark the cell valid
+	/// </summary>
+	FORCEINLINE void SetHeight(int32 Index, float Height)
+	{
+		if (bCompact)
+		{
+			CompactHeights[Index] = EncodeHeight(Height);
+			return;
+		}
+
+		Heights[Index] = Height;
+		ValidCells[Index] = true;
+	}
+
+	/// <summary>
+	/// Mark a cell as missed by its trace
+	/// </summary>
+	FORCEINLINE void ClearHeight(int32 Index)
+	{
+		if (bCompact)
+		{
+			CompactHeights[Index] = InvalidCompactHeight;
+			return;
+		}
+
+		ValidCells[Index] = false;
+	}
+
+	/// <summary>
+	/// Nearest compact height, never InvalidCompactHeight. Heights outside the compacted range are clamped, so grids
+	/// getting new heights are expanded first
+	/// </summary>
+	FORCEINLINE uint16 EncodeHeight(float Height) const
+	{
+		return (uint16)FMath::Clamp(FMath::RoundToInt((Height - CompactHeightOffset) / CompactHeightScale), 0, InvalidCompactHeight - 1);
+	}
+
+	/// <summary>
+	/// Mark every cell with a non-zero flag valid, used to fold in results written by several threads at once
+	/// </summary>
+	/// <param name="CellFlags">One entry per cell</param>
+	/// <returns>Number of valid cells</returns>
+	int32 SetValidCells(const TArray<uint8>& CellFlags);
+
+	/// <summary>
+	/// Cell that contains the passed world location, may be out of bounds
+	/// </summary>
+	FORCEINLINE FIntVector2 WorldToCell(const FVector& Location) const
+	{
+		return FIntVector2(FMath::FloorToInt(Location.X / Resolution) - Origin.X, FMath::FloorToInt(Location.Y / Resolution) - Origin.Y);
+	}
+
+	/// <summary>
+	/// World location of the grid point at the corner of a cell, at height 0
+	/// </summary>
+	FORCEINLINE FVector GetCellWorldLocation(int32 X, int32 Y) const
+	{
+		return FVector((double)(Origin.X + X) * Resolution, (double)(Origin.Y + Y) * Resolution, 0);
+	}
+
+	/// <summary>
+	/// World location of the grid point at the corner of a cell, Z is the sampled height
+	/// </summary>
+	FORCEINLINE FVector GetWorldLocation(int32 Index) const
+	{
+		const FIntVector2 Cell = GetCell(Index);
+		return FVector((double)(Origin.X + Cell.X) * Resolution, (double)(Origin.Y + Cell.Y) * Resolution, GetHeight(Index));
+	}
+
+	/// <summary>
+	/// Bytes used by the grid storage
+	/// </summary>
+	SIZE_T GetAllocatedSize() const;
+};
+
+//Heightmaps are never modified once built so searches on other threads can hold on to a snapshot
+typedef TSharedPtr<const FQuantizedHeightmap, ESPMode::ThreadSafe> FQuantizedHeightmapPtr;
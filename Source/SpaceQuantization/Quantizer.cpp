@@ -4,9 +4,21 @@
 #include "Quantizer.h"
 
 #include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/Pawn.h"
 #include "DrawDebugHelpers.h"
 #include "Components/SplineComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
 #include "Engine/StaticMesh.h"
+#include "Engine/Texture2D.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "LandscapeProxy.h"
+#include "LandscapeDataAccess.h"
+#include "QuantizerHeightmapImport.h"
+#include "QuantizerStats.h"
+#include "Misc/Paths.h"
 
 FGridMask::FGridMask()
 {
@@ -34,19 +46,155 @@ AQuantizer::AQuantizer()
 void AQuantizer::BeginPlay()
 {
 	Super::BeginPlay();
+
+	//Tiles are sampled as queries and players reach them
+	if (bStreamHeightmap)
+	{
+		InitHeightmapStreaming();
+		return;
+	}
 	
-	GenerateHeightmap();
+	//Landscapes are static between builds, only sample when there is no matching bake
+	if (!bUseBakedHeightmap || !LoadBakedHeightmap())
+	{
+		GenerateHeightmap();
+	}
 }
 
 
-void AQuantizer::GenerateHeightmap()
+bool AQuantizer::LoadBakedHeightmap()
 {
 	if (LandscapeActor == nullptr)
 	{
-		UE_LOG(LogTemp, Error, TEXT("LandscapeActor is null in AQuantizer::GenerateHeightmap"));
+		return false;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	FQuantizerBakedEdges BakedEdges;
+	TSharedPtr<FQuantizedHeightmap, ESPMode::ThreadSafe> BakedHeightmap = FQuantizerHeightmapBake::Load(GetBakedHeightmapFilename(), MakeBakeKey(), &BakedEdges);
+
+	if (!BakedHeightmap.IsValid())
+	{
+		return false;
+	}
+
+	FinishHeightmap(*BakedHeightmap);
+
+	FVector Extents, Origin;
+	LandscapeActor->GetActorBounds(true, Origin, Extents);
+
+	LandscapeDimensions.X = Extents.X * 2;
+	LandscapeDimensions.Y = Extents.Y * 2;
+
+	GridDimensions = BakedHeightmap->Dimensions;
+
+	CachedHeightmap = BakedHeightmap;
+	HeightmapVersion++;
+
+	SET_MEMORY_STAT(STAT_Quantizer_HeightmapMemory, CachedHeightmap->GetAllocatedSize());
+
+	//Baked edges were tested on the float heights, they are only rebuilt if the mask or slope limit changed since baking
+	if (BakedEdges.Edges.Num() > 0 && BakedEdges.MaskPoints == SampleMask.MaskPoints && BakedEdges.MaxAngleThreshold == MaxAngleThreshold)
+	{
+		CachedEdgeMask = FQuantizerEdgeMask::FromLinearEdges(CachedHeightmap, BakedEdges.MaskPoints, BakedEdges.MaxAngleThreshold, BakedEdges.Edges);
+	}
+
+	UpdateEdgeMask();
+
+	if (SearchMode == EQuantizerSearchMode::CoarseToFine)
+	{
+		UpdatePyramid();
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Loaded baked %i x %i heightmap in %.3f ms"), 
+		GridDimensions.X, GridDimensions.Y, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+
+	return true;
+}
+
+
+FString AQuantizer::GetBakedHeightmapFilename() const
+{
+	const FString MapName = GetWorld() ? UWorld::RemovePIEPrefix(GetWorld()->GetMapName()) : FString();
+
+	return FPaths::ProjectContentDir() / TEXT("QuantizerBakes") / FString::Printf(TEXT("%s_%s.qhm"), *MapName, *GetName());
+}
+
+
+FQuantizerBakeKey AQuantizer::MakeBakeKey() const
+{
+	FQuantizerBakeKey Key;
+
+	if (LandscapeActor)
+	{
+		//Path and placement of the landscape, so a moved or swapped landscape does not match
+		FVector Extents, Origin;
+		LandscapeActor->GetActorBounds(true, Origin, Extents);
+
+		Key.LandscapeId = GetTypeHash(UWorld::RemovePIEPrefix(LandscapeActor->GetPathName()));
+		Key.LandscapeId = HashCombine(Key.LandscapeId, GetTypeHash(FIntVector(Origin)));
+		Key.LandscapeId = HashCombine(Key.LandscapeId, GetTypeHash(FIntVector(Extents)));
+
+		if (const ALandscapeProxy* Landscape = Cast<ALandscapeProxy>(LandscapeActor))
+		{
+			Key.LandscapeId = HashCombine(Key.LandscapeId, GetTypeHash(Landscape->GetLandscapeGuid()));
+		}
+	}
+
+	Key.Resolution = Resolution;
+	Key.SampleMaxHeight = SampleMaxHeight;
+	Key.SampleMaxDepth = SampleMaxDepth;
+	Key.HeightSource = (uint32)HeightSource;
+
+	//Path, lighting GUID and imported size of the texture, so a swapped or reimported texture does not match. The GUID
+	//is renewed on every import and edit and survives cooking, unlike the source GUID which only editor builds have
+	if (HeightSource == EQuantizerHeightSource::HeightmapTexture && HeightmapTexture)
+	{
+		Key.HeightSourceId = GetTypeHash(HeightmapTexture->GetPathName());
+		Key.HeightSourceId = HashCombine(Key.HeightSourceId, GetTypeHash(HeightmapTexture->GetLightingGuid()));
+		Key.HeightSourceId = HashCombine(Key.HeightSourceId, GetTypeHash(HeightmapTexture->GetImportedSize()));
+	}
+
+	return Key;
+}
+
+
+#if WITH_EDITOR
+void AQuantizer::BakeHeightmap()
+{
+	GenerateHeightmap();
+
+	if (!CachedHeightmap.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Nothing to bake in AQuantizer::BakeHeightmap"));
 		return;
 	}
 
+	const FString Filename = GetBakedHeightmapFilename();
+
+	//GenerateHeightmap built the edge mask for the current settings, bake it too so loading does not test every edge again
+	const FQuantizerEdgeMask* EdgeMask = CachedEdgeMask.IsValid() && CachedEdgeMask->Matches(CachedHeightmap, SampleMask.MaskPoints, MaxAngleThreshold) ? CachedEdgeMask.Get() : nullptr;
+
+	if (FQuantizerHeightmapBake::Save(Filename, MakeBakeKey(), *CachedHeightmap, EdgeMask))
+	{
+		UE_LOG(LogTemp, Display, TEXT("Baked heightmap to %s"), *Filename);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Error, TEXT("Could not write baked heightmap to %s"), *Filename);
+	}
+}
+#endif
+
+
+bool AQuantizer::UpdateGridDimensions()
+{
+	if (LandscapeActor == nullptr)
+	{
+		return false;
+	}
+
 	FVector Extents, Origin;
 
 	//Get bounds of landscape to calculate size
@@ -56,344 +204,1379 @@ void AQuantizer::GenerateHeightmap()
 	LandscapeDimensions.X = Extents.X * 2;
 	LandscapeDimensions.Y = Extents.Y * 2;
 
-	//Get Dimensions in terms of grid points
-	GridDimensions.X = (int)LandscapeDimensions.X / Resolution;
-	GridDimensions.Y = (int)LandscapeDimensions.Y / Resolution;
+	//Get Dimensions in terms of grid points, one point every Resolution units including the one at 0
+	GridDimensions.X = FMath::DivideAndRoundUp((int)LandscapeDimensions.X, Resolution);
+	GridDimensions.Y = FMath::DivideAndRoundUp((int)LandscapeDimensions.Y, Resolution);
+
+	/*UE_LOG(LogTemp, Display, TEXT("Landscape Dimensions: (%f, %f) \nGrid Dimensions: (%i, %i)"), 
+		LandscapeDimensions.X, LandscapeDimensions.Y, GridDimensions.X, GridDimensions.Y);*/
+
+	return true;
+}
+
+
+void AQuantizer::GenerateHeightmap()
+{
+	QUANTIZER_SCOPE(GenerateHeightmap);
+
+	if (!UpdateGridDimensions())
+	{
+		UE_LOG(LogTemp, Error, TEXT("LandscapeActor is null in AQuantizer::GenerateHeightmap"));
+		return;
+	}
+
+	//A full rebuild reads HeightmapTexture again in case it was reimported
+	CachedHeightfieldTexture.Reset();
+
+	//Build into a new heightmap so queries still running on the old one are unaffected
+	TSharedRef<FQuantizedHeightmap, ESPMode::ThreadSafe> NewHeightmap = MakeShared<FQuantizedHeightmap, ESPMode::ThreadSafe>();
+
+	//Every cell starts out invalid until a trace hits it
+	NewHeightmap->Init(GridDimensions, Resolution);
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	SampleHeightmap(NewHeightmap.Get());
+
+	FinishHeightmap(NewHeightmap.Get());
+
+	UE_LOG(LogTemp, Display, TEXT("Heightmap built in %.3f ms"), (FPlatformTime::Seconds() - StartTime) * 1000.0);
+
+	UE_LOG(LogTemp, Display, TEXT("Generated %i x %i heightmap using %llu bytes"), 
+		GridDimensions.X, GridDimensions.Y, (uint64)NewHeightmap->GetAllocatedSize());
+
+	CachedHeightmap = NewHeightmap;
+	HeightmapVersion++;
+
+	SET_MEMORY_STAT(STAT_Quantizer_HeightmapMemory, CachedHeightmap->GetAllocatedSize());
+
+	UpdateEdgeMask();
+
+	//Coarse levels are built with the heightmap so the first coarse-to-fine query does not pay for them
+	if (SearchMode == EQuantizerSearchMode::CoarseToFine)
+	{
+		UpdatePyramid();
+	}
+}
+
+
+void AQuantizer::SampleHeightmap(FQuantizedHeightmap& Heightmap)
+{
+	bool bSampled = false;
+
+	switch (HeightSource)
+	{
+	case EQuantizerHeightSource::Landscape:
+		if (const ALandscapeProxy* Landscape = Cast<ALandscapeProxy>(LandscapeActor))
+		{
+			SampleLandscapeHeights(*Landscape, Heightmap);
+			bSampled = true;
+		}
+		else
+		{
+			UE_LOG(LogTemp, Warning, TEXT("LandscapeActor is not a landscape, falling back to raycasts in AQuantizer::SampleHeightmap"));
+		}
+		break;
+
+	case EQuantizerHeightSource::HeightmapTexture:
+		bSampled = ImportHeightmapTexture(Heightmap);
+
+		if (!bSampled)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Could not read HeightmapTexture, falling back to raycasts in AQuantizer::SampleHeightmap"));
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	//Trace every grid point
+	if (!bSampled)
+	{
+		SampleHeightmapTiles(Heightmap);
+	}
+}
+
+
+void AQuantizer::FinishHeightmap(FQuantizedHeightmap& Heightmap) const
+{
+	Heightmap.SetLayout(GridLayout);
+
+	if (bCompactHeights)
+	{
+		Heightmap.Compact();
+	}
+}
+
+
+void AQuantizer::InitHeightmapStreaming()
+{
+	if (!UpdateGridDimensions())
+	{
+		UE_LOG(LogTemp, Error, TEXT("LandscapeActor is null in AQuantizer::InitHeightmapStreaming"));
+		return;
+	}
+
+	CachedHeightfieldTexture.Reset();
+
+	//Tiles are sampled on the game thread, SampleHeightmapTiles spreads the traces of each one over the workers
+	HeightmapTiles.Init(GridDimensions, Resolution, StreamingTileSize, [this](FQuantizedHeightmap& Tile)
+	{
+		SampleHeightmap(Tile);
+	});
+
+	HeightmapTiles.SetMemoryBudget((SIZE_T)FMath::Max(StreamingMemoryBudgetMB, 1) * 1024 * 1024);
+
+	CachedHeightmap.Reset();
+	HeightmapVersion++;
+
+	SET_MEMORY_STAT(STAT_Quantizer_HeightmapMemory, 0);
+
+	UpdateEdgeMask();
+	IncrementalPlanner.Reset();
+
+	UE_LOG(LogTemp, Display, TEXT("Streaming %i x %i heightmap in %i cell tiles, at most %i tiles in memory"),
+		GridDimensions.X, GridDimensions.Y, HeightmapTiles.GetTileSize(), HeightmapTiles.GetMaxResidentTiles());
+}
+
+
+bool AQuantizer::UpdateStreamingWindow(const FBox2D& Region)
+{
+	if (!HeightmapTiles.IsInitialized())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Heightmap streaming is not initialized in AQuantizer::UpdateStreamingWindow"));
+		return false;
+	}
+
+	const int32 Margin = FMath::Max(StreamingWindowMargin, 0);
+
+	//World cells the query may search, Max is exclusive
+	FIntRect Cells(
+		FMath::FloorToInt(Region.Min.X / Resolution) - Margin, FMath::FloorToInt(Region.Min.Y / Resolution) - Margin,
+		FMath::FloorToInt(Region.Max.X / Resolution) + 1 + Margin, FMath::FloorToInt(Region.Max.Y / Resolution) + 1 + Margin);
+	Cells.Clip(FIntRect(0, 0, GridDimensions.X, GridDimensions.Y));
+
+	if (Cells.Area() <= 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Query is outside of the heightmap in AQuantizer::UpdateStreamingWindow"));
+		return false;
+	}
+
+	//Queries close to the last one reuse its window, along with its edge mask and cached paths
+	if (CachedHeightmap.IsValid())
+	{
+		const FIntRect Window(
+			CachedHeightmap->Origin.X, CachedHeightmap->Origin.Y,
+			CachedHeightmap->Origin.X + CachedHeightmap->Dimensions.X, CachedHeightmap->Origin.Y + CachedHeightmap->Dimensions.Y);
+
+		if (Window.Contains(Cells.Min) && Cells.Max.X <= Window.Max.X && Cells.Max.Y <= Window.Max.Y)
+		{
+			return true;
+		}
+	}
+
+	//Whole tiles, so the window does not have to move for every small step
+	const FIntRect TileRect = HeightmapTiles.GetTileRect(Cells);
+	const int32 TileSize = HeightmapTiles.GetTileSize();
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	TSharedPtr<FQuantizedHeightmap, ESPMode::ThreadSafe> Window = HeightmapTiles.MakeWindow(FIntRect(TileRect.Min * TileSize, TileRect.Max * TileSize));
+
+	if (!Window.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Query spans more tiles than StreamingMemoryBudgetMB holds in AQuantizer::UpdateStreamingWindow"));
+		return false;
+	}
+
+	//Tiles stay linear and float so windows can be copied out of them with memcpy, only the window searches run on is converted
+	FinishHeightmap(*Window);
+
+	CachedHeightmap = Window;
+	HeightmapVersion++;
+
+	SET_MEMORY_STAT(STAT_Quantizer_HeightmapMemory, CachedHeightmap->GetAllocatedSize());
+
+	UpdateEdgeMask();
+	IncrementalPlanner.Reset();
+
+	UE_LOG(LogTemp, Display, TEXT("Streamed %i x %i window at (%i, %i) in %.3f ms, %i tiles using %llu bytes in memory"),
+		Window->Dimensions.X, Window->Dimensions.Y, Window->Origin.X, Window->Origin.Y, (FPlatformTime::Seconds() - StartTime) * 1000.0,
+		HeightmapTiles.Num(), (uint64)HeightmapTiles.GetUsedBytes());
+
+	return true;
+}
+
+
+void AQuantizer::PrefetchHeightmapTiles()
+{
+	UWorld* World = GetWorld();
+
+	if (!World || !HeightmapTiles.IsInitialized() || StreamingTilesPerTick <= 0)
+	{
+		return;
+	}
+
+	int32 TilesLeft = StreamingTilesPerTick;
+
+	for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It && TilesLeft > 0; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		const APawn* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+
+		if (!Pawn)
+		{
+			continue;
+		}
+
+		const FVector Location = Pawn->GetActorLocation();
+
+		const FIntRect Cells(
+			FMath::FloorToInt((Location.X - StreamingPrefetchRadius) / Resolution), FMath::FloorToInt((Location.Y - StreamingPrefetchRadius) / Resolution),
+			FMath::FloorToInt((Location.X + StreamingPrefetchRadius) / Resolution) + 1, FMath::FloorToInt((Location.Y + StreamingPrefetchRadius) / Resolution) + 1);
+
+		TilesLeft -= HeightmapTiles.Request(HeightmapTiles.GetTileRect(Cells), TilesLeft);
+	}
+}
+
+
+bool AQuantizer::ImportHeightmapTexture(FQuantizedHeightmap& Heightmap)
+{
+	//Decoding the whole texture costs far more than resampling one tile of it
+	if (!CachedHeightfieldTexture.IsValid() || CachedHeightfieldTexture.Get() != HeightmapTexture)
+	{
+		CachedHeightfieldTexture.Reset();
+		CachedHeightfield = FQuantizerHeightfield();
+
+		if (!FQuantizerHeightmapImport::ReadTexture(HeightmapTexture, CachedHeightfield) || CachedHeightfield.Size.X < 2 || CachedHeightfield.Size.Y < 2)
+		{
+			return false;
+		}
+
+		CachedHeightfieldTexture = HeightmapTexture;
+	}
+
+	//Placement is worked out again every time since LandscapeActor may have moved
+	FQuantizerHeightfield& Heightfield = CachedHeightfield;
+
+	if (const ALandscapeProxy* Landscape = Cast<ALandscapeProxy>(LandscapeActor))
+	{
+		//Same layout as a landscape import: one texel per vertex starting at the actor, 32768 is height 0
+		const FVector Location = Landscape->GetActorLocation();
+		const FVector Scale = Landscape->GetActorScale3D();
+
+		Heightfield.WorldOrigin = FVector2D(Location.X, Location.Y);
+		Heightfield.TexelSpacing = FVector2D(Scale.X, Scale.Y);
+		Heightfield.HeightScale = LANDSCAPE_ZSCALE * Scale.Z;
+		Heightfield.HeightOffset = Location.Z - 32768.f * Heightfield.HeightScale;
+	}
+	else
+	{
+		//Stretch the texture over the bounds of whatever geometry LandscapeActor is
+		FVector Extents, Origin;
+		LandscapeActor->GetActorBounds(true, Origin, Extents);
+
+		Heightfield.WorldOrigin = FVector2D(Origin.X - Extents.X, Origin.Y - Extents.Y);
+		Heightfield.TexelSpacing = FVector2D(Extents.X * 2 / (Heightfield.Size.X - 1), Extents.Y * 2 / (Heightfield.Size.Y - 1));
+		Heightfield.HeightScale = Extents.Z * 2 / MAX_uint16;
+		Heightfield.HeightOffset = Origin.Z - Extents.Z;
+	}
+
+	const int32 NumFilled = FQuantizerHeightmapImport::Resample(Heightfield, Heightmap);
+
+	UE_LOG(LogTemp, Display, TEXT("Resampled %i x %i heightmap texture into %i cells"), Heightfield.Size.X, Heightfield.Size.Y, NumFilled);
+
+	return true;
+}
+
+
+void AQuantizer::SampleLandscapeHeights(const ALandscapeProxy& Landscape, FQuantizedHeightmap& Heightmap)
+{
+	//Rows share words of the validity bitset, so filled cells are recorded per cell and folded in afterwards
+	TArray<uint8> Filled;
+	Filled.SetNumZeroed(Heightmap.Num());
+
+	//Only reads the collision heightfield, the game thread is blocked here so nothing modifies it meanwhile
+	ParallelFor(Heightmap.Dimensions.Y, [&Landscape, &Heightmap, &Filled](int32 y)
+	{
+		for (int32 x = 0; x < Heightmap.Dimensions.X; x++)
+		{
+			//Reads the collision heightfield directly, no scene query
+			const TOptional<float> Height = Landscape.GetHeightAtLocation(Heightmap.GetCellWorldLocation(x, y));
+
+			if (Height.IsSet())
+			{
+				const int32 Index = Heightmap.GetIndex(x, y);
+
+				Heightmap.Heights[Index] = Height.GetValue();
+				Filled[Index] = 1;
+			}
+		}
+	}, bParallelHeightmapSampling ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread);
+
+	const int32 NumFilled = Heightmap.SetValidCells(Filled);
+
+	UE_LOG(LogTemp, Display, TEXT("Read %i of %i cells from landscape %s"), NumFilled, Heightmap.Num(), *Landscape.GetName());
+}
+
+
+void AQuantizer::SampleHeightmapTiles(FQuantizedHeightmap& Heightmap)
+{
+	UWorld* World = GetWorld();
+
+	if (!World)
+	{
+		UE_LOG(LogTemp, Error, TEXT("World is null in AQuantizer::SampleHeightmapTiles"));
+		return;
+	}
+
+	const FIntVector2 Dimensions = Heightmap.Dimensions;
+
+	//Split the grid into square tiles, each tile is traced by one task
+	const int32 TileSize = FMath::Max(1, SampleTileSize);
+	const int32 TilesX = FMath::DivideAndRoundUp(Dimensions.X, TileSize);
+	const int32 TilesY = FMath::DivideAndRoundUp(Dimensions.Y, TileSize);
+
+	//Neighboring tiles share words of the validity bitset, so hits are recorded per cell and folded in afterwards
+	TArray<uint8> Hits;
+	Hits.SetNumZeroed(Heightmap.Num());
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	//Scene queries only take a read lock, the game thread is blocked here so nothing writes to the scene meanwhile
+	ParallelFor(TilesX * TilesY, [this, World, &Heightmap, &Hits, Dimensions, TileSize, TilesX](int32 TileIndex)
+	{
+		const int32 MinX = (TileIndex % TilesX) * TileSize;
+		const int32 MinY = (TileIndex / TilesX) * TileSize;
+		const int32 MaxX = FMath::Min(MinX + TileSize, Dimensions.X);
+		const int32 MaxY = FMath::Min(MinY + TileSize, Dimensions.Y);
+
+		for (int32 y = MinY; y < MaxY; y++)
+		{
+			for (int32 x = MinX; x < MaxX; x++)
+			{
+				const int32 Index = Heightmap.GetIndex(x, y);
+
+				//Heights go straight into the grid, every cell is written by exactly one task
+				const FVector CellLocation = Heightmap.GetCellWorldLocation(x, y);
+
+				if (TraceTerrainHeight(*World, FIntVector((int)CellLocation.X, (int)CellLocation.Y, (int)SampleMaxHeight), Heightmap.Heights[Index]))
+				{
+					Hits[Index] = 1;
+				}
+			}
+		}
+	}, bParallelHeightmapSampling ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread);
+
+	const double ElapsedSeconds = FPlatformTime::Seconds() - StartTime;
+
+	for (int32 Index = 0; Index < Hits.Num(); Index++)
+	{
+		if (Hits[Index])
+		{
+			Heightmap.ValidCells[Index] = true;
+			continue;
+		}
+
+		const FIntVector2 Cell = Heightmap.GetCell(Index);
+		const FVector Start = Heightmap.GetCellWorldLocation(Cell.X, Cell.Y) + FVector(0, 0, SampleMaxHeight);
+
+		//Print if failed
+		UE_LOG(LogTemp, Warning, TEXT("Line trace missed terrain at (%i, %i)"), (int)Start.X, (int)Start.Y);
+
+		//Draw a red line where it failed
+		DrawDebugLine(World, Start, Start + (FVector::DownVector * (SampleMaxHeight + SampleMaxDepth)), FColor::Red, true);
+	}
+
+	SampleTracesPerSecond = ElapsedSeconds > 0 ? (float)(Heightmap.Num() / ElapsedSeconds) : 0.f;
+
+	UE_LOG(LogTemp, Display, TEXT("Traced %i cells in %i tiles in %.3f s (%.0f traces per second)"), 
+		Heightmap.Num(), TilesX * TilesY, ElapsedSeconds, SampleTracesPerSecond);
+}
+
+
+bool AQuantizer::TraceTerrainHeight(const UWorld& World, FIntVector StartLocation, float& OutHeight) const
+{
+	FVector Start = (FVector)StartLocation;
+	FVector End = (FVector)StartLocation + (FVector::DownVector * (SampleMaxHeight + SampleMaxDepth));
+
+	// Raycast down from location to terrain
+	FHitResult Hit;
+	bool bHitSuccessful = World.LineTraceSingleByChannel(
+		Hit, 
+		Start, 
+		End,
+		ECollisionChannel::ECC_Visibility);
+
+	if (bHitSuccessful)
+	{
+		OutHeight = Hit.Location.Z;
+	}
+
+	return bHitSuccessful;
+}
+
+
+bool AQuantizer::SampleTerrainHeight(FIntVector StartLocation, FQuantizedSpace& OutResult)
+{
+	UWorld* World = GetWorld();
+
+	if (!World)
+	{
+		UE_LOG(LogTemp, Error, TEXT("AQuantizer::SampleTerrainHeight - How the hell is World null?"))
+		return false;
+	}
+
+	// If we hit a surface, cache the location
+	if (!TraceTerrainHeight(*World, StartLocation, OutResult.Height))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Raycast starting at (%i, %i, %i) did not hit"), StartLocation.X, StartLocation.Y, StartLocation.Z);
+
+		//Draw a red line where it failed
+		DrawDebugLine(World, (FVector)StartLocation, (FVector)StartLocation + (FVector::DownVector * (SampleMaxHeight + SampleMaxDepth)), FColor::Red, true);
+
+		return false;
+	}
+
+	OutResult.Location = FIntVector2(StartLocation.X, StartLocation.Y);
+
+	//Draw line check
+	//DrawDebugLine(World, Start, FVector(Start.X, Start.Y, OutResult.Height), FColor::Green, true);
+
+	return true;
+}
+
+
+void AQuantizer::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	//Workers hold their own references to the queries, just tell them to stop
+	CancelAllPaths();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+
+// Called every frame
+void AQuantizer::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (bStreamHeightmap)
+	{
+		PrefetchHeightmapTiles();
+	}
+
+	StepTimeSlicedPath();
+}
+
+
+FQuantizedSpace AQuantizer::Quantize(FVector Location)
+{
+	FQuantizedSpace Result = FQuantizedSpace();
+
+	//Rounds location to the location of the grid point at the corner of this cell
+	const int32 Index = QuantizeToIndex(Location);
+
+	if (Index == INDEX_NONE)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("AQuantizer::Quantize - (%f, %f) is not on a sampled grid point"), Location.X, Location.Y);
+		return Result;
+	}
+	
+	//UE_LOG(LogTemp, Display, TEXT("Coord: (%f, %f)"), Location.X, Location.Y);
+
+	//Get and return result
+	const FVector GridPoint = CachedHeightmap->GetWorldLocation(Index);
+
+	Result.Location = FIntVector2((int32)GridPoint.X, (int32)GridPoint.Y);
+	Result.Height = GridPoint.Z;
+
+	//UE_LOG(LogTemp, Display, TEXT("Quantized Source: (%i, %i)"), Result.Location.X, Result.Location.Y);
+
+	return Result;
+}
+
+
+int32 AQuantizer::QuantizeToIndex(const FVector& Location) const
+{
+	if (!CachedHeightmap.IsValid())
+	{
+		return INDEX_NONE;
+	}
+
+	const FIntVector2 Cell = CachedHeightmap->WorldToCell(Location);
+
+	if (!IsGridPointValid(Cell))
+	{
+		return INDEX_NONE;
+	}
+
+	return CachedHeightmap->GetIndex(Cell);
+}
+
+
+bool AQuantizer::ComputePath(FVector _Source, FVector _Destination)
+{
+	QUANTIZER_SCOPE(ComputePath);
+
+	if (bStreamHeightmap && !UpdateStreamingWindow(FBox2D(ForceInit) + FVector2D(_Source) + FVector2D(_Destination)))
+	{
+		return false;
+	}
+
+	//Quantize positions in terms of grid points
+	SourceIndex = QuantizeToIndex(_Source);
+	DestinationIndex = QuantizeToIndex(_Destination);
+
+	if (SourceIndex == INDEX_NONE || DestinationIndex == INDEX_NONE)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Source or destination is outside of the heightmap in AQuantizer::ComputePath"));
+		return false;
+	}
+
+	QuantizedSource = Quantize(_Source);
+	QuantizedDestination = Quantize(_Destination);
+
+	//UE_LOG(LogTemp, Display, TEXT("Source: (%f, %f)"), Source.X, Source.Y);
+	//UE_LOG(LogTemp, Display, TEXT("Quantized Source: (%i, %i)"), QuantizedSource.Location.X, QuantizedSource.Location.Y);
+
+	TArray<int32> Cells;
+
+	const FQuantizerPathCacheKey CacheKey = MakePathCacheKey(SourceIndex, DestinationIndex, SearchMode);
+
+	bool bFound = FindCachedPath(CacheKey, Cells);
+
+	if (!bFound)
+	{
+		if (SearchMode == EQuantizerSearchMode::Incremental)
+		{
+			//Repairs the previous search rather than starting over
+			bFound = IncrementalPlanner.FindPath(CachedHeightmap, MakeSearchParams(), SourceIndex, DestinationIndex, Cells);
+		}
+		else
+		{
+			Pathfinder.Init(CachedHeightmap, MakeSearchParams());
+			bFound = Pathfinder.FindPath(SourceIndex, DestinationIndex, Cells);
+		}
+
+		if (bFound)
+		{
+			AddCachedPath(CacheKey, HeightmapVersion, Cells);
+		}
+	}
+
+	if (!bFound)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("No path between source and destination in AQuantizer::ComputePath"));
+		return false;
+	}
+
+	//The previous path and its visualization stay until a new one is found, as with async queries
+	Source = _Source;
+	Destination = _Destination;
+
+	BuildWorldPath(*CachedHeightmap, Cells, Source, Destination, MakeSmoothingParams(), Path);
+
+	//Delete previous visualization
+	SplineComp->ClearSplinePoints();
+
+	DrawPath();
+
+	return true;
+}
+
+
+FQuantizerPathHandle AQuantizer::ComputePathAsync(FVector _Source, FVector _Destination)
+{
+	//Without worker threads the search is spread over frames instead
+	if (!FPlatformProcess::SupportsMultithreading())
+	{
+		return ComputePathTimeSliced(_Source, _Destination);
+	}
+
+	FQuantizerPathHandle Handle;
+
+	if (bStreamHeightmap && !UpdateStreamingWindow(FBox2D(ForceInit) + FVector2D(_Source) + FVector2D(_Destination)))
+	{
+		return Handle;
+	}
+
+	//Quantizing is only index math so it is cheap enough to do up front on the game thread
+	const int32 QuerySourceIndex = QuantizeToIndex(_Source);
+	const int32 QueryDestinationIndex = QuantizeToIndex(_Destination);
+
+	if (QuerySourceIndex == INDEX_NONE || QueryDestinationIndex == INDEX_NONE)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Source or destination is outside of the heightmap in AQuantizer::ComputePathAsync"));
+		return Handle;
+	}
+
+	//Only the newest query matters when the player keeps moving the markers
+	if (bSupersedePendingPaths)
+	{
+		CancelAllPaths();
+	}
+
+	TSharedRef<FQuantizerAsyncPathQuery, ESPMode::ThreadSafe> Query = MakeShared<FQuantizerAsyncPathQuery, ESPMode::ThreadSafe>();
+	Query->Id = NextPathQueryId++;
+	Query->Source = _Source;
+	Query->Destination = _Destination;
+	Query->CacheKey = MakePathCacheKey(QuerySourceIndex, QueryDestinationIndex, SearchMode);
+	Query->HeightmapVersion = HeightmapVersion;
+
+	PendingPathQueries.Add(Query->Id, Query);
+
+	Handle.Id = Query->Id;
+
+	TArray<int32> CachedCells;
+
+	if (FindCachedPath(Query->CacheKey, CachedCells))
+	{
+		Query->bSuccess = true;
+		BuildWorldPath(*CachedHeightmap, CachedCells, Query->Source, Query->Destination, MakeSmoothingParams(), Query->Path);
+
+		FinishCachedPath(Query);
+
+		return Handle;
+	}
+
+	//Worker only sees copies and the immutable heightmap snapshot
+	TWeakObjectPtr<AQuantizer> WeakThis(this);
+	FQuantizedHeightmapPtr Snapshot = CachedHeightmap;
+	FQuantizerSearchParams Params = MakeSearchParams();
+	FQuantizerSmoothingParams Smoothing = MakeSmoothingParams();
+
+	Async(EAsyncExecution::ThreadPool, [WeakThis, Query, Snapshot, Params, Smoothing, QuerySourceIndex, QueryDestinationIndex]()
+	{
+		FQuantizerPathfinder WorkerPathfinder;
+		WorkerPathfinder.Init(Snapshot, Params);
+
+		Query->bSuccess = WorkerPathfinder.FindPath(QuerySourceIndex, QueryDestinationIndex, Query->Cells, &Query->bCancelled);
+
+		if (Query->bSuccess)
+		{
+			BuildWorldPath(*Snapshot, Query->Cells, Query->Source, Query->Destination, Smoothing, Query->Path);
+		}
+
+		//Hand the result back to the game thread
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Query]()
+		{
+			if (AQuantizer* Quantizer = WeakThis.Get())
+			{
+				Quantizer->FinishAsyncPath(Query);
+			}
+		});
+	});
+
+	return Handle;
+}
+
+
+FQuantizerPathHandle AQuantizer::ComputePathTimeSliced(FVector _Source, FVector _Destination)
+{
+	FQuantizerPathHandle Handle;
+
+	if (bStreamHeightmap && !UpdateStreamingWindow(FBox2D(ForceInit) + FVector2D(_Source) + FVector2D(_Destination)))
+	{
+		return Handle;
+	}
+
+	const int32 QuerySourceIndex = QuantizeToIndex(_Source);
+	const int32 QueryDestinationIndex = QuantizeToIndex(_Destination);
+
+	if (QuerySourceIndex == INDEX_NONE || QueryDestinationIndex == INDEX_NONE)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Source or destination is outside of the heightmap in AQuantizer::ComputePathTimeSliced"));
+		return Handle;
+	}
+
+	if (bSupersedePendingPaths)
+	{
+		CancelAllPaths();
+	}
+
+	//There is one workspace, so the previous time sliced query is always superseded
+	if (TimeSlicedQuery.IsValid())
+	{
+		FQuantizerPathHandle Previous;
+		Previous.Id = TimeSlicedQuery->Id;
+
+		CancelPath(Previous);
+		TimeSlicedQuery.Reset();
+	}
+
+	TSharedRef<FQuantizerAsyncPathQuery, ESPMode::ThreadSafe> Query = MakeShared<FQuantizerAsyncPathQuery, ESPMode::ThreadSafe>();
+	Query->Id = NextPathQueryId++;
+	Query->Source = _Source;
+	Query->Destination = _Destination;
+	//Only A* can be resumed, so only A* paths are looked up and stored whatever SearchMode is
+	Query->CacheKey = MakePathCacheKey(QuerySourceIndex, QueryDestinationIndex, EQuantizerSearchMode::AStar);
+	Query->HeightmapVersion = HeightmapVersion;
+
+	TArray<int32> CachedCells;
+
+	if (FindCachedPath(Query->CacheKey, CachedCells))
+	{
+		Query->bSuccess = true;
+		BuildWorldPath(*CachedHeightmap, CachedCells, Query->Source, Query->Destination, MakeSmoothingParams(), Query->Path);
+
+		PendingPathQueries.Add(Query->Id, Query);
+		FinishCachedPath(Query);
+
+		Handle.Id = Query->Id;
+
+		return Handle;
+	}
+
+	//Only A* can be resumed, the search mode is ignored
+	TimeSlicedPathfinder.Init(CachedHeightmap, MakeSearchParams());
+
+	if (!TimeSlicedPathfinder.BeginSearch(QuerySourceIndex, QueryDestinationIndex))
+	{
+		return Handle;
+	}
+
+	PendingPathQueries.Add(Query->Id, Query);
+	TimeSlicedQuery = Query;
+
+	Handle.Id = Query->Id;
+
+	return Handle;
+}
+
+
+bool AQuantizer::IsTimeSlicedPathPending() const
+{
+	return TimeSlicedQuery.IsValid() && !TimeSlicedQuery->bCancelled;
+}
+
+
+float AQuantizer::GetTimeSlicedPathProgress() const
+{
+	return TimeSlicedQuery.IsValid() ? TimeSlicedPathfinder.GetSearchProgress() : 0.f;
+}
+
+
+bool AQuantizer::GetTimeSlicedPartialPath(TArray<FVector>& OutPath) const
+{
+	OutPath.Reset();
+
+	if (!TimeSlicedQuery.IsValid())
+	{
+		return false;
+	}
+
+	TArray<int32> Cells;
+	TimeSlicedPathfinder.GetSearchPath(Cells);
+
+	const FQuantizedHeightmap& Heightmap = TimeSlicedPathfinder.GetHeightmap();
+
+	OutPath.Reserve(Cells.Num() + 1);
+
+	for (int32 Cell : Cells)
+	{
+		OutPath.Add(Heightmap.GetWorldLocation(Cell));
+	}
+
+	OutPath.Add(TimeSlicedQuery->Source);
+
+	return true;
+}
+
+
+void AQuantizer::StepTimeSlicedPath()
+{
+	if (!TimeSlicedQuery.IsValid())
+	{
+		return;
+	}
+
+	//Cancelled queries were already removed from the pending queries
+	if (TimeSlicedQuery->bCancelled)
+	{
+		TimeSlicedQuery.Reset();
+		return;
+	}
+
+	const int32 MaxNodes = TimeSliceNodeBudget > 0 ? TimeSliceNodeBudget : MAX_int32;
+	const double MaxSeconds = FMath::Max(TimeSliceBudgetMicroseconds, 1) * 1e-6;
+
+	const EQuantizerSearchStatus Status = TimeSlicedPathfinder.StepSearch(MaxNodes, MaxSeconds, &TimeSlicedQuery->bCancelled);
+
+	if (Status == EQuantizerSearchStatus::InProgress)
+	{
+		return;
+	}
+
+	TSharedRef<FQuantizerAsyncPathQuery, ESPMode::ThreadSafe> Query = TimeSlicedQuery.ToSharedRef();
+	TimeSlicedQuery.Reset();
+
+	TimeSlicedPathfinder.PublishStats();
+
+	Query->bSuccess = Status == EQuantizerSearchStatus::Succeeded;
+
+	if (Query->bSuccess)
+	{
+		TimeSlicedPathfinder.GetSearchPath(Query->Cells);
+
+		BuildWorldPath(TimeSlicedPathfinder.GetHeightmap(), Query->Cells, Query->Source, Query->Destination, MakeSmoothingParams(), Query->Path);
+	}
+
+	FinishAsyncPath(Query);
+}
+
+
+TArray<FPathResult> AQuantizer::ComputePaths(const TArray<FPathRequest>& Requests)
+{
+	QUANTIZER_SCOPE(ComputePaths);
+
+	TArray<FPathResult> Results;
+	Results.SetNum(Requests.Num());
+
+	//One window covers the whole batch so every worker shares it
+	if (bStreamHeightmap && Requests.Num() > 0)
+	{
+		FBox2D Region(ForceInit);
+
+		for (const FPathRequest& Request : Requests)
+		{
+			Region += FVector2D(Request.Source);
+			Region += FVector2D(Request.Destination);
+		}
+
+		if (!UpdateStreamingWindow(Region))
+		{
+			return Results;
+		}
+	}
+
+	if (!CachedHeightmap.IsValid() || Requests.Num() == 0)
+	{
+		return Results;
+	}
+
+	//One worker per thread, including the game thread that waits on the batch
+	const int32 NumWorkers = FMath::Min(Requests.Num(), FTaskGraphInterface::Get().GetNumWorkerThreads() + 1);
+
+	const FQuantizerSearchParams Params = MakeSearchParams();
+	const FQuantizerSmoothingParams Smoothing = MakeSmoothingParams();
+
+	//The path cache is not thread safe, every request is looked up before the batch and stored after it
+	TArray<FQuantizerPathCacheKey> CacheKeys;
+	CacheKeys.SetNum(Requests.Num());
+
+	TArray<TArray<int32>> RequestCells;
+	RequestCells.SetNum(Requests.Num());
+
+	TBitArray<> bCached(false, Requests.Num());
+
+	for (int32 RequestIndex = 0; RequestIndex < Requests.Num(); RequestIndex++)
+	{
+		const FPathRequest& Request = Requests[RequestIndex];
+
+		CacheKeys[RequestIndex] = MakePathCacheKey(QuantizeToIndex(Request.Source), QuantizeToIndex(Request.Destination), SearchMode);
+
+		const FQuantizerPathCacheKey& Key = CacheKeys[RequestIndex];
+
+		if (Key.SourceIndex != INDEX_NONE && Key.DestinationIndex != INDEX_NONE && FindCachedPath(Key, RequestCells[RequestIndex]))
+		{
+			Results[RequestIndex].bSuccess = true;
+			BuildWorldPath(*CachedHeightmap, RequestCells[RequestIndex], Request.Source, Request.Destination, Smoothing, Results[RequestIndex].Path);
+
+			bCached[RequestIndex] = true;
+		}
+	}
+
+	if (BatchPathfinders.Num() < NumWorkers)
+	{
+		BatchPathfinders.SetNum(NumWorkers);
+	}
+
+	for (int32 WorkerIndex = 0; WorkerIndex < NumWorkers; WorkerIndex++)
+	{
+		BatchPathfinders[WorkerIndex].Init(CachedHeightmap, Params);
+	}
+
+	//Workers pull the next request as they finish, long and short queries balance out
+	std::atomic<int32> NextRequest { 0 };
+
+	ParallelFor(NumWorkers, [this, &Requests, &Results, &NextRequest, &CacheKeys, &RequestCells, &bCached, &Params, &Smoothing](int32 WorkerIndex)
+	{
+		FQuantizerPathfinder& WorkerPathfinder = BatchPathfinders[WorkerIndex];
+
+		for (int32 RequestIndex = NextRequest++; RequestIndex < Requests.Num(); RequestIndex = NextRequest++)
+		{
+			const FPathRequest& Request = Requests[RequestIndex];
+			FPathResult& Result = Results[RequestIndex];
+
+			const int32 RequestSourceIndex = CacheKeys[RequestIndex].SourceIndex;
+			const int32 RequestDestinationIndex = CacheKeys[RequestIndex].DestinationIndex;
+
+			if (bCached[RequestIndex] || RequestSourceIndex == INDEX_NONE || RequestDestinationIndex == INDEX_NONE)
+			{
+				continue;
+			}
+
+			TArray<int32>& Cells = RequestCells[RequestIndex];
+
+			WorkerPathfinder.SetSearchMode(Request.bBidirectional ? EQuantizerSearchMode::Bidirectional : Params.SearchMode);
+
+			Result.bSuccess = WorkerPathfinder.FindPath(RequestSourceIndex, RequestDestinationIndex, Cells);
+			Result.NodesExpanded = WorkerPathfinder.GetNodesExpanded();
+
+			if (Result.bSuccess)
+			{
+				BuildWorldPath(WorkerPathfinder.GetHeightmap(), Cells, Request.Source, Request.Destination, Smoothing, Result.Path);
+			}
+		}
+	});
+
+	for (int32 RequestIndex = 0; RequestIndex < Requests.Num(); RequestIndex++)
+	{
+		if (!bCached[RequestIndex] && Results[RequestIndex].bSuccess)
+		{
+			AddCachedPath(CacheKeys[RequestIndex], HeightmapVersion, RequestCells[RequestIndex]);
+		}
+	}
+
+	return Results;
+}
+
+
+void AQuantizer::CancelPath(FQuantizerPathHandle Handle)
+{
+	if (const TSharedRef<FQuantizerAsyncPathQuery, ESPMode::ThreadSafe>* Query = PendingPathQueries.Find(Handle.Id))
+	{
+		(*Query)->bCancelled = true;
+
+		PendingPathQueries.Remove(Handle.Id);
+	}
+}
+
+
+void AQuantizer::CancelAllPaths()
+{
+	for (const TPair<int32, TSharedRef<FQuantizerAsyncPathQuery, ESPMode::ThreadSafe>>& Pending : PendingPathQueries)
+	{
+		Pending.Value->bCancelled = true;
+	}
+
+	PendingPathQueries.Empty();
+}
+
+
+void AQuantizer::FinishAsyncPath(const TSharedRef<FQuantizerAsyncPathQuery, ESPMode::ThreadSafe>& Query)
+{
+	//Cancelled and superseded queries were already removed
+	if (Query->bCancelled || PendingPathQueries.Remove(Query->Id) == 0)
+	{
+		return;
+	}
 
-	/*UE_LOG(LogTemp, Display, TEXT("Landscape Dimensions: (%f, %f) \nGrid Dimensions: (%i, %i)"), 
-		LandscapeDimensions.X, LandscapeDimensions.Y, GridDimensions.X, GridDimensions.Y);*/
+	FQuantizerPathHandle Handle;
+	Handle.Id = Query->Id;
 
-	//For every grid point
-	for (int x = 0; x < LandscapeDimensions.X; x += Resolution)
+	if (Query->bSuccess)
 	{
-		for (int y = 0; y < LandscapeDimensions.Y; y += Resolution)
-		{
-			FIntVector StartLocation = FIntVector(x, y, (int)SampleMaxHeight);
+		AddCachedPath(Query->CacheKey, Query->HeightmapVersion, Query->Cells);
 
-			FQuantizedSpace NewSpace;
+		Source = Query->Source;
+		Destination = Query->Destination;
+		Path = MoveTemp(Query->Path);
 
-			//Sample terrain
-			if (SampleTerrainHeight(StartLocation, NewSpace))
-			{
-				//Cache returned value
-				CachedHeightmap.Add(FIntVector2(x, y), NewSpace);
-			}
-			else
-			{
-				//Print if failed
-				UE_LOG(LogTemp, Warning, TEXT("Line trace missed terrain at (%i, %i)"), StartLocation.X, StartLocation.Y);
-			}
+		if (bDrawAsyncPaths)
+		{
+			//Delete previous visualization
+			SplineComp->ClearSplinePoints();
+
+			DrawPath();
 		}
 	}
+	else
+	{
+		UE_LOG(LogTemp, Warning, TEXT("No path between source and destination in AQuantizer::ComputePathAsync"));
+	}
+
+	OnPathComputed.Broadcast(Handle, Query->bSuccess, Query->bSuccess ? Path : TArray<FVector>());
 }
 
 
-bool AQuantizer::SampleTerrainHeight(FIntVector StartLocation, FQuantizedSpace& OutResult)
+FQuantizerPathCacheKey AQuantizer::MakePathCacheKey(int32 PathSourceIndex, int32 PathDestinationIndex, EQuantizerSearchMode QuerySearchMode) const
 {
-	UWorld* World = GetWorld();
+	FQuantizerPathCacheKey Key;
+	Key.SourceIndex = PathSourceIndex;
+	Key.DestinationIndex = PathDestinationIndex;
 
-	if (!World)
+	//Everything that changes which path a search returns
+	Key.SettingsHash = HashCombine(GetTypeHash(MaxAngleThreshold), GetTypeHash(LengthCostWeight));
+	Key.SettingsHash = HashCombine(Key.SettingsHash, GetTypeHash((uint8)QuerySearchMode));
+
+	for (const FIntVector2& MaskPoint : SampleMask.MaskPoints)
 	{
-		UE_LOG(LogTemp, Error, TEXT("AQuantizer::SampleTerrainHeight - How the hell is World null?"))
-		return false;
+		Key.SettingsHash = HashCombine(Key.SettingsHash, HashCombine(GetTypeHash(MaskPoint.X), GetTypeHash(MaskPoint.Y)));
 	}
 
-	FVector Start = (FVector)StartLocation;
-	FVector End = (FVector)StartLocation + (FVector::DownVector * (SampleMaxHeight + SampleMaxDepth));
-
-	// Raycast down from location to terrain
-	FHitResult Hit;
-	bool bHitSuccessful = World->LineTraceSingleByChannel(
-		Hit, 
-		Start, 
-		End,
-		ECollisionChannel::ECC_Visibility);
-
-	// If we hit a surface, cache the location
-	if (!bHitSuccessful)
+	if (QuerySearchMode == EQuantizerSearchMode::Hierarchical)
 	{
-		UE_LOG(LogTemp, Error, TEXT("Raycast starting at (%i, %i, %i) did not hit"), StartLocation.X, StartLocation.Y, StartLocation.Z);
+		Key.SettingsHash = HashCombine(Key.SettingsHash, GetTypeHash(HierarchyClusterSize));
+	}
+	else if (QuerySearchMode == EQuantizerSearchMode::CoarseToFine)
+	{
+		Key.SettingsHash = HashCombine(Key.SettingsHash, HashCombine(GetTypeHash(PyramidLevels), GetTypeHash(CorridorRadius)));
+	}
 
-		//Draw a red line where it failed
-		DrawDebugLine(World, Start, End, FColor::Red, true);
+	return Key;
+}
 
+
+bool AQuantizer::FindCachedPath(const FQuantizerPathCacheKey& Key, TArray<int32>& OutCells)
+{
+	if (!bUsePathCache || !CachedHeightmap.IsValid())
+	{
 		return false;
 	}
 
-	OutResult.Location = FIntVector2(StartLocation.X, StartLocation.Y);
-	OutResult.Height = Hit.Location.Z;
+	PathCache.SetMaxBytes((SIZE_T)FMath::Max(PathCacheMemoryKB, 0) * 1024);
 
-	//Draw line check
-	//DrawDebugLine(World, Start, FVector(Start.X, Start.Y, OutResult.Height), FColor::Green, true);
+	//Slopes are tested by height difference so an edge is traversable both ways, paths reverse if the mask does
+	bool bSymmetricMask = true;
 
-	return true;
+	for (const FIntVector2& MaskPoint : SampleMask.MaskPoints)
+	{
+		if (!SampleMask.MaskPoints.Contains(FIntVector2(-MaskPoint.X, -MaskPoint.Y)))
+		{
+			bSymmetricMask = false;
+			break;
+		}
+	}
+
+	//Hierarchical and coarse-to-fine paths are not shortest paths, so parts of them are not what a search between their cells would return
+	const bool bAllowSubPaths = SearchMode != EQuantizerSearchMode::Hierarchical && SearchMode != EQuantizerSearchMode::CoarseToFine;
+
+	return PathCache.Find(Key, HeightmapVersion, bSymmetricMask, bAllowSubPaths, OutCells);
 }
 
 
-// Called every frame
-void AQuantizer::Tick(float DeltaTime)
+void AQuantizer::AddCachedPath(const FQuantizerPathCacheKey& Key, uint32 Version, const TArray<int32>& Cells)
 {
-	Super::Tick(DeltaTime);
-
+	if (!bUsePathCache || Version != HeightmapVersion)
+	{
+		return;
+	}
 
+	PathCache.SetMaxBytes((SIZE_T)FMath::Max(PathCacheMemoryKB, 0) * 1024);
+	PathCache.Add(Key, Version, Cells);
 }
 
 
-FQuantizedSpace AQuantizer::Quantize(FVector Location)
+void AQuantizer::FinishCachedPath(const TSharedRef<FQuantizerAsyncPathQuery, ESPMode::ThreadSafe>& Query)
 {
-	FQuantizedSpace Result = FQuantizedSpace();
+	TWeakObjectPtr<AQuantizer> WeakThis(this);
 
-	//Rounds location to the location of the grid point at the corner of this cell
-	Location.X = ((int)Location.X / Resolution) * Resolution;	
-	Location.Y = ((int)Location.Y / Resolution) * Resolution;
-	
-	//UE_LOG(LogTemp, Display, TEXT("Coord: (%f, %f)"), Location.X, Location.Y);
+	AsyncTask(ENamedThreads::GameThread, [WeakThis, Query]()
+	{
+		if (AQuantizer* Quantizer = WeakThis.Get())
+		{
+			Quantizer->FinishAsyncPath(Query);
+		}
+	});
+}
 
-	FIntVector2 Coord = FIntVector2(Location.X, Location.Y);
 
-	//Get and return result
-	Result = CachedHeightmap[Coord];
+FQuantizerPathCacheStats AQuantizer::GetPathCacheStats() const
+{
+	FQuantizerPathCacheStats Stats;
+	Stats.Hits = (int64)PathCache.GetHits();
+	Stats.Misses = (int64)PathCache.GetMisses();
+	Stats.ReversedHits = (int64)PathCache.GetReversedHits();
+	Stats.SubPathHits = (int64)PathCache.GetSubPathHits();
+	Stats.NumEntries = PathCache.Num();
+	Stats.UsedBytes = (int64)PathCache.GetUsedBytes();
+
+	const int64 Lookups = Stats.Hits + Stats.Misses;
+	Stats.HitRate = Lookups > 0 ? (float)((double)Stats.Hits / Lookups) : 0.f;
+
+	return Stats;
+}
 
-	//UE_LOG(LogTemp, Display, TEXT("Quantized Source: (%i, %i)"), Result.Location.X, Result.Location.Y);
 
-	return Result;
+void AQuantizer::ClearPathCache()
+{
+	PathCache.Empty();
+	PathCache.ResetStats();
 }
 
 
-FAStarNode AQuantizer::PopLowestCostNode()
+FQuantizerSearchParams AQuantizer::MakeSearchParams()
 {
-	FAStarNode element = Frontier[0];
+	UpdateEdgeMask();
+
+	FQuantizerSearchParams Params;
+	Params.LengthCostWeight = LengthCostWeight;
+	Params.AngleCostWeight = AngleCostWeight;
+	Params.MaxAngleThreshold = MaxAngleThreshold;
+	Params.MaskPoints = SampleMask.MaskPoints;
+	Params.EdgeMask = CachedEdgeMask;
+	Params.SearchMode = SearchMode;
 
-	//Loop through Frontier and find lowest cost node
-	for (int i = 1; i < Frontier.Num(); i++)
+	if (SearchMode == EQuantizerSearchMode::Hierarchical)
 	{
-		if (Frontier[i].Cost < element.Cost)
-		{
-			element = Frontier[i];
-		}
+		UpdateHierarchy();
+		Params.Hierarchy = CachedHierarchy;
+		Params.HierarchyClusterSize = HierarchyClusterSize;
+	}
+	else if (SearchMode == EQuantizerSearchMode::JumpPoint)
+	{
+		UpdateJumpPoints();
+		Params.JumpPoints = CachedJumpPoints;
+	}
+	else if (SearchMode == EQuantizerSearchMode::CoarseToFine)
+	{
+		UpdatePyramid();
+		Params.Pyramid = CachedPyramid;
+		Params.CorridorRadius = CorridorRadius;
 	}
 
-	//Remove lowest cost node from Frontier and return it
-	Frontier.Remove(element);
-
-	return element;
+	return Params;
 }
 
 
-bool AQuantizer::ComputePath(FVector _Source, FVector _Destination)
+FQuantizerSmoothingParams AQuantizer::MakeSmoothingParams() const
 {
-	//Cache passed values
-	Source = _Source;
-	Destination = _Destination;
+	FQuantizerSmoothingParams Params;
+	Params.Mode = PathSmoothing;
+	Params.MaxAngleThreshold = MaxAngleThreshold;
+	Params.Lookahead = SmoothingLookahead;
 
-	//Quantize positions in terms of grid points
-	QuantizedSource = Quantize(_Source);
-	QuantizedDestination = Quantize(_Destination);
+	return Params;
+}
 
-	//UE_LOG(LogTemp, Display, TEXT("Source: (%f, %f)"), Source.X, Source.Y);
-	//UE_LOG(LogTemp, Display, TEXT("Quantized Source: (%i, %i)"), QuantizedSource.Location.X, QuantizedSource.Location.Y);
 
-	//Delete previous visualization
-	SplineComp->ClearSplinePoints();
+void AQuantizer::UpdateEdgeMask()
+{
+	if (!CachedHeightmap.IsValid())
+	{
+		CachedEdgeMask.Reset();
+		return;
+	}
 
-	FAStarNode StartNode(0, 0, QuantizedSource.Location, QuantizedSource.Location);	//Starting node is on the source position, 0 cost
+	//Settings can be changed at any time, check them before every search
+	if (CachedEdgeMask.IsValid() && CachedEdgeMask->Matches(CachedHeightmap, SampleMask.MaskPoints, MaxAngleThreshold))
+	{
+		return;
+	}
 
-	//Unexplored spaces, clear frontier
-	Frontier.Empty();
+	const double StartTime = FPlatformTime::Seconds();
 
-	Frontier.Add(StartNode);	//Initialize frontier with starting node
+	CachedEdgeMask = FQuantizerEdgeMask::Build(CachedHeightmap, SampleMask.MaskPoints, MaxAngleThreshold);
 
-	//Keys lead to the parent node as a value of the key, clear Parents
-	Parents.Empty();
-	//Nodes that have already been visited, clear Closed
-	Closed.Empty();
+	UE_LOG(LogTemp, Display, TEXT("Edge mask built in %.3f ms"), (FPlatformTime::Seconds() - StartTime) * 1000.0);
+}
 
-	//Parent of start node is itself
-	Parents.Add(StartNode.Location, StartNode.Location);
 
-	//Loop until goal is found
-	while (!Frontier.IsEmpty())
+void AQuantizer::UpdateHierarchy()
+{
+	if (!CachedEdgeMask.IsValid())
 	{
-		FAStarNode CurrentNode = PopLowestCostNode();
-
-		GenerateSuccessors(SampleMask, CurrentNode, QuantizedDestination);
+		CachedHierarchy.Reset();
+		return;
+	}
 
-		Closed.Add(CurrentNode);
+	if (CachedHierarchy.IsValid() && CachedHierarchy->Matches(CachedHeightmap, CachedEdgeMask, LengthCostWeight, HierarchyClusterSize))
+	{
+		return;
 	}
 
-	DrawPath();
+	const double StartTime = FPlatformTime::Seconds();
 
-	return true;
+	CachedHierarchy = FQuantizerHierarchy::Build(CachedHeightmap, CachedEdgeMask, LengthCostWeight, HierarchyClusterSize);
+
+	if (CachedHierarchy.IsValid())
+	{
+		UE_LOG(LogTemp, Display, TEXT("Hierarchy with %i nodes built in %.3f ms using %llu bytes"), CachedHierarchy->GetNodes().Num(),
+			(FPlatformTime::Seconds() - StartTime) * 1000.0, (uint64)CachedHierarchy->GetAllocatedSize());
+	}
 }
 
 
-float AQuantizer::CostFunction(const FAStarNode& Current, FAStarNode& Next) const
+void AQuantizer::UpdateJumpPoints()
 {
-	//Distance calculations using 2D space
-	FVector Current3 = FVector(Current.Location.X, Current.Location.Y, 0);
-	FVector Next3 = FVector(Next.Location.X, Next.Location.Y, 0);
-
-	//Can probably be cached somewhere
-	FVector Goal = FVector(QuantizedDestination.Location.X, QuantizedDestination.Location.Y, 0);
-	
-	FVector Vec = Next3 - Current3;				//Vector between current point and neighbor
-	float CurrentNextDistance = Vec.Length();	//Distance between current point and neibor
-
-	//Distance (in terms of grid units) between next and goal (h)
-	float DistanceToGoal = ((Goal - Next3).Length() / Resolution) * LengthCostWeight;
+	if (!CachedEdgeMask.IsValid())
+	{
+		CachedJumpPoints.Reset();
+		return;
+	}
 
-	//Calculate new distance from start (g)
-	Next.DistanceFromStart = Current.DistanceFromStart + ((CurrentNextDistance / Resolution) * LengthCostWeight);
+	if (CachedJumpPoints.IsValid() && CachedJumpPoints->Matches(CachedEdgeMask))
+	{
+		return;
+	}
 
-	//Calculate new cost (g + h)
-	Next.Cost = Next.DistanceFromStart + DistanceToGoal;
+	const double StartTime = FPlatformTime::Seconds();
 
-	//Add third dimension
-	Current3.Z = CachedHeightmap[Current.Location].Height;
-	Next3.Z = CachedHeightmap[Next.Location].Height;
+	CachedJumpPoints = FQuantizerJumpPoints::Build(CachedHeightmap, CachedEdgeMask);
 
-	Vec = Next3 - Current3;
+	if (CachedJumpPoints.IsValid())
+	{
+		UE_LOG(LogTemp, Display, TEXT("Jump points built in %.3f ms"), (FPlatformTime::Seconds() - StartTime) * 1000.0);
+	}
+}
 
-	//Angle calculations
-	FVector ProjectedVec = (FVector::VectorPlaneProject(Vec, FVector::UpVector)).GetSafeNormal();
 
-	float angle = FMath::RadiansToDegrees(FMath::Acos(Vec.Dot(ProjectedVec) / (Vec.Length() * ProjectedVec.Length())));
+void AQuantizer::UpdatePyramid()
+{
+	if (!CachedEdgeMask.IsValid())
+	{
+		CachedPyramid.Reset();
+		return;
+	}
 
-	//Do not accept any neighbors above the angle threshold
-	if (angle > MaxAngleThreshold)
+	if (CachedPyramid.IsValid() && CachedPyramid->Matches(CachedHeightmap, CachedEdgeMask, PyramidLevels))
 	{
-		Next.Cost = INFINITY;
-		return INFINITY;
+		return;
 	}
 
-	//UE_LOG(LogTemp, Display, TEXT("Angle: %f"), angle);
+	const double StartTime = FPlatformTime::Seconds();
 
-	//return (angle * AngleCostWeight) + ((length / Resolution) * LengthCostWeight);
-	return Next.Cost;
+	CachedPyramid = FQuantizerHeightmapPyramid::Build(CachedHeightmap, CachedEdgeMask, PyramidLevels);
+
+	if (CachedPyramid.IsValid())
+	{
+		UE_LOG(LogTemp, Display, TEXT("Heightmap pyramid with %i levels built in %.3f ms using %llu bytes"), CachedPyramid->Num(),
+			(FPlatformTime::Seconds() - StartTime) * 1000.0, (uint64)CachedPyramid->GetAllocatedSize());
+	}
 }
 
 
-float AQuantizer::GoalFunction(FIntVector2 Current) const
+void AQuantizer::RefreshHeightmapRegion(FVector RegionMin, FVector RegionMax)
 {
-	return (FVector(QuantizedDestination.Location.X, QuantizedDestination.Location.Y, QuantizedDestination.Height) -
-		FVector(Current.X, Current.Y, CachedHeightmap[Current].Height)).Length();
-}
+	UWorld* World = GetWorld();
 
+	//Tiles outside the current window are sampled again when they are next needed
+	if (bStreamHeightmap && HeightmapTiles.IsInitialized())
+	{
+		HeightmapTiles.Invalidate(FIntRect(
+			FMath::FloorToInt(FMath::Min(RegionMin.X, RegionMax.X) / Resolution), FMath::FloorToInt(FMath::Min(RegionMin.Y, RegionMax.Y) / Resolution),
+			FMath::FloorToInt(FMath::Max(RegionMin.X, RegionMax.X) / Resolution) + 1, FMath::FloorToInt(FMath::Max(RegionMin.Y, RegionMax.Y) / Resolution) + 1));
+	}
 
-bool AQuantizer::IsGridPointValid(FIntVector2 GridPoint) const
-{
-	//Check grid point is not out of range or less than 0
-	return CachedHeightmap.Contains(GridPoint);
-}
+	if (!CachedHeightmap.IsValid() || !World)
+	{
+		UE_LOG(LogTemp, Error, TEXT("No heightmap to refresh in AQuantizer::RefreshHeightmapRegion"));
+		return;
+	}
 
+	const FIntVector2 MinCell = CachedHeightmap->WorldToCell(RegionMin);
+	const FIntVector2 MaxCell = CachedHeightmap->WorldToCell(RegionMax);
 
-void AQuantizer::GenerateSuccessors(const FGridMask& GridMask, const FAStarNode& Current, const FQuantizedSpace& Goal)
-{
-	//float LowestCost = INFINITY;
+	FIntRect Cells(FMath::Min(MinCell.X, MaxCell.X), FMath::Min(MinCell.Y, MaxCell.Y), FMath::Max(MinCell.X, MaxCell.X) + 1, FMath::Max(MinCell.Y, MaxCell.Y) + 1);
+	Cells.Clip(FIntRect(0, 0, CachedHeightmap->Dimensions.X, CachedHeightmap->Dimensions.Y));
 
-	//Sample all grid mask points
-	for (int i = 0; i < GridMask.MaskPoints.Num(); i++)
+	if (Cells.Area() <= 0)
 	{
-		FAStarNode NextNode;
+		return;
+	}
 
-		//Calcualte next point
-		NextNode.Location = Current.Location;
-		NextNode.Location.X += GridMask.MaskPoints[i].X * Resolution;
-		NextNode.Location.Y += GridMask.MaskPoints[i].Y * Resolution;
+	//Copy so queries still running on the old heightmap are unaffected
+	TSharedRef<FQuantizedHeightmap, ESPMode::ThreadSafe> NewHeightmap = MakeShared<FQuantizedHeightmap, ESPMode::ThreadSafe>(*CachedHeightmap);
 
-		//Ensure grid point is valid
-		if (!IsGridPointValid(NextNode.Location))
-		{
-			UE_LOG(LogTemp, Display, TEXT("Grid point not valid at (%i, %i)"), NextNode.Location.X, NextNode.Location.Y);
-			continue;
-		}
-		
-		//Check if reached goal
-		if (NextNode.Location == Goal.Location)
-		{
-			UE_LOG(LogTemp, Warning, TEXT("Algorithm finished, goal reached with A*"));
+	//New heights may lie outside the compacted range, compacting again afterwards fits the range to them
+	const bool bWasCompact = NewHeightmap->IsCompact();
+	NewHeightmap->Expand();
 
-			/////////////////// TODO - Implement traceback and finish algorithm
+	for (int32 y = Cells.Min.Y; y < Cells.Max.Y; y++)
+	{
+		for (int32 x = Cells.Min.X; x < Cells.Max.X; x++)
+		{
+			const int32 Index = NewHeightmap->GetIndex(x, y);
 
-			Path.Empty();
-			Path.Add(Destination);
-			TraceBackPath(Current, Path);
-			Path.Add(Source);
+			float Height;
 
-			//Finish A*
-			Frontier.Empty();
+			const FVector CellLocation = NewHeightmap->GetCellWorldLocation(x, y);
 
-			return;
+			if (TraceTerrainHeight(*World, FIntVector((int)CellLocation.X, (int)CellLocation.Y, (int)SampleMaxHeight), Height))
+			{
+				NewHeightmap->SetHeight(Index, Height);
+			}
+			else
+			{
+				NewHeightmap->ClearHeight(Index);
+			}
 		}
+	}
 
-		//Get cost
-		float CurrentCost = CostFunction(Current, NextNode);
+	if (bWasCompact)
+	{
+		NewHeightmap->Compact();
+	}
 
-		//Find node in open list if it exists
-		int ExistingIndex = Frontier.Find(NextNode);
+	//Only the edges and clusters around the region need to be rebuilt
+	const bool bEdgeMaskCurrent = CachedEdgeMask.IsValid() && CachedEdgeMask->Matches(CachedHeightmap, SampleMask.MaskPoints, MaxAngleThreshold);
+	const bool bHierarchyCurrent = bEdgeMaskCurrent && CachedHierarchy.IsValid() && CachedHierarchy->Matches(CachedHeightmap, CachedEdgeMask, LengthCostWeight, HierarchyClusterSize);
 
-		//Ignore this node if one exists already with a lower cost
-		if (ExistingIndex != INDEX_NONE && Frontier[ExistingIndex].Cost <= NextNode.Cost)
-		{
-			continue;
-		}
+	CachedHeightmap = NewHeightmap;
+	HeightmapVersion++;
 
-		//Find node in open list if it exists
-		ExistingIndex = Closed.Find(NextNode);
+	SET_MEMORY_STAT(STAT_Quantizer_HeightmapMemory, CachedHeightmap->GetAllocatedSize());
 
-		//Ignore this node if one exists already with a lower cost
-		if (ExistingIndex != INDEX_NONE && Closed[ExistingIndex].Cost <= NextNode.Cost)
-		{
-			continue;
-		}
+	if (!bEdgeMaskCurrent)
+	{
+		UpdateEdgeMask();
+		IncrementalPlanner.Reset();
+		return;
+	}
 
-		//Set parent
-		NextNode.Parent = Current.Location;
+	CachedEdgeMask = CachedEdgeMask->Rebuild(CachedHeightmap, Cells);
 
-		//Overwrite if in map, add new entry otherwise
-		if (Parents.Contains(NextNode.Location))
-		{
-			Parents[NextNode.Location] = Current.Location;
-		}
-		else
-		{
-			Parents.Add(NextNode.Location, Current.Location);
-		}
+	//Reopens only the cells whose edges changed
+	IncrementalPlanner.UpdateTerrain(CachedHeightmap, CachedEdgeMask, Cells);
 
-		//Add to frontier
-		Frontier.Add(NextNode);
-		
-		//Draw sample line between current and sample point
-		/*DrawDebugLine(GetWorld(), FVector(Current.Location.X, Current.Location.Y, CachedHeightmap[Current.Location].Height),
-			FVector(NextNode.Location.X, NextNode.Location.Y, CachedHeightmap[NextNode.Location].Height), FColor::White, true);*/
+	if (bHierarchyCurrent)
+	{
+		CachedHierarchy = CachedHierarchy->Rebuild(CachedHeightmap, CachedEdgeMask, Cells);
 	}
 }
 
 
-void AQuantizer::TraceBackPath(const FAStarNode& LastNode, TArray<FVector>& PathTrace)
+bool AQuantizer::IsGridPointValid(FIntVector2 GridPoint) const
 {
-	PathTrace.Add(FVector((float)LastNode.Location.X, (float)LastNode.Location.Y, CachedHeightmap[LastNode.Location].Height));
+	//Check grid point is not out of range or less than 0, and that its trace hit the terrain
+	return CachedHeightmap.IsValid() && CachedHeightmap->IsCellValid(GridPoint.X, GridPoint.Y);
+}
 
-	FIntVector2 CurrentLocation = LastNode.Parent;
-	
-	//Trace back until you reach the start
-	while (CurrentLocation != Parents[CurrentLocation])
+
+void AQuantizer::BuildWorldPath(const FQuantizedHeightmap& Heightmap, const TArray<int32>& Cells, const FVector& PathSource, const FVector& PathDestination, const FQuantizerSmoothingParams& Smoothing, TArray<FVector>& OutPath)
+{
+	TArray<int32> SmoothedCells;
+
+	if (Smoothing.Mode != EQuantizerPathSmoothing::None)
 	{
-		//UE_LOG(LogTemp, Display, TEXT("Current Location: (%f, %f, %f)"), (float)CurrentLocation.X, (float)CurrentLocation.Y, CachedHeightmap[CurrentLocation].Height);
+		SmoothedCells = Cells;
+		FQuantizerPathSmoothing::Smooth(Heightmap, Smoothing, SmoothedCells);
+	}
+
+	const TArray<int32>& PathCells = Smoothing.Mode != EQuantizerPathSmoothing::None ? SmoothedCells : Cells;
 
-		//Add current location to array
-		PathTrace.Add(FVector((float)CurrentLocation.X, (float)CurrentLocation.Y, CachedHeightmap[CurrentLocation].Height));
+	OutPath.Reset(PathCells.Num() + 2);
 
-		//Move to next node
-		CurrentLocation = Parents[CurrentLocation];
+	OutPath.Add(PathDestination);
+
+	for (int32 Cell : PathCells)
+	{
+		OutPath.Add(Heightmap.GetWorldLocation(Cell));
 	}
 
-	PathTrace.Add(FVector((float)CurrentLocation.X, (float)CurrentLocation.Y, CachedHeightmap[CurrentLocation].Height));
+	OutPath.Add(PathSource);
+
+	SET_DWORD_STAT(STAT_Quantizer_PathLength, OutPath.Num());
 }
 
 
 void AQuantizer::DrawPath()
 {
+	QUANTIZER_SCOPE(DrawPath);
+
 	if (!SplineComp)
 	{
 		UE_LOG(LogTemp, Error, TEXT("Spline Component is not valid in AQuantizer::GenerateSuccessors"));
@@ -404,7 +1587,7 @@ void AQuantizer::DrawPath()
 	FSplinePoint NewPoint;
 	NewPoint.Position = Source;
 	NewPoint.InputKey = 0;
-	SplineComp->AddPoint(NewPoint);
+	SplineComp->AddPoint(NewPoint, false);
 
 	//FVector Previous = Source;
 
@@ -415,7 +1598,7 @@ void AQuantizer::DrawPath()
 		//DrawDebugLine(GetWorld(), Previous, Path[c], FColor::Magenta, true);
 		NewPoint.Position = Path[c];
 		NewPoint.InputKey = Path.Num() - c;
-		SplineComp->AddPoint(NewPoint);
+		SplineComp->AddPoint(NewPoint, false);
 		//Previous = Path[c];
 	}
 	//UE_LOG(LogTemp, Display, TEXT("Destination: (%f, %f, %f)"), Destination.X, Destination.Y, Destination.Z);
@@ -423,7 +1606,10 @@ void AQuantizer::DrawPath()
 	NewPoint.Position = Destination;
 
 	NewPoint.InputKey = Path.Num() + 1;
-	SplineComp->AddPoint(NewPoint);
+	SplineComp->AddPoint(NewPoint, false);
+
+	//Tangents are only worked out once, not after every point
+	SplineComp->UpdateSpline();
 
 	if (!SplineMesh)
 	{
@@ -431,17 +1617,44 @@ void AQuantizer::DrawPath()
 		return;
 	}
 
+	const int32 NumSegments = SplineComp->GetNumberOfSplinePoints() - 1;
+
+	if (InstancedPathSegments > 0 && NumSegments > InstancedPathSegments)
+	{
+		DrawSplineMeshes(0);
+		DrawPathInstances(NumSegments);
+	}
+	else
+	{
+		DrawPathInstances(0);
+		DrawSplineMeshes(NumSegments);
+	}
+}
+
+
+void AQuantizer::DrawSplineMeshes(int32 NumSegments)
+{
 	// Source: https://www.youtube.com/watch?v=iD3l44uMd58
-	for (int SplineIndex = 0; SplineIndex < SplineComp->GetNumberOfSplinePoints() - 1; SplineIndex++)
+	for (int SplineIndex = 0; SplineIndex < NumSegments; SplineIndex++)
 	{
-		//Create mesh, register with world and attach to spline component
-		USplineMeshComponent* SplineMeshComponent = NewObject<USplineMeshComponent>(this, USplineMeshComponent::StaticClass());
+		//Only create a mesh when the pool runs out, register with world and attach to spline component
+		if (SplineIndex == SplineMeshPool.Num())
+		{
+			USplineMeshComponent* NewComponent = NewObject<USplineMeshComponent>(this, USplineMeshComponent::StaticClass());
+
+			NewComponent->SetMobility(EComponentMobility::Movable);
+			NewComponent->CreationMethod = EComponentCreationMethod::Instance;
+			NewComponent->RegisterComponentWithWorld(GetWorld());
+			NewComponent->AttachToComponent(SplineComp, FAttachmentTransformRules::KeepRelativeTransform);
 
+			SplineMeshPool.Add(NewComponent);
+		}
+
+		USplineMeshComponent* SplineMeshComponent = SplineMeshPool[SplineIndex];
+
+		//Both return early when nothing changed
 		SplineMeshComponent->SetStaticMesh(SplineMesh);
-		SplineMeshComponent->SetMobility(EComponentMobility::Movable);
-		SplineMeshComponent->CreationMethod = EComponentCreationMethod::UserConstructionScript;
-		SplineMeshComponent->RegisterComponentWithWorld(GetWorld());
-		SplineMeshComponent->AttachToComponent(SplineComp, FAttachmentTransformRules::KeepRelativeTransform);
+		SplineMeshComponent->SetMaterial(0, SplineMat);
 
 		//Get start and end points
 		const FVector StartPoint = SplineComp->GetLocationAtSplinePoint(SplineIndex, ESplineCoordinateSpace::Local);
@@ -449,14 +1662,125 @@ void AQuantizer::DrawPath()
 		const FVector EndPoint = SplineComp->GetLocationAtSplinePoint(SplineIndex + 1, ESplineCoordinateSpace::Local);
 		const FVector EndTangent = SplineComp->GetTangentAtSplinePoint(SplineIndex + 1, ESplineCoordinateSpace::Local);
 
+		SplineMeshComponent->SetForwardAxis(ForwardAxis, false);
+
 		//Set position and tangent data
 		SplineMeshComponent->SetStartAndEnd(StartPoint, StartTangent, EndPoint, EndTangent, true);
 
-		SplineMeshComponent->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+		if (SplineIndex >= NumVisibleSplineMeshes)
+		{
+			SplineMeshComponent->SetVisibility(true);
+			SplineMeshComponent->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+		}
+	}
+
+	//Spares of a longer path stay in the pool hidden
+	for (int32 SplineIndex = NumSegments; SplineIndex < FMath::Min(NumVisibleSplineMeshes, SplineMeshPool.Num()); SplineIndex++)
+	{
+		SplineMeshPool[SplineIndex]->SetVisibility(false);
+		SplineMeshPool[SplineIndex]->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	}
 
-		SplineMeshComponent->SetForwardAxis(ForwardAxis);
+	NumVisibleSplineMeshes = NumSegments;
 
-		//Material
-		SplineMeshComponent->SetMaterial(0, SplineMat);
+	//Shrink the pool once a much shorter path leaves too many spares
+	const int32 MaxPoolSize = NumSegments + FMath::Max(MaxSpareSplineMeshes, 0);
+
+	while (SplineMeshPool.Num() > MaxPoolSize)
+	{
+		SplineMeshPool.Pop(false)->DestroyComponent();
+	}
+}
+
+
+void AQuantizer::DrawPathInstances(int32 NumSegments)
+{
+	if (!PathInstances)
+	{
+		if (NumSegments == 0)
+		{
+			return;
+		}
+
+		PathInstances = NewObject<UInstancedStaticMeshComponent>(this, UInstancedStaticMeshComponent::StaticClass());
+
+		PathInstances->SetMobility(EComponentMobility::Movable);
+		PathInstances->CreationMethod = EComponentCreationMethod::Instance;
+		PathInstances->RegisterComponentWithWorld(GetWorld());
+		PathInstances->AttachToComponent(SplineComp, FAttachmentTransformRules::KeepRelativeTransform);
+		PathInstances->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+	}
+
+	const int32 NumInstances = PathInstances->GetInstanceCount();
+
+	//Drop the instances a shorter path does not use, from the back so indices stay put
+	if (NumInstances > NumSegments)
+	{
+		TArray<int32> RemovedInstances;
+		RemovedInstances.Reserve(NumInstances - NumSegments);
+
+		for (int32 InstanceIndex = NumInstances - 1; InstanceIndex >= NumSegments; InstanceIndex--)
+		{
+			RemovedInstances.Add(InstanceIndex);
+		}
+
+		PathInstances->RemoveInstances(RemovedInstances);
+	}
+
+	PathInstances->SetVisibility(NumSegments > 0);
+
+	if (NumSegments == 0)
+	{
+		return;
+	}
+
+	PathInstances->SetStaticMesh(SplineMesh);
+	PathInstances->SetMaterial(0, SplineMat);
+
+	//Stretch the mesh along its forward axis from one spline point to the next
+	const int32 Axis = (int32)ForwardAxis.GetValue();
+	const FBox MeshBox = SplineMesh->GetBoundingBox();
+	const double MeshLength = FMath::Max(MeshBox.Max[Axis] - MeshBox.Min[Axis], UE_KINDA_SMALL_NUMBER);
+
+	for (int32 SplineIndex = 0; SplineIndex < NumSegments; SplineIndex++)
+	{
+		const FVector StartPoint = SplineComp->GetLocationAtSplinePoint(SplineIndex, ESplineCoordinateSpace::Local);
+		const FVector EndPoint = SplineComp->GetLocationAtSplinePoint(SplineIndex + 1, ESplineCoordinateSpace::Local);
+
+		FVector Direction;
+		double SegmentLength;
+		(EndPoint - StartPoint).ToDirectionAndLength(Direction, SegmentLength);
+
+		FQuat Rotation;
+
+		switch (ForwardAxis)
+		{
+		case ESplineMeshAxis::Y:
+			Rotation = FRotationMatrix::MakeFromY(Direction).ToQuat();
+			break;
+		case ESplineMeshAxis::Z:
+			Rotation = FRotationMatrix::MakeFromZ(Direction).ToQuat();
+			break;
+		default:
+			Rotation = FRotationMatrix::MakeFromX(Direction).ToQuat();
+			break;
+		}
+
+		FVector Scale = FVector::OneVector;
+		Scale[Axis] = SegmentLength / MeshLength;
+
+		//The back of the mesh sits on the start point
+		const FTransform InstanceTransform(Rotation, StartPoint - Direction * (MeshBox.Min[Axis] * Scale[Axis]), Scale);
+
+		if (SplineIndex < NumInstances)
+		{
+			PathInstances->UpdateInstanceTransform(SplineIndex, InstanceTransform, false, false, true);
+		}
+		else
+		{
+			PathInstances->AddInstance(InstanceTransform);
+		}
 	}
-}
\ No newline at end of file
+
+	PathInstances->MarkRenderStateDirty();
+}
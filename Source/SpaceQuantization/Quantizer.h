@@ -7,96 +7,181 @@
 
 #include "Components/SplineMeshComponent.h"
 
+#include "QuantizedHeightmap.h"
+#include "QuantizerPathfinder.h"
+#include "QuantizerHeightmapBake.h"
+#include "QuantizerIncrementalPlanner.h"
+#include "QuantizerPathCache.h"
+#include "QuantizerHeightmapTiles.h"
+#include "QuantizerHeightmapImport.h"
+#include "QuantizerPathSmoothing.h"
+
 #include "Quantizer.generated.h"
 
 class USplineComponent;
+class UInstancedStaticMeshComponent;
 class UStaticMesh;
+class UTexture2D;
+class ALandscapeProxy;
 
 /// <summary>
-/// Nodes used in A* algorithm
+/// Where GenerateHeightmap gets terrain heights from
 /// </summary>
-USTRUCT()
-struct FAStarNode
+UENUM(BlueprintType)
+enum class EQuantizerHeightSource : uint8
+{
+	//One physics trace per cell, works on any geometry
+	Raycast,
+	//Height data of the landscape's collision components
+	Landscape,
+	//16-bit heightmap texture stretched over the landscape
+	HeightmapTexture
+};
+
+/// <summary>
+/// A list of points that defines a mask of points whose heights are sampled relative to a center point
+/// </summary>
+USTRUCT(BlueprintType)
+struct FGridMask
 {
 	GENERATED_BODY()
 
-	float Cost;	//Cost heuristic
-	float DistanceFromStart;	//Distance (euclidean) from start node
-	FIntVector2 Location;
+	FGridMask();
 
-	FIntVector2 Parent;
+	UPROPERTY(EditAnywhere)
+	TArray<FIntVector2> MaskPoints;
+};
 
-	FAStarNode()
-		: Cost(0), DistanceFromStart(0), Location(0, 0)
-	{}
+/// <summary>
+/// A point on the terrain that has been discretized
+/// </summary>
+USTRUCT(BlueprintType)
+struct FQuantizedSpace
+{
+	GENERATED_BODY()
 
-	FAStarNode(float _Cost, float _DistanceFromStart, FIntVector2 _Location, FIntVector2 _Parent)
-	: Cost(_Cost), DistanceFromStart(_DistanceFromStart), Location(_Location), Parent(_Parent)
-	{}
+	FQuantizedSpace();
 
-	FAStarNode(const FAStarNode& Other)
-		: Cost(Other.Cost), DistanceFromStart(Other.DistanceFromStart), Location(Other.Location), Parent(Other.Parent)
-	{}
+	FIntVector2 Location;	//2D location in the XY axes where this point lies, integer to avoid floating point errors and use as map key
 
-	bool operator==(const FAStarNode& Other) const
-	{
-		return Equals(Other);
-	}
+	float Height;	//Height in Z axis of this point
+};
 
-	bool operator<(const FAStarNode& Other) const
-	{
-		return Cost < Other.Cost;
-	}
+/// <summary>
+/// Identifies a path query started with ComputePathAsync
+/// </summary>
+USTRUCT(BlueprintType)
+struct FQuantizerPathHandle
+{
+	GENERATED_BODY()
 
-	bool Equals(const FAStarNode& Other) const
-	{
-		return Location == Other.Location;
-	}
+	UPROPERTY(BlueprintReadOnly)
+	int32 Id = 0;
 
-	static bool CompareLess(const FAStarNode& l, const FAStarNode& r) 
-	{ 
-		return l.Cost > r.Cost; 
+	bool IsValid() const
+	{
+		return Id != 0;
 	}
 };
 
 /// <summary>
-/// Allows FAStarNode to be used as a key in a TMap
+/// One query of a ComputePaths batch
 /// </summary>
-/// <param name="Thing"></param>
-/// <returns></returns>
-FORCEINLINE uint32 GetTypeHash(const FAStarNode& Thing)
+USTRUCT(BlueprintType)
+struct FPathRequest
 {
-	uint32 Hash = FCrc::MemCrc32(&Thing, sizeof(FAStarNode));
-	return Hash;
-}
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FVector Source = FVector::ZeroVector;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FVector Destination = FVector::ZeroVector;
+
+	//Search from both ends whatever the Quantizer's SearchMode is, pays off on long queries over open terrain
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bBidirectional = false;
+};
 
 /// <summary>
-/// A list of points that defines a mask of points whose heights are sampled relative to a center point
+/// Result of one query of a ComputePaths batch, same order as the requests
 /// </summary>
 USTRUCT(BlueprintType)
-struct FGridMask
+struct FPathResult
 {
 	GENERATED_BODY()
 
-	FGridMask();
+	UPROPERTY(BlueprintReadOnly)
+	bool bSuccess = false;
 
-	UPROPERTY(EditAnywhere)
-	TArray<FIntVector2> MaskPoints;
+	//Destination, grid points back to the source, source
+	UPROPERTY(BlueprintReadOnly)
+	TArray<FVector> Path;
+
+	//Nodes the search expanded to find the path
+	UPROPERTY(BlueprintReadOnly)
+	int32 NodesExpanded = 0;
 };
 
 /// <summary>
-/// A point on the terrain that has been discretized
+/// Hit counts and size of the path cache
 /// </summary>
 USTRUCT(BlueprintType)
-struct FQuantizedSpace
+struct FQuantizerPathCacheStats
 {
 	GENERATED_BODY()
 
-	FQuantizedSpace();
+	UPROPERTY(BlueprintReadOnly)
+	int64 Hits = 0;
 
-	FIntVector2 Location;	//2D location in the XY axes where this point lies, integer to avoid floating point errors and use as map key
+	UPROPERTY(BlueprintReadOnly)
+	int64 Misses = 0;
 
-	float Height;	//Height in Z axis of this point
+	//Hits answered by a cached path in the other direction
+	UPROPERTY(BlueprintReadOnly)
+	int64 ReversedHits = 0;
+
+	//Hits answered by part of a longer cached path
+	UPROPERTY(BlueprintReadOnly)
+	int64 SubPathHits = 0;
+
+	//Hits over lookups, 0 before the first lookup
+	UPROPERTY(BlueprintReadOnly)
+	float HitRate = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumEntries = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int64 UsedBytes = 0;
+};
+
+/// <summary>
+/// Fired on the game thread when an asynchronous path query finishes
+/// </summary>
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnQuantizerPathComputed, FQuantizerPathHandle, Handle, bool, bSuccess, const TArray<FVector>&, Path);
+
+/// <summary>
+/// State shared between the game thread and the worker running an asynchronous path query
+/// </summary>
+struct FQuantizerAsyncPathQuery
+{
+	int32 Id = 0;
+
+	//Set by the game thread to make the worker give up
+	std::atomic<bool> bCancelled { false };
+
+	FVector Source;
+	FVector Destination;
+
+	//Cache entry the result is stored under, only results with Cells are stored
+	FQuantizerPathCacheKey CacheKey;
+	uint32 HeightmapVersion = 0;
+
+	//Written by the worker before it hands the query back to the game thread
+	bool bSuccess = false;
+	TArray<FVector> Path;
+	TArray<int32> Cells;
 };
 
 
@@ -107,11 +192,6 @@ class SPACEQUANTIZATION_API AQuantizer : public AActor
 	
 public:	
 
-	//A* Data Structures
-	TArray<FAStarNode> Frontier;	//Unexplored nodes
-	TMap<FIntVector2, FIntVector2> Parents;	//Map of parent nodes, key = child, value = parent
-	TArray<FAStarNode> Closed;		//Explored nodes
-
 	//Finished path
 	TArray<FVector> Path;
 
@@ -149,10 +229,60 @@ public:
 	UPROPERTY(EditAnywhere)
 	float SampleMaxDepth = 5000;	//Max depth of terrain below 0
 
+	//Keep heights as 16 bit steps between the lowest and highest sampled height, half the memory of float heights at a
+	//precision of (max - min) / 65534 units
+	UPROPERTY(EditAnywhere)
+	bool bCompactHeights = false;
+
+	//Order heightmap cells and per-cell search data are stored in, Blocked keeps the vertical neighbors of a cell in
+	//nearby cache lines on wide maps
+	UPROPERTY(EditAnywhere)
+	EQuantizerGridLayout GridLayout = EQuantizerGridLayout::Linear;
+
 	//Mask used for sampling points
 	UPROPERTY(EditAnywhere)
 	FGridMask SampleMask;
 
+	//Where heights come from, falls back to Raycast when the source is not available
+	UPROPERTY(EditAnywhere)
+	EQuantizerHeightSource HeightSource = EQuantizerHeightSource::Raycast;
+
+	//Source heightfield used with EQuantizerHeightSource::HeightmapTexture
+	UPROPERTY(EditAnywhere)
+	UTexture2D* HeightmapTexture;
+
+	//Width in cells of the square tiles the heightmap is traced in, one task per tile
+	UPROPERTY(EditAnywhere, meta = (ClampMin = "1"))
+	int32 SampleTileSize = 64;
+
+	//Trace tiles or read landscape rows on all worker threads, single threaded otherwise
+	UPROPERTY(EditAnywhere)
+	bool bParallelHeightmapSampling = true;
+
+	//Throughput of the last GenerateHeightmap
+	UPROPERTY(VisibleInstanceOnly)
+	float SampleTracesPerSecond = 0.f;
+
+	//Algorithm used by ComputePath, ComputePathAsync and ComputePaths
+	UPROPERTY(EditAnywhere, Category = "Search")
+	EQuantizerSearchMode SearchMode = EQuantizerSearchMode::AStar;
+
+	//Width in cells of the clusters of EQuantizerSearchMode::Hierarchical
+	UPROPERTY(EditAnywhere, Category = "Search", meta = (ClampMin = "2"))
+	int32 HierarchyClusterSize = 32;
+
+	//Coarse levels built on top of the heightmap for EQuantizerSearchMode::CoarseToFine, each halves the grid
+	UPROPERTY(EditAnywhere, Category = "Search", meta = (ClampMin = "1"))
+	int32 PyramidLevels = 3;
+
+	//Cells a coarse path is widened by before the next finer level searches inside it
+	UPROPERTY(EditAnywhere, Category = "Search", meta = (ClampMin = "0"))
+	int32 CorridorRadius = 2;
+
+	//Load the heightmap written by BakeHeightmap in BeginPlay instead of sampling, if it matches the current landscape and settings
+	UPROPERTY(EditAnywhere)
+	bool bUseBakedHeightmap = true;
+
 	//Actors that show the positions of the source and destination 
 	UPROPERTY(EditAnywhere, meta = (AllowPrivateAccess = "true"))
 	AActor* SourceMarker;
@@ -163,6 +293,10 @@ public:
 	FQuantizedSpace QuantizedSource;
 	FQuantizedSpace QuantizedDestination;
 
+	//Heightmap indices of QuantizedSource and QuantizedDestination
+	int32 SourceIndex = INDEX_NONE;
+	int32 DestinationIndex = INDEX_NONE;
+
 	//Used to visualize path
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Spline")
 	USplineComponent* SplineComp;
@@ -179,12 +313,138 @@ public:
 	UPROPERTY(EditDefaultsOnly, Category = "Spline")
 	TEnumAsByte<ESplineMeshAxis::Type> ForwardAxis;
 
+	//Paths with more segments than this are drawn as straight instances of SplineMesh in one draw call instead of bent spline meshes, 0 to always bend
+	UPROPERTY(EditAnywhere, Category = "Spline", meta = (ClampMin = "0"))
+	int32 InstancedPathSegments = 0;
+
+	//Hidden spline meshes kept around for longer paths, any beyond this are destroyed
+	UPROPERTY(EditAnywhere, Category = "Spline", meta = (ClampMin = "0"))
+	int32 MaxSpareSplineMeshes = 64;
+
+	//Called when a query started with ComputePathAsync finishes
+	UPROPERTY(BlueprintAssignable)
+	FOnQuantizerPathComputed OnPathComputed;
+
+	//Starting an asynchronous query cancels any that are still running
+	UPROPERTY(EditAnywhere)
+	bool bSupersedePendingPaths = true;
+
+	//Draw the result of asynchronous queries before OnPathComputed fires
+	UPROPERTY(EditAnywhere)
+	bool bDrawAsyncPaths = true;
+
+	//Reuse the results of earlier queries between the same cells until the heightmap or search settings change
+	UPROPERTY(EditAnywhere, Category = "Cache")
+	bool bUsePathCache = true;
+
+	//Memory the path cache may use, least recently used paths are evicted beyond it
+	UPROPERTY(EditAnywhere, Category = "Cache", meta = (ClampMin = "0"))
+	int32 PathCacheMemoryKB = 4096;
+
+	//Time a query started with ComputePathTimeSliced may spend searching each frame
+	UPROPERTY(EditAnywhere, Category = "Search", meta = (ClampMin = "1"))
+	int32 TimeSliceBudgetMicroseconds = 1000;
+
+	//Nodes a query started with ComputePathTimeSliced may expand each frame, 0 for no limit
+	UPROPERTY(EditAnywhere, Category = "Search", meta = (ClampMin = "0"))
+	int32 TimeSliceNodeBudget = 0;
+
+	//How found paths are shortened by line of sight before they become Path and the spline
+	UPROPERTY(EditAnywhere, Category = "Smoothing")
+	EQuantizerPathSmoothing PathSmoothing = EQuantizerPathSmoothing::Greedy;
+
+	//Furthest cell along the path EQuantizerPathSmoothing::Optimal looks for a shortcut to
+	UPROPERTY(EditAnywhere, Category = "Smoothing", meta = (ClampMin = "1"))
+	int32 SmoothingLookahead = 64;
+
+	//Sample the heightmap in tiles as queries and players reach them instead of all at once in BeginPlay, for landscapes too large to keep in memory
+	UPROPERTY(EditAnywhere, Category = "Streaming")
+	bool bStreamHeightmap = false;
+
+	//Width in cells of the tiles the streamed heightmap is sampled and evicted in
+	UPROPERTY(EditAnywhere, Category = "Streaming", meta = (ClampMin = "8"))
+	int32 StreamingTileSize = 64;
+
+	//Memory the streamed tiles may use, least recently used tiles are evicted beyond it
+	UPROPERTY(EditAnywhere, Category = "Streaming", meta = (ClampMin = "1"))
+	int32 StreamingMemoryBudgetMB = 256;
+
+	//Cells around the source and destination a query may search beyond the box that holds them
+	UPROPERTY(EditAnywhere, Category = "Streaming", meta = (ClampMin = "0"))
+	int32 StreamingWindowMargin = 32;
+
+	//Tiles within this distance of a player's pawn are sampled ahead of queries
+	UPROPERTY(EditAnywhere, Category = "Streaming", meta = (ClampMin = "0"))
+	float StreamingPrefetchRadius = 5000.f;
+
+	//Tiles sampled ahead of queries each frame
+	UPROPERTY(EditAnywhere, Category = "Streaming", meta = (ClampMin = "0"))
+	int32 StreamingTilesPerTick = 4;
+
 	// Sets default values for this actor's properties
 	AQuantizer();
 
 protected:
 
-	TMap<FIntVector2, FQuantizedSpace> CachedHeightmap;
+	//Sampled heights of every grid point, replaced rather than modified so running queries keep a valid snapshot
+	FQuantizedHeightmapPtr CachedHeightmap;
+
+	//Traversable edges of CachedHeightmap for the current SampleMask and MaxAngleThreshold
+	FQuantizerEdgeMaskPtr CachedEdgeMask;
+
+	//Cluster graph of CachedEdgeMask, only built while SearchMode is Hierarchical
+	FQuantizerHierarchyPtr CachedHierarchy;
+
+	//Forced neighbors of CachedEdgeMask, only built while SearchMode is JumpPoint
+	FQuantizerJumpPointsPtr CachedJumpPoints;
+
+	//Coarse levels of CachedHeightmap, only built while SearchMode is CoarseToFine
+	FQuantizerHeightmapPyramidPtr CachedPyramid;
+
+	//Bumped every time CachedHeightmap is replaced, cached paths from older versions are stale
+	uint32 HeightmapVersion = 0;
+
+	//Results of earlier queries
+	FQuantizerPathCache PathCache;
+
+	//Tiles of the world grid while bStreamHeightmap is set, CachedHeightmap is then a window copied out of them
+	FQuantizerHeightmapTiles HeightmapTiles;
+
+	//Texels of HeightmapTexture, decoded once and resampled by every tile that is paged in
+	FQuantizerHeightfield CachedHeightfield;
+
+	//Texture CachedHeightfield was decoded from, reset to read the texture again
+	TWeakObjectPtr<UTexture2D> CachedHeightfieldTexture;
+
+	//Search workspace used by ComputePath
+	FQuantizerPathfinder Pathfinder;
+
+	//Search kept between ComputePath calls while SearchMode is Incremental
+	FQuantizerIncrementalPlanner IncrementalPlanner;
+
+	//Search workspace of the time sliced query, kept between queries so it is only allocated once per grid size
+	FQuantizerPathfinder TimeSlicedPathfinder;
+
+	//Query TimeSlicedPathfinder is working on, null when there is none
+	TSharedPtr<FQuantizerAsyncPathQuery, ESPMode::ThreadSafe> TimeSlicedQuery;
+
+	//One search workspace per worker used by ComputePaths, kept between batches so they are only allocated once
+	TArray<FQuantizerPathfinder> BatchPathfinders;
+
+	//Spline meshes DrawPath has created, the first NumVisibleSplineMeshes show the current path and the rest are hidden
+	UPROPERTY(Transient)
+	TArray<USplineMeshComponent*> SplineMeshPool;
+
+	int32 NumVisibleSplineMeshes = 0;
+
+	//Draws paths longer than InstancedPathSegments, created the first time one is drawn
+	UPROPERTY(Transient)
+	UInstancedStaticMeshComponent* PathInstances = nullptr;
+
+	//Asynchronous queries that have not finished yet, by handle id
+	TMap<int32, TSharedRef<FQuantizerAsyncPathQuery, ESPMode::ThreadSafe>> PendingPathQueries;
+
+	int32 NextPathQueryId = 1;
 
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
@@ -194,6 +454,90 @@ protected:
 	/// </summary>
 	void GenerateHeightmap();
 
+	/// <summary>
+	/// Size GridDimensions and LandscapeDimensions to the bounds of LandscapeActor
+	/// </summary>
+	/// <returns>False if there is no LandscapeActor</returns>
+	bool UpdateGridDimensions();
+
+	/// <summary>
+	/// Fill the cells of a heightmap from HeightSource, falling back to raycasts
+	/// </summary>
+	/// <param name="Heightmap">Dimensions, Resolution and Origin are set and every cell is invalid</param>
+	void SampleHeightmap(FQuantizedHeightmap& Heightmap);
+
+	/// <summary>
+	/// Put a heightmap that was just sampled, loaded or copied out of the tiles in GridLayout, then compact it if
+	/// bCompactHeights. Must happen before it is shared with any search
+	/// </summary>
+	void FinishHeightmap(FQuantizedHeightmap& Heightmap) const;
+
+	/// <summary>
+	/// Set up HeightmapTiles over the whole landscape without sampling any of it
+	/// </summary>
+	void InitHeightmapStreaming();
+
+	/// <summary>
+	/// Make CachedHeightmap a window of the streamed tiles that covers a region plus StreamingWindowMargin, the
+	/// current window is kept if it already does
+	/// </summary>
+	/// <param name="Region">World XY bounds of the query</param>
+	/// <returns>False if the window needs more tiles than StreamingMemoryBudgetMB holds</returns>
+	bool UpdateStreamingWindow(const FBox2D& Region);
+
+	/// <summary>
+	/// Sample tiles around the players' pawns, StreamingTilesPerTick at a time
+	/// </summary>
+	void PrefetchHeightmapTiles();
+
+	/// <summary>
+	/// Load the baked heightmap into CachedHeightmap
+	/// </summary>
+	/// <returns>False if there is no bake or it was made for another landscape or other settings</returns>
+	bool LoadBakedHeightmap();
+
+	/// <summary>
+	/// File BakeHeightmap writes to, staged uncooked next to the content so it can be memory mapped
+	/// </summary>
+	/// <returns></returns>
+	FString GetBakedHeightmapFilename() const;
+
+	/// <summary>
+	/// Identifies the landscape and settings the heightmap is sampled with
+	/// </summary>
+	/// <returns></returns>
+	FQuantizerBakeKey MakeBakeKey() const;
+
+	/// <summary>
+	/// Fill the heightmap by resampling HeightmapTexture, placed over LandscapeActor. The texture is only decoded when
+	/// it changed since the last call
+	/// </summary>
+	/// <param name="Heightmap"></param>
+	/// <returns>False if the texture could not be read</returns>
+	bool ImportHeightmapTexture(FQuantizedHeightmap& Heightmap);
+
+	/// <summary>
+	/// Fill the heightmap with heights looked up in the landscape's collision heightfields
+	/// </summary>
+	/// <param name="Landscape"></param>
+	/// <param name="Heightmap"></param>
+	void SampleLandscapeHeights(const ALandscapeProxy& Landscape, FQuantizedHeightmap& Heightmap);
+
+	/// <summary>
+	/// Trace every cell of the heightmap, tiles of SampleTileSize cells are traced concurrently
+	/// </summary>
+	/// <param name="Heightmap"></param>
+	void SampleHeightmapTiles(FQuantizedHeightmap& Heightmap);
+
+	/// <summary>
+	/// Raycast down from StartLocation to the terrain, safe to call from worker threads
+	/// </summary>
+	/// <param name="World"></param>
+	/// <param name="StartLocation"></param>
+	/// <param name="OutHeight"></param>
+	/// <returns>Whether the trace hit</returns>
+	bool TraceTerrainHeight(const UWorld& World, FIntVector StartLocation, float& OutHeight) const;
+
 	/// <summary>
 	/// Sample terrain at location and store quantized result in OutResult
 	/// </summary>
@@ -206,6 +550,14 @@ public:
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
+#if WITH_EDITOR
+	/// <summary>
+	/// Sample the heightmap in the editor world and save it to GetBakedHeightmapFilename for BeginPlay to load
+	/// </summary>
+	UFUNCTION(CallInEditor, Category = "Heightmap")
+	void BakeHeightmap();
+#endif
+
 	/// <summary>
 	/// Evaluates a given point in terms of heightmap grid points, rounds to the point that corresponds to the cell the Location resides within
 	/// </summary>
@@ -215,10 +567,11 @@ public:
 	FQuantizedSpace Quantize(FVector Location);
 
 	/// <summary>
-	/// Pops the lowest cost node off the Frontier
+	/// Heightmap index of the cell the Location resides within
 	/// </summary>
-	/// <returns></returns>
-	FAStarNode PopLowestCostNode();
+	/// <param name="Location"></param>
+	/// <returns>INDEX_NONE if the cell is out of range or has no height</returns>
+	int32 QuantizeToIndex(const FVector& Location) const;
 
 	/// <summary>
 	/// Compute the path between source and destination vectors
@@ -230,19 +583,118 @@ public:
 	bool ComputePath(FVector Source, FVector Destination);
 
 	/// <summary>
-	/// Get the cost of moving to a given cell
+	/// Compute the path between source and destination vectors on a worker thread, OnPathComputed fires on the game thread when it finishes
+	/// </summary>
+	/// <param name="Source"></param>
+	/// <param name="Destination"></param>
+	/// <returns>Handle of the query, invalid if source or destination are not on the heightmap</returns>
+	UFUNCTION(BlueprintCallable)
+	FQuantizerPathHandle ComputePathAsync(FVector Source, FVector Destination);
+
+	/// <summary>
+	/// Compute the path between source and destination vectors on the game thread a slice at a time, every Tick searches
+	/// until TimeSliceBudgetMicroseconds or TimeSliceNodeBudget is used up. OnPathComputed fires when it finishes.
+	/// Only one time sliced query runs at a time, starting one cancels the previous one
+	/// </summary>
+	/// <param name="Source"></param>
+	/// <param name="Destination"></param>
+	/// <returns>Handle of the query, invalid if source or destination are not on the heightmap</returns>
+	UFUNCTION(BlueprintCallable)
+	FQuantizerPathHandle ComputePathTimeSliced(FVector Source, FVector Destination);
+
+	/// <summary>
+	/// Whether a query started with ComputePathTimeSliced is still searching
+	/// </summary>
+	UFUNCTION(BlueprintCallable)
+	bool IsTimeSlicedPathPending() const;
+
+	/// <summary>
+	/// How much closer to the destination the time sliced query has got, from 0 to 1
+	/// </summary>
+	UFUNCTION(BlueprintCallable)
+	float GetTimeSlicedPathProgress() const;
+
+	/// <summary>
+	/// Best path the time sliced query has found so far, it ends at the searched cell closest to the destination
+	/// </summary>
+	/// <param name="OutPath">Furthest grid point back to the source, source</param>
+	/// <returns>False if there is no time sliced query</returns>
+	UFUNCTION(BlueprintCallable)
+	bool GetTimeSlicedPartialPath(TArray<FVector>& OutPath) const;
+
+	/// <summary>
+	/// Compute many paths at once, queries are spread over all worker threads and share the heightmap
+	/// </summary>
+	/// <param name="Requests"></param>
+	/// <returns>One result per request, in the same order</returns>
+	UFUNCTION(BlueprintCallable)
+	TArray<FPathResult> ComputePaths(const TArray<FPathRequest>& Requests);
+
+	/// <summary>
+	/// Stop an asynchronous query, OnPathComputed will not fire for it
+	/// </summary>
+	/// <param name="Handle"></param>
+	UFUNCTION(BlueprintCallable)
+	void CancelPath(FQuantizerPathHandle Handle);
+
+	/// <summary>
+	/// Stop every asynchronous query that has not finished yet
+	/// </summary>
+	UFUNCTION(BlueprintCallable)
+	void CancelAllPaths();
+
+	/// <summary>
+	/// Hit counts and size of the path cache, for sizing PathCacheMemoryKB
+	/// </summary>
+	UFUNCTION(BlueprintCallable)
+	FQuantizerPathCacheStats GetPathCacheStats() const;
+
+	/// <summary>
+	/// Remove every cached path and reset the hit counts
+	/// </summary>
+	UFUNCTION(BlueprintCallable)
+	void ClearPathCache();
+
+	/// <summary>
+	/// Trace the cells inside a region again after the terrain there changed, the edge mask and hierarchy are only
+	/// rebuilt around the region
+	/// </summary>
+	/// <param name="RegionMin"></param>
+	/// <param name="RegionMax"></param>
+	UFUNCTION(BlueprintCallable)
+	void RefreshHeightmapRegion(FVector RegionMin, FVector RegionMax);
+
+	/// <summary>
+	/// Search settings copied from this actor's properties, along with an edge mask that matches them
 	/// </summary>
-	/// <param name="Current"></param>
-	/// <param name="Next"></param>
 	/// <returns></returns>
-	float CostFunction(const FAStarNode& Current, FAStarNode& Next) const;
+	FQuantizerSearchParams MakeSearchParams();
 
 	/// <summary>
-	/// Get the distance between current cell and goal, uses euclidean distance (as the crow flies)
+	/// Smoothing settings copied from this actor's properties
 	/// </summary>
-	/// <param name="Current"></param>
 	/// <returns></returns>
-	float GoalFunction(FIntVector2 Current) const;
+	FQuantizerSmoothingParams MakeSmoothingParams() const;
+
+	/// <summary>
+	/// Rebuild CachedEdgeMask if the heightmap, SampleMask or MaxAngleThreshold changed since it was built
+	/// </summary>
+	void UpdateEdgeMask();
+
+	/// <summary>
+	/// Rebuild CachedHierarchy if the edge mask, LengthCostWeight or HierarchyClusterSize changed since it was built
+	/// </summary>
+	void UpdateHierarchy();
+
+	/// <summary>
+	/// Rebuild CachedJumpPoints if the edge mask changed since it was built
+	/// </summary>
+	void UpdateJumpPoints();
+
+	/// <summary>
+	/// Rebuild CachedPyramid if the edge mask or PyramidLevels changed since it was built
+	/// </summary>
+	void UpdatePyramid();
 
 	/// <summary>
 	/// Whether or not the passed grid point is in range
@@ -252,21 +704,76 @@ public:
 	bool IsGridPointValid(FIntVector2 GridPoint) const;
 	
 	/// <summary>
-	/// Use grid mask to generate A* successors
+	/// Convert cells returned by a search into the world space Path format: destination, grid points back to the source, source
 	/// </summary>
-	/// <param name="GridMask"></param>
-	/// <param name="Current"></param>
-	void GenerateSuccessors(const FGridMask& GridMask, const FAStarNode& Current, const FQuantizedSpace& Goal);
+	/// <param name="Heightmap"></param>
+	/// <param name="Cells">Left as the search returned them, the cache stores unsmoothed paths</param>
+	/// <param name="Source"></param>
+	/// <param name="Destination"></param>
+	/// <param name="Smoothing"></param>
+	/// <param name="OutPath"></param>
+	static void BuildWorldPath(const FQuantizedHeightmap& Heightmap, const TArray<int32>& Cells, const FVector& Source, const FVector& Destination, const FQuantizerSmoothingParams& Smoothing, TArray<FVector>& OutPath);
 
 	/// <summary>
-	/// Trace back path from the current node to the start
+	/// Draws path with spline
 	/// </summary>
-	/// <param name="LastNode"></param>
+	void DrawPath();
+
+	/// <summary>
+	/// Bend one pooled spline mesh along each of the first NumSegments segments of the spline, hiding the rest of the pool
+	/// </summary>
+	/// <param name="NumSegments"></param>
+	void DrawSplineMeshes(int32 NumSegments);
+
+	/// <summary>
+	/// Place one straight instance of SplineMesh along each of the first NumSegments segments of the spline
+	/// </summary>
+	/// <param name="NumSegments"></param>
+	void DrawPathInstances(int32 NumSegments);
+
+protected:
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/// <summary>
+	/// Called on the game thread when the worker running an asynchronous query is done with it
+	/// </summary>
+	/// <param name="Query"></param>
+	void FinishAsyncPath(const TSharedRef<FQuantizerAsyncPathQuery, ESPMode::ThreadSafe>& Query);
+
+	/// <summary>
+	/// Key of a path between two cells with the current search settings
+	/// </summary>
+	/// <param name="PathSourceIndex"></param>
+	/// <param name="PathDestinationIndex"></param>
+	/// <param name="QuerySearchMode">Mode the path is actually searched with, SearchMode unless the query ignores it</param>
 	/// <returns></returns>
-	void TraceBackPath(const FAStarNode& LastNode, TArray<FVector>& Path);
+	FQuantizerPathCacheKey MakePathCacheKey(int32 PathSourceIndex, int32 PathDestinationIndex, EQuantizerSearchMode QuerySearchMode) const;
 
 	/// <summary>
-	/// Draws path with spline
+	/// Look up a path between two cells of the current heightmap in the path cache
 	/// </summary>
-	void DrawPath();
+	/// <param name="Key"></param>
+	/// <param name="OutCells">Cells of the path from destination back to source</param>
+	/// <returns>False if caching is off or there is no usable entry</returns>
+	bool FindCachedPath(const FQuantizerPathCacheKey& Key, TArray<int32>& OutCells);
+
+	/// <summary>
+	/// Store a search result in the path cache
+	/// </summary>
+	/// <param name="Key"></param>
+	/// <param name="Version">HeightmapVersion the search ran on</param>
+	/// <param name="Cells"></param>
+	void AddCachedPath(const FQuantizerPathCacheKey& Key, uint32 Version, const TArray<int32>& Cells);
+
+	/// <summary>
+	/// Finish a query answered by the path cache on the next game thread task, so OnPathComputed never fires before the handle is returned
+	/// </summary>
+	/// <param name="Query"></param>
+	void FinishCachedPath(const TSharedRef<FQuantizerAsyncPathQuery, ESPMode::ThreadSafe>& Query);
+
+	/// <summary>
+	/// Run the time sliced query for one frame's budget, finishes it once the search is done
+	/// </summary>
+	void StepTimeSlicedPath();
 };
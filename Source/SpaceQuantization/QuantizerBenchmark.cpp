@@ -0,0 +1,449 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "QuantizerBenchmark.h"
+
+#include "HAL/PlatformMemory.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+#include "Misc/App.h"
+#include "Misc/DateTime.h"
+
+namespace QuantizerBenchmark
+{
+	//Texels are stored around the middle of the 16-bit range so noise can go either way
+	constexpr float BaseHeight = 10000.f;
+
+	//Mazes are cut into square rooms of this many cells, walls are WallWidth cells thick
+	constexpr int32 MazeRoomSize = 8;
+	constexpr int32 WallWidth = 2;
+	constexpr uint16 WallHeight = 12000;
+
+	//Fractal noise, octaves halve in size and height
+	float FractalNoise(const FVector2D& Position, int32 NumOctaves)
+	{
+		float Height = 0;
+		float Amplitude = 1;
+		double Frequency = 1;
+
+		for (int32 Octave = 0; Octave < NumOctaves; Octave++)
+		{
+			Height += Amplitude * FMath::PerlinNoise2D(Position * Frequency);
+
+			Amplitude *= 0.5f;
+			Frequency *= 2;
+		}
+
+		return Height;
+	}
+
+	//Value below which the given fraction of the sorted samples lie
+	double Percentile(const TArray<double>& SortedSamples, double Fraction)
+	{
+		if (SortedSamples.Num() == 0)
+		{
+			return 0;
+		}
+
+		const int32 Rank = FMath::CeilToInt(Fraction * SortedSamples.Num()) - 1;
+
+		return SortedSamples[FMath::Clamp(Rank, 0, SortedSamples.Num() - 1)];
+	}
+}
+
+
+void FQuantizerBenchmark::MakeHeightfield(EQuantizerBenchmarkTerrain Terrain, int32 GridSize, int32 Seed, FQuantizerHeightfield& OutHeightfield)
+{
+	using namespace QuantizerBenchmark;
+
+	FRandomStream Random(Seed);
+
+	OutHeightfield.Size = FIntPoint(GridSize, GridSize);
+	OutHeightfield.WorldOrigin = FVector2D::ZeroVector;
+	OutHeightfield.TexelSpacing = FVector2D(Resolution, Resolution);
+	OutHeightfield.HeightOffset = 0.f;
+	OutHeightfield.HeightScale = 1.f;
+
+	TArray<uint16>& Texels = OutHeightfield.Texels;
+	Texels.Init((uint16)BaseHeight, GridSize * GridSize);
+
+	//Moves the noise to another part of its domain for every seed
+	const FVector2D NoiseOffset(Random.FRandRange(0.f, 1000.f), Random.FRandRange(0.f, 1000.f));
+
+	switch (Terrain)
+	{
+	case EQuantizerBenchmarkTerrain::Noise:
+		//Hills 64 cells across whose steepest faces are just over the slope limit
+		for (int32 y = 0; y < GridSize; y++)
+		{
+			for (int32 x = 0; x < GridSize; x++)
+			{
+				const float Height = BaseHeight + 800.f * FractalNoise(FVector2D(x, y) / 64.0 + NoiseOffset, 4);
+				Texels[y * GridSize + x] = (uint16)FMath::Clamp(FMath::RoundToInt(Height), 0, (int32)MAX_uint16);
+			}
+		}
+		break;
+
+	case EQuantizerBenchmarkTerrain::Ridges:
+		//Sharp crests where the noise crosses zero, lowered by a second noise so some of them can be crossed
+		for (int32 y = 0; y < GridSize; y++)
+		{
+			for (int32 x = 0; x < GridSize; x++)
+			{
+				const FVector2D Position = FVector2D(x, y) + NoiseOffset * 100.0;
+
+				const float Ridge = FMath::Pow(1.f - FMath::Abs(FMath::PerlinNoise2D(Position / 96.0)), 4.f);
+				const float Passes = FMath::Clamp(0.5f + FMath::PerlinNoise2D(Position / 200.0), 0.f, 1.f);
+
+				const float Height = BaseHeight + 1500.f * Ridge * Passes;
+				Texels[y * GridSize + x] = (uint16)FMath::Clamp(FMath::RoundToInt(Height), 0, (int32)MAX_uint16);
+			}
+		}
+		break;
+
+	case EQuantizerBenchmarkTerrain::Maze:
+		CarveMaze(GridSize, Random, Texels);
+		break;
+
+	default:
+		break;
+	}
+}
+
+
+void FQuantizerBenchmark::CarveMaze(int32 GridSize, FRandomStream& Random, TArray<uint16>& Texels)
+{
+	using namespace QuantizerBenchmark;
+
+	const int32 NumRooms = GridSize / MazeRoomSize;
+
+	//Walls on the first WallWidth rows and columns of every room, and on whatever does not fit a whole room
+	for (int32 y = 0; y < GridSize; y++)
+	{
+		for (int32 x = 0; x < GridSize; x++)
+		{
+			const bool bWall = x % MazeRoomSize < WallWidth || y % MazeRoomSize < WallWidth || x >= NumRooms * MazeRoomSize || y >= NumRooms * MazeRoomSize;
+
+			if (bWall)
+			{
+				Texels[y * GridSize + x] = WallHeight;
+			}
+		}
+	}
+
+	if (NumRooms == 0)
+	{
+		return;
+	}
+
+	static const FIntPoint Directions[4] = { FIntPoint(1, 0), FIntPoint(-1, 0), FIntPoint(0, 1), FIntPoint(0, -1) };
+
+	TBitArray<> Visited(false, NumRooms * NumRooms);
+
+	TArray<FIntPoint> Stack;
+	Stack.Add(FIntPoint(0, 0));
+	Visited[0] = true;
+
+	while (Stack.Num() > 0)
+	{
+		const FIntPoint Room = Stack.Last();
+
+		FIntPoint Unvisited[4];
+		int32 NumUnvisited = 0;
+
+		for (const FIntPoint& Direction : Directions)
+		{
+			const FIntPoint Next = Room + Direction;
+
+			if (Next.X >= 0 && Next.Y >= 0 && Next.X < NumRooms && Next.Y < NumRooms && !Visited[Next.Y * NumRooms + Next.X])
+			{
+				Unvisited[NumUnvisited++] = Next;
+			}
+		}
+
+		if (NumUnvisited == 0)
+		{
+			Stack.Pop(false);
+			continue;
+		}
+
+		const FIntPoint Next = Unvisited[Random.RandRange(0, NumUnvisited - 1)];
+
+		//The wall between two rooms belongs to whichever of them is further along
+		const FIntPoint WallRoom(FMath::Max(Room.X, Next.X), FMath::Max(Room.Y, Next.Y));
+		const bool bVerticalWall = Next.X != Room.X;
+
+		for (int32 Along = WallWidth; Along < MazeRoomSize; Along++)
+		{
+			for (int32 Across = 0; Across < WallWidth; Across++)
+			{
+				const int32 x = WallRoom.X * MazeRoomSize + (bVerticalWall ? Across : Along);
+				const int32 y = WallRoom.Y * MazeRoomSize + (bVerticalWall ? Along : Across);
+
+				Texels[y * GridSize + x] = (uint16)BaseHeight;
+			}
+		}
+
+		Visited[Next.Y * NumRooms + Next.X] = true;
+		Stack.Add(Next);
+	}
+}
+
+
+FQuantizerBenchmarkResult FQuantizerBenchmark::Run(const FQuantizerBenchmarkCase& Case)
+{
+	FQuantizerBenchmarkResult Result;
+	Result.Case = Case;
+
+	FQuantizerHeightfield Heightfield;
+	MakeHeightfield(Case.Terrain, Case.GridSize, Case.Seed, Heightfield);
+
+	double StartTime = FPlatformTime::Seconds();
+
+	TSharedRef<FQuantizedHeightmap, ESPMode::ThreadSafe> NewHeightmap = MakeShared<FQuantizedHeightmap, ESPMode::ThreadSafe>();
+	NewHeightmap->Init(FIntVector2(Case.GridSize, Case.GridSize), Resolution);
+
+	FQuantizerHeightmapImport::Resample(Heightfield, NewHeightmap.Get());
+
+	//Same order as AQuantizer::FinishHeightmap
+	NewHeightmap->SetLayout(Case.Layout);
+
+	if (Case.bCompactHeights)
+	{
+		NewHeightmap->Compact();
+	}
+
+	Result.HeightmapMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	const FQuantizedHeightmapPtr Heightmap = NewHeightmap;
+
+	FQuantizerSearchParams Params;
+	Params.MaxAngleThreshold = MaxAngleThreshold;
+	Params.SearchMode = Case.SearchMode;
+	Params.Kernel = Case.Kernel;
+
+	//8-connected, what JumpPoint needs and what most maps use
+	for (int32 y = -1; y <= 1; y++)
+	{
+		for (int32 x = -1; x <= 1; x++)
+		{
+			if (x != 0 || y != 0)
+			{
+				Params.MaskPoints.Add(FIntVector2(x, y));
+			}
+		}
+	}
+
+	StartTime = FPlatformTime::Seconds();
+
+	Params.EdgeMask = FQuantizerEdgeMask::Build(Heightmap, Params.MaskPoints, Params.MaxAngleThreshold);
+
+	SIZE_T StructureBytes = 0;
+
+	switch (Case.SearchMode)
+	{
+	case EQuantizerSearchMode::Hierarchical:
+		Params.Hierarchy = FQuantizerHierarchy::Build(Heightmap, Params.EdgeMask, Params.LengthCostWeight, Params.HierarchyClusterSize);
+		StructureBytes = Params.Hierarchy.IsValid() ? Params.Hierarchy->GetAllocatedSize() : 0;
+		break;
+
+	case EQuantizerSearchMode::JumpPoint:
+		Params.JumpPoints = FQuantizerJumpPoints::Build(Heightmap, Params.EdgeMask);
+		StructureBytes = Params.JumpPoints.IsValid() ? Params.JumpPoints->GetAllocatedSize() : 0;
+		break;
+
+	case EQuantizerSearchMode::CoarseToFine:
+		Params.Pyramid = FQuantizerHeightmapPyramid::Build(Heightmap, Params.EdgeMask, 3);
+		StructureBytes = Params.Pyramid.IsValid() ? Params.Pyramid->GetAllocatedSize() : 0;
+		break;
+
+	default:
+		break;
+	}
+
+	Result.PreprocessMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	Result.CacheLinesPerExpansion = CountCacheLinesPerExpansion(*Heightmap, *Params.EdgeMask);
+
+	//Endpoints are cells that can be left, so a query does not fail on its first expansion
+	FRandomStream QueryRandom(Case.Seed + 1);
+
+	TArray<FIntPoint> Queries;
+	Queries.Reserve(Case.NumQueries);
+
+	//Endpoints are picked as cells rather than indices so every layout runs the same queries
+	const int32 MaxCell = Case.GridSize - 1;
+
+	for (int32 Attempt = 0; Queries.Num() < Case.NumQueries && Attempt < Case.NumQueries * 100; Attempt++)
+	{
+		const int32 QuerySource = Heightmap->GetIndex(QueryRandom.RandRange(0, MaxCell), QueryRandom.RandRange(0, MaxCell));
+		const int32 QueryDestination = Heightmap->GetIndex(QueryRandom.RandRange(0, MaxCell), QueryRandom.RandRange(0, MaxCell));
+
+		if (QuerySource != QueryDestination && Params.EdgeMask->GetEdges(QuerySource) != 0 && Params.EdgeMask->GetEdges(QueryDestination) != 0)
+		{
+			Queries.Add(FIntPoint(QuerySource, QueryDestination));
+		}
+	}
+
+	if (Queries.Num() == 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("No traversable cells to query in FQuantizerBenchmark::Run"));
+		return Result;
+	}
+
+	FQuantizerPathfinder Pathfinder;
+	Pathfinder.Init(Heightmap, Params);
+
+	TArray<int32> Cells;
+
+	//Workspaces are allocated by the first query, keep that out of the measurements
+	Pathfinder.FindPath(Queries[0].X, Queries[0].Y, Cells);
+
+	TArray<double> Latencies;
+	Latencies.Reserve(Queries.Num());
+
+	uint64 TotalCycles = 0;
+	int64 TotalPathCells = 0;
+
+	for (const FIntPoint& Query : Queries)
+	{
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+
+		const bool bFound = Pathfinder.FindPath(Query.X, Query.Y, Cells);
+
+		const uint64 Cycles = FPlatformTime::Cycles64() - StartCycles;
+
+		TotalCycles += Cycles;
+		Latencies.Add(FPlatformTime::ToMilliseconds64(Cycles));
+
+		Result.TotalExpansions += Pathfinder.GetNodesExpanded();
+
+		if (bFound)
+		{
+			Result.NumSucceeded++;
+			TotalPathCells += Cells.Num();
+		}
+	}
+
+	Latencies.Sort();
+
+	const double TotalMs = FPlatformTime::ToMilliseconds64(TotalCycles);
+
+	Result.ExpansionsPerQuery = (double)Result.TotalExpansions / Queries.Num();
+	Result.NsPerExpansion = Result.TotalExpansions > 0 ? TotalMs * 1e6 / Result.TotalExpansions : 0;
+	Result.MeanMs = TotalMs / Queries.Num();
+	Result.P50Ms = QuantizerBenchmark::Percentile(Latencies, 0.5);
+	Result.P99Ms = QuantizerBenchmark::Percentile(Latencies, 0.99);
+	Result.MaxMs = Latencies.Last();
+	Result.MeanPathCells = Result.NumSucceeded > 0 ? (double)TotalPathCells / Result.NumSucceeded : 0;
+
+	Result.WorkingSetBytes = Heightmap->GetAllocatedSize() + Params.EdgeMask->GetAllocatedSize() + StructureBytes + Pathfinder.GetAllocatedSize();
+	Result.PeakUsedPhysical = FPlatformMemory::GetStats().PeakUsedPhysical;
+
+	//Counted queries may have been fewer than asked for if traversable cells were hard to find
+	Result.Case.NumQueries = Queries.Num();
+
+	return Result;
+}
+
+
+double FQuantizerBenchmark::CountCacheLinesPerExpansion(const FQuantizedHeightmap& Heightmap, const FQuantizerEdgeMask& EdgeMask)
+{
+	constexpr int32 CellsPerLine = 64 / sizeof(uint32);
+
+	int64 TotalLines = 0;
+	int32 NumExpandable = 0;
+
+	TArray<int32, TInlineAllocator<FQuantizerEdgeMask::MaxMaskPoints + 1>> Lines;
+
+	for (int32 y = 0; y < Heightmap.Dimensions.Y; y++)
+	{
+		for (int32 x = 0; x < Heightmap.Dimensions.X; x++)
+		{
+			const int32 Index = Heightmap.GetIndex(x, y);
+			const uint32 Edges = EdgeMask.GetEdges(Index);
+
+			if (Edges == 0)
+			{
+				continue;
+			}
+
+			Lines.Reset();
+			Lines.Add(Index / CellsPerLine);
+
+			for (uint32 Remaining = Edges; Remaining != 0; Remaining &= Remaining - 1)
+			{
+				const FIntVector2& Offset = EdgeMask.MaskPoints[FMath::CountTrailingZeros(Remaining)];
+
+				Lines.AddUnique(Heightmap.GetIndex(x + Offset.X, y + Offset.Y) / CellsPerLine);
+			}
+
+			TotalLines += Lines.Num();
+			NumExpandable++;
+		}
+	}
+
+	return NumExpandable > 0 ? (double)TotalLines / NumExpandable : 0;
+}
+
+
+FString FQuantizerBenchmark::ToJson(const TArray<FQuantizerBenchmarkResult>& Results)
+{
+	TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+
+	//Bump whenever fields change meaning so old results are not compared against new ones
+	Root->SetNumberField(TEXT("SchemaVersion"), 3);
+	Root->SetStringField(TEXT("Timestamp"), FDateTime::UtcNow().ToIso8601());
+	Root->SetStringField(TEXT("Platform"), ANSI_TO_TCHAR(FPlatformProperties::IniPlatformName()));
+	Root->SetStringField(TEXT("BuildConfiguration"), LexToString(FApp::GetBuildConfiguration()));
+	Root->SetStringField(TEXT("BuildVersion"), FApp::GetBuildVersion());
+	Root->SetNumberField(TEXT("Resolution"), Resolution);
+	Root->SetNumberField(TEXT("MaxAngleThreshold"), MaxAngleThreshold);
+
+	TArray<TSharedPtr<FJsonValue>> Cases;
+
+	for (const FQuantizerBenchmarkResult& Result : Results)
+	{
+		Cases.Add(MakeShared<FJsonValueObject>(ResultToJson(Result)));
+	}
+
+	Root->SetArrayField(TEXT("Cases"), Cases);
+
+	FString Json;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+	FJsonSerializer::Serialize(Root, Writer);
+
+	return Json;
+}
+
+
+TSharedRef<FJsonObject> FQuantizerBenchmark::ResultToJson(const FQuantizerBenchmarkResult& Result)
+{
+	TSharedRef<FJsonObject> Object = MakeShared<FJsonObject>();
+
+	Object->SetStringField(TEXT("Terrain"), StaticEnum<EQuantizerBenchmarkTerrain>()->GetNameStringByValue((int64)Result.Case.Terrain));
+	Object->SetNumberField(TEXT("GridSize"), Result.Case.GridSize);
+	Object->SetStringField(TEXT("SearchMode"), StaticEnum<EQuantizerSearchMode>()->GetNameStringByValue((int64)Result.Case.SearchMode));
+	Object->SetNumberField(TEXT("Seed"), Result.Case.Seed);
+	Object->SetBoolField(TEXT("CompactHeights"), Result.Case.bCompactHeights);
+	Object->SetStringField(TEXT("Layout"), StaticEnum<EQuantizerGridLayout>()->GetNameStringByValue((int64)Result.Case.Layout));
+	Object->SetStringField(TEXT("Kernel"), StaticEnum<EQuantizerSuccessorKernel>()->GetNameStringByValue((int64)Result.Case.Kernel));
+	Object->SetNumberField(TEXT("NumQueries"), Result.Case.NumQueries);
+	Object->SetNumberField(TEXT("NumSucceeded"), Result.NumSucceeded);
+	Object->SetNumberField(TEXT("HeightmapMs"), Result.HeightmapMs);
+	Object->SetNumberField(TEXT("PreprocessMs"), Result.PreprocessMs);
+	Object->SetNumberField(TEXT("TotalExpansions"), (double)Result.TotalExpansions);
+	Object->SetNumberField(TEXT("ExpansionsPerQuery"), Result.ExpansionsPerQuery);
+	Object->SetNumberField(TEXT("NsPerExpansion"), Result.NsPerExpansion);
+	Object->SetNumberField(TEXT("MeanMs"), Result.MeanMs);
+	Object->SetNumberField(TEXT("P50Ms"), Result.P50Ms);
+	Object->SetNumberField(TEXT("P99Ms"), Result.P99Ms);
+	Object->SetNumberField(TEXT("MaxMs"), Result.MaxMs);
+	Object->SetNumberField(TEXT("MeanPathCells"), Result.MeanPathCells);
+	Object->SetNumberField(TEXT("CacheLinesPerExpansion"), Result.CacheLinesPerExpansion);
+	Object->SetNumberField(TEXT("WorkingSetBytes"), (double)Result.WorkingSetBytes);
+	Object->SetNumberField(TEXT("PeakUsedPhysical"), (double)Result.PeakUsedPhysical);
+
+	return Object;
+}
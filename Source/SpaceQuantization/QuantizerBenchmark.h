@@ -0,0 +1,143 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "QuantizerPathfinder.h"
+#include "QuantizerHeightmapImport.h"
+
+#include "QuantizerBenchmark.generated.h"
+
+class FJsonObject;
+
+/// <summary>
+/// Synthetic heightfields the benchmark searches over
+/// </summary>
+UENUM()
+enum class EQuantizerBenchmarkTerrain : uint8
+{
+	//Every cell at the same base height, searches run straight at the destination
+	Flat,
+	//Rolling hills of fractal noise, steep slopes are scattered obstacles
+	Noise,
+	//Ridged noise, long steep crests with passes between them
+	Ridges,
+	//Corridors between walls too steep to climb, queries wind through dead ends
+	Maze
+};
+
+/// <summary>
+/// One terrain, grid size and search mode to measure
+/// </summary>
+struct FQuantizerBenchmarkCase
+{
+	EQuantizerBenchmarkTerrain Terrain = EQuantizerBenchmarkTerrain::Flat;
+
+	//Width and height of the grid in cells
+	int32 GridSize = 256;
+
+	EQuantizerSearchMode SearchMode = EQuantizerSearchMode::AStar;
+
+	int32 NumQueries = 100;
+
+	//Seeds both the terrain and the query endpoints, the same seed always gives the same queries
+	int32 Seed = 1;
+
+	//Search 16 bit heights, as with AQuantizer::bCompactHeights
+	bool bCompactHeights = false;
+
+	EQuantizerGridLayout Layout = EQuantizerGridLayout::Linear;
+
+	EQuantizerSuccessorKernel Kernel = EQuantizerSuccessorKernel::Specialized;
+};
+
+/// <summary>
+/// Measurements of one FQuantizerBenchmarkCase
+/// </summary>
+struct FQuantizerBenchmarkResult
+{
+	FQuantizerBenchmarkCase Case;
+
+	//Resampling the heightfield into a heightmap, the HeightmapTexture path of GenerateHeightmap
+	double HeightmapMs = 0;
+
+	//Building the edge mask and whatever the search mode needs on top of it
+	double PreprocessMs = 0;
+
+	int32 NumSucceeded = 0;
+
+	int64 TotalExpansions = 0;
+	double ExpansionsPerQuery = 0;
+	double NsPerExpansion = 0;
+
+	//Latency of single queries
+	double MeanMs = 0;
+	double P50Ms = 0;
+	double P99Ms = 0;
+	double MaxMs = 0;
+
+	//Cells of found paths, before smoothing
+	double MeanPathCells = 0;
+
+	//64 byte lines of a 4 byte per-cell array, like the search state or edge mask, that expanding a cell touches on
+	//average. A property of the layout and mask, not measured with hardware counters
+	double CacheLinesPerExpansion = 0;
+
+	//Heightmap, edge mask, mode structures and search workspace once every query has run
+	uint64 WorkingSetBytes = 0;
+
+	//Peak physical memory of the whole process so far
+	uint64 PeakUsedPhysical = 0;
+};
+
+/// <summary>
+/// Headless measurements of the search core on synthetic terrain, no world or landscape needed
+/// </summary>
+class SPACEQUANTIZATION_API FQuantizerBenchmark
+{
+public:
+
+	//Units between grid points of the synthetic terrain
+	static constexpr int32 Resolution = 100;
+
+	//Slope limit of the benchmark searches, the synthetic terrains are scaled around it
+	static constexpr float MaxAngleThreshold = 15.f;
+
+	/// <summary>
+	/// Generate a square 16-bit heightfield with one texel per grid point
+	/// </summary>
+	/// <param name="Terrain"></param>
+	/// <param name="GridSize"></param>
+	/// <param name="Seed"></param>
+	/// <param name="OutHeightfield"></param>
+	static void MakeHeightfield(EQuantizerBenchmarkTerrain Terrain, int32 GridSize, int32 Seed, FQuantizerHeightfield& OutHeightfield);
+
+	/// <summary>
+	/// Build the terrain and run the case's queries one after another on the calling thread
+	/// </summary>
+	/// <param name="Case"></param>
+	/// <returns></returns>
+	static FQuantizerBenchmarkResult Run(const FQuantizerBenchmarkCase& Case);
+
+	/// <summary>
+	/// Results as a JSON document, along with the build and platform they were measured on
+	/// </summary>
+	/// <param name="Results"></param>
+	/// <returns></returns>
+	static FString ToJson(const TArray<FQuantizerBenchmarkResult>& Results);
+
+private:
+
+	/// <summary>
+	/// Average number of cache lines a cell and its traversable neighbors span in a 4 byte per-cell array
+	/// </summary>
+	static double CountCacheLinesPerExpansion(const FQuantizedHeightmap& Heightmap, const FQuantizerEdgeMask& EdgeMask);
+
+	/// <summary>
+	/// Knock passages through a grid of walls with a randomized depth first search, every corridor is reachable
+	/// </summary>
+	static void CarveMaze(int32 GridSize, FRandomStream& Random, TArray<uint16>& Texels);
+
+	static TSharedRef<FJsonObject> ResultToJson(const FQuantizerBenchmarkResult& Result);
+};
@@ -0,0 +1,146 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "QuantizerBenchmarkCommandlet.h"
+
+#include "QuantizerBenchmark.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+UQuantizerBenchmarkCommandlet::UQuantizerBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+
+int32 UQuantizerBenchmarkCommandlet::Main(const FString& Params)
+{
+	TArray<FQuantizerBenchmarkCase> Cases;
+
+	int32 NumQueries = 200;
+	FParse::Value(*Params, TEXT("queries="), NumQueries);
+
+	int32 Seed = 1;
+	FParse::Value(*Params, TEXT("seed="), Seed);
+
+	const bool bCompactHeights = FParse::Param(*Params, TEXT("compact"));
+
+	const UEnum* TerrainEnum = StaticEnum<EQuantizerBenchmarkTerrain>();
+	const UEnum* ModeEnum = StaticEnum<EQuantizerSearchMode>();
+	const UEnum* LayoutEnum = StaticEnum<EQuantizerGridLayout>();
+	const UEnum* KernelEnum = StaticEnum<EQuantizerSuccessorKernel>();
+
+	TArray<EQuantizerSuccessorKernel> Kernels;
+
+	for (const FString& KernelName : ParseList(Params, TEXT("kernels="), TEXT("Specialized")))
+	{
+		const int64 Kernel = KernelEnum->GetValueByNameString(KernelName);
+
+		if (Kernel == INDEX_NONE)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Unknown kernel %s in UQuantizerBenchmarkCommandlet::Main"), *KernelName);
+			return 1;
+		}
+
+		Kernels.Add((EQuantizerSuccessorKernel)Kernel);
+	}
+
+	for (const FString& TerrainName : ParseList(Params, TEXT("terrains="), TEXT("Flat,Noise,Ridges,Maze")))
+	{
+		const int64 Terrain = TerrainEnum->GetValueByNameString(TerrainName);
+
+		if (Terrain == INDEX_NONE)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Unknown terrain %s in UQuantizerBenchmarkCommandlet::Main"), *TerrainName);
+			return 1;
+		}
+
+		for (const FString& Size : ParseList(Params, TEXT("sizes="), TEXT("256,512,1024")))
+		{
+			for (const FString& ModeName : ParseList(Params, TEXT("modes="), TEXT("AStar,JumpPoint,Bidirectional,Hierarchical,CoarseToFine")))
+			{
+				const int64 Mode = ModeEnum->GetValueByNameString(ModeName);
+
+				if (Mode == INDEX_NONE)
+				{
+					UE_LOG(LogTemp, Error, TEXT("Unknown search mode %s in UQuantizerBenchmarkCommandlet::Main"), *ModeName);
+					return 1;
+				}
+
+				//Layouts innermost so their results sit next to each other
+				for (const FString& LayoutName : ParseList(Params, TEXT("layouts="), TEXT("Linear,Blocked")))
+				{
+					const int64 Layout = LayoutEnum->GetValueByNameString(LayoutName);
+
+					if (Layout == INDEX_NONE)
+					{
+						UE_LOG(LogTemp, Error, TEXT("Unknown layout %s in UQuantizerBenchmarkCommandlet::Main"), *LayoutName);
+						return 1;
+					}
+
+					for (EQuantizerSuccessorKernel Kernel : Kernels)
+					{
+						FQuantizerBenchmarkCase& Case = Cases.AddDefaulted_GetRef();
+						Case.Terrain = (EQuantizerBenchmarkTerrain)Terrain;
+						Case.GridSize = FMath::Max(FCString::Atoi(*Size), 8);
+						Case.SearchMode = (EQuantizerSearchMode)Mode;
+						Case.NumQueries = FMath::Max(NumQueries, 1);
+						Case.Seed = Seed;
+						Case.bCompactHeights = bCompactHeights;
+						Case.Layout = (EQuantizerGridLayout)Layout;
+						Case.Kernel = Kernel;
+					}
+				}
+			}
+		}
+	}
+
+	TArray<FQuantizerBenchmarkResult> Results;
+
+	for (const FQuantizerBenchmarkCase& Case : Cases)
+	{
+		const FQuantizerBenchmarkResult& Result = Results.Add_GetRef(FQuantizerBenchmark::Run(Case));
+
+		UE_LOG(LogTemp, Display, TEXT("%-6s %5i %-13s %-7s %-11s %4i/%-4i found  %10.1f expansions/query  %7.1f ns/expansion  %4.2f lines/expansion  p50 %8.3f ms  p99 %8.3f ms  %8llu KB"),
+			*TerrainEnum->GetNameStringByValue((int64)Case.Terrain), Case.GridSize, *ModeEnum->GetNameStringByValue((int64)Case.SearchMode),
+			*LayoutEnum->GetNameStringByValue((int64)Case.Layout), *KernelEnum->GetNameStringByValue((int64)Case.Kernel), Result.NumSucceeded, Result.Case.NumQueries, Result.ExpansionsPerQuery,
+			Result.NsPerExpansion, Result.CacheLinesPerExpansion, Result.P50Ms, Result.P99Ms, Result.WorkingSetBytes / 1024);
+	}
+
+	FString Filename;
+
+	if (!FParse::Value(*Params, TEXT("out="), Filename))
+	{
+		Filename = FPaths::ProjectSavedDir() / TEXT("Benchmarks") / FString::Printf(TEXT("Quantizer_%s.json"), *FDateTime::Now().ToString());
+	}
+
+	if (!FFileHelper::SaveStringToFile(FQuantizerBenchmark::ToJson(Results), *Filename))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Could not write benchmark results to %s"), *Filename);
+		return 1;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Wrote %i benchmark results to %s"), Results.Num(), *Filename);
+
+	return 0;
+}
+
+
+TArray<FString> UQuantizerBenchmarkCommandlet::ParseList(const FString& Params, const TCHAR* Switch, const TCHAR* Default)
+{
+	FString Value;
+
+	//Commas separate the values, not the switches
+	if (!FParse::Value(*Params, Switch, Value, false))
+	{
+		Value = Default;
+	}
+
+	TArray<FString> Values;
+	Value.ParseIntoArray(Values, TEXT(","));
+
+	return Values;
+}
@@ -0,0 +1,37 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+
+#include "QuantizerBenchmarkCommandlet.generated.h"
+
+/// <summary>
+/// Runs FQuantizerBenchmark without opening a map and writes the results as JSON, for tracking search performance
+/// between versions:
+///
+/// UnrealEditor-Cmd SpaceQuantization.uproject -run=QuantizerBenchmark -nullrhi -unattended
+///     [-terrains=Flat,Noise,Ridges,Maze] [-sizes=256,512,1024] [-modes=AStar,JumpPoint,Bidirectional,Hierarchical,CoarseToFine]
+///     [-layouts=Linear,Blocked] [-kernels=Specialized,Vector,Scalar] [-queries=200] [-seed=1] [-compact] [-out=Saved/Benchmarks/Quantizer.json]
+///
+/// For hardware cache miss counts run one layout at a time under perf stat -e cache-misses, or VTune on Windows
+/// </summary>
+UCLASS()
+class UQuantizerBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UQuantizerBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+
+	/// <summary>
+	/// Comma separated values of a switch, or the defaults if it is missing
+	/// </summary>
+	static TArray<FString> ParseList(const FString& Params, const TCHAR* Switch, const TCHAR* Default);
+};
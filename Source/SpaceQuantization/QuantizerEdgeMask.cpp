@@ -0,0 +1,168 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "QuantizerEdgeMask.h"
+
+#include "Async/ParallelFor.h"
+
+FQuantizerEdgeMaskPtr FQuantizerEdgeMask::Build(const FQuantizedHeightmapPtr& InHeightmap, const TArray<FIntVector2>& InMaskPoints, float InMaxAngleThreshold)
+{
+	if (!InHeightmap.IsValid())
+	{
+		return nullptr;
+	}
+
+	if (InMaskPoints.Num() > MaxMaskPoints)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("SampleMask has %i points, only the first %i are used"), InMaskPoints.Num(), MaxMaskPoints);
+	}
+
+	TSharedRef<FQuantizerEdgeMask, ESPMode::ThreadSafe> EdgeMask = MakeShared<FQuantizerEdgeMask, ESPMode::ThreadSafe>();
+	EdgeMask->Heightmap = InHeightmap;
+	EdgeMask->MaskPoints = InMaskPoints;
+	EdgeMask->MaxAngleThreshold = InMaxAngleThreshold;
+
+	EdgeMask->Edges.SetNumZeroed(InHeightmap->Num());
+	EdgeMask->BuildEdges(*InHeightmap, FIntRect(0, 0, InHeightmap->Dimensions.X, InHeightmap->Dimensions.Y));
+
+	return EdgeMask;
+}
+
+
+FQuantizerEdgeMaskPtr FQuantizerEdgeMask::FromLinearEdges(const FQuantizedHeightmapPtr& InHeightmap, const TArray<FIntVector2>& InMaskPoints, float InMaxAngleThreshold, const TArray<uint32>& LinearEdges)
+{
+	if (!InHeightmap.IsValid() || LinearEdges.Num() != InHeightmap->Dimensions.X * InHeightmap->Dimensions.Y)
+	{
+		return nullptr;
+	}
+
+	TSharedRef<FQuantizerEdgeMask, ESPMode::ThreadSafe> EdgeMask = MakeShared<FQuantizerEdgeMask, ESPMode::ThreadSafe>();
+	EdgeMask->Heightmap = InHeightmap;
+	EdgeMask->MaskPoints = InMaskPoints;
+	EdgeMask->MaxAngleThreshold = InMaxAngleThreshold;
+
+	const FQuantizedHeightmap& Grid = *InHeightmap;
+
+	EdgeMask->Edges.SetNumZeroed(Grid.Num());
+
+	for (int32 y = 0; y < Grid.Dimensions.Y; y++)
+	{
+		for (int32 x = 0; x < Grid.Dimensions.X; x++)
+		{
+			EdgeMask->Edges[Grid.GetIndex(x, y)] = LinearEdges[y * Grid.Dimensions.X + x];
+		}
+	}
+
+	return EdgeMask;
+}
+
+
+void FQuantizerEdgeMask::GetLinearEdges(const FQuantizedHeightmap& Grid, TArray<uint32>& OutLinearEdges) const
+{
+	OutLinearEdges.SetNumUninitialized(Grid.Dimensions.X * Grid.Dimensions.Y);
+
+	for (int32 y = 0; y < Grid.Dimensions.Y; y++)
+	{
+		for (int32 x = 0; x < Grid.Dimensions.X; x++)
+		{
+			OutLinearEdges[y * Grid.Dimensions.X + x] = Edges[Grid.GetIndex(x, y)];
+		}
+	}
+}
+
+
+FQuantizerEdgeMaskPtr FQuantizerEdgeMask::Rebuild(const FQuantizedHeightmapPtr& InHeightmap, const FIntRect& ChangedCells) const
+{
+	if (!InHeightmap.IsValid() || InHeightmap->Num() != Edges.Num())
+	{
+		return Build(InHeightmap, MaskPoints, MaxAngleThreshold);
+	}
+
+	TSharedRef<FQuantizerEdgeMask, ESPMode::ThreadSafe> EdgeMask = MakeShared<FQuantizerEdgeMask, ESPMode::ThreadSafe>(*this);
+	EdgeMask->Heightmap = InHeightmap;
+
+	//Cells up to the longest offset away have edges into the region
+	int32 Reach = 0;
+
+	for (const FIntVector2& Offset : MaskPoints)
+	{
+		Reach = FMath::Max(Reach, FMath::Max(FMath::Abs(Offset.X), FMath::Abs(Offset.Y)));
+	}
+
+	FIntRect Cells(ChangedCells.Min - FIntPoint(Reach), ChangedCells.Max + FIntPoint(Reach));
+	Cells.Clip(FIntRect(0, 0, InHeightmap->Dimensions.X, InHeightmap->Dimensions.Y));
+
+	EdgeMask->BuildEdges(*InHeightmap, Cells);
+
+	return EdgeMask;
+}
+
+
+void FQuantizerEdgeMask::BuildEdges(const FQuantizedHeightmap& Grid, const FIntRect& Cells)
+{
+	const int32 NumMaskPoints = FMath::Min(MaskPoints.Num(), MaxMaskPoints);
+
+	//An edge is too steep when its angle to the ground plane is above the threshold, i.e. when its rise is above
+	//tan(threshold) times its run, so the largest rise of every offset is computed once instead of an acos per edge
+	TArray<float, TInlineAllocator<MaxMaskPoints>> MaxRise;
+	MaxRise.SetNumUninitialized(NumMaskPoints);
+
+	const bool bAnySlope = MaxAngleThreshold >= 90.f;
+	const double Tangent = FMath::Tan(FMath::DegreesToRadians((double)FMath::Max(MaxAngleThreshold, 0.f)));
+
+	for (int32 i = 0; i < NumMaskPoints; i++)
+	{
+		const double Run = FVector2D(MaskPoints[i].X, MaskPoints[i].Y).Length() * Grid.Resolution;
+		MaxRise[i] = bAnySlope ? MAX_flt : (float)(Tangent * Run);
+	}
+
+	ParallelFor(Cells.Height(), [this, &Grid, &Cells, &MaxRise, NumMaskPoints](int32 Row)
+	{
+		const int32 y = Cells.Min.Y + Row;
+
+		for (int32 x = Cells.Min.X; x < Cells.Max.X; x++)
+		{
+			const int32 Index = Grid.GetIndex(x, y);
+
+			if (!Grid.IsValidIndex(Index))
+			{
+				Edges[Index] = 0;
+				continue;
+			}
+
+			const float Height = Grid.GetHeight(Index);
+
+			uint32 CellEdges = 0;
+
+			for (int32 i = 0; i < NumMaskPoints; i++)
+			{
+				const int32 NextX = x + MaskPoints[i].X;
+				const int32 NextY = y + MaskPoints[i].Y;
+
+				if (!Grid.IsCellValid(NextX, NextY))
+				{
+					continue;
+				}
+
+				if (FMath::Abs(Grid.GetHeight(Grid.GetIndex(NextX, NextY)) - Height) <= MaxRise[i])
+				{
+					CellEdges |= 1u << i;
+				}
+			}
+
+			Edges[Index] = CellEdges;
+		}
+	});
+}
+
+
+bool FQuantizerEdgeMask::Matches(const FQuantizedHeightmapPtr& InHeightmap, const TArray<FIntVector2>& InMaskPoints, float InMaxAngleThreshold) const
+{
+	return Heightmap.HasSameObject(InHeightmap.Get()) && MaxAngleThreshold == InMaxAngleThreshold && MaskPoints == InMaskPoints;
+}
+
+
+SIZE_T FQuantizerEdgeMask::GetAllocatedSize() const
+{
+	return Edges.GetAllocatedSize() + MaskPoints.GetAllocatedSize();
+}
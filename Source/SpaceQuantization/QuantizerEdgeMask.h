@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "QuantizedHeightmap.h"
+
+struct FQuantizerEdgeMask;
+
+//Edge masks are immutable like the heightmap they were built from, searches share one snapshot
+typedef TSharedPtr<const FQuantizerEdgeMask, ESPMode::ThreadSafe> FQuantizerEdgeMaskPtr;
+
+/// <summary>
+/// Traversability of every edge of the grid, precomputed once per heightmap and search settings.
+/// Each cell has one bit per mask point, set when the neighbor at that offset is valid and not too steep to move to
+/// </summary>
+struct SPACEQUANTIZATION_API FQuantizerEdgeMask
+{
+	//One bit per mask point
+	static constexpr int32 MaxMaskPoints = 32;
+
+	//Traversable edges of every cell, bit i is the edge to the cell at MaskPoints[i]
+	TArray<uint32> Edges;
+
+	//Settings the mask was built with
+	TArray<FIntVector2> MaskPoints;
+	float MaxAngleThreshold = 0.f;
+
+	/// <summary>
+	/// Test the slope of every edge of the heightmap
+	/// </summary>
+	/// <param name="InHeightmap"></param>
+	/// <param name="InMaskPoints">Only the first MaxMaskPoints are used</param>
+	/// <param name="InMaxAngleThreshold">Steepest traversable edge in degrees</param>
+	/// <returns></returns>
+	static FQuantizerEdgeMaskPtr Build(const FQuantizedHeightmapPtr& InHeightmap, const TArray<FIntVector2>& InMaskPoints, float InMaxAngleThreshold);
+
+	/// <summary>
+	/// Wrap edges that were tested earlier, such as the ones stored in a bake
+	/// </summary>
+	/// <param name="InHeightmap">Heightmap the edges were tested on, in any layout</param>
+	/// <param name="InMaskPoints"></param>
+	/// <param name="InMaxAngleThreshold"></param>
+	/// <param name="LinearEdges">Edges of every cell in row-major order, y * Dimensions.X + x</param>
+	/// <returns>Null if LinearEdges does not cover the heightmap</returns>
+	static FQuantizerEdgeMaskPtr FromLinearEdges(const FQuantizedHeightmapPtr& InHeightmap, const TArray<FIntVector2>& InMaskPoints, float InMaxAngleThreshold, const TArray<uint32>& LinearEdges);
+
+	/// <summary>
+	/// Edges of every cell in row-major order whatever the layout of the heightmap, for writing to a bake
+	/// </summary>
+	/// <param name="Grid">Heightmap the mask was built from</param>
+	/// <param name="OutLinearEdges"></param>
+	void GetLinearEdges(const FQuantizedHeightmap& Grid, TArray<uint32>& OutLinearEdges) const;
+
+	/// <summary>
+	/// Copy of this mask for a heightmap that only changed inside a region, only edges touching the region are tested again
+	/// </summary>
+	/// <param name="InHeightmap">Heightmap with the same dimensions</param>
+	/// <param name="ChangedCells">Cells whose height changed, Max is exclusive</param>
+	/// <returns></returns>
+	FQuantizerEdgeMaskPtr Rebuild(const FQuantizedHeightmapPtr& InHeightmap, const FIntRect& ChangedCells) const;
+
+	/// <summary>
+	/// Whether this mask was built from the passed heightmap and settings, a mismatch means it has to be rebuilt
+	/// </summary>
+	/// <param name="InHeightmap"></param>
+	/// <param name="InMaskPoints"></param>
+	/// <param name="InMaxAngleThreshold"></param>
+	/// <returns></returns>
+	bool Matches(const FQuantizedHeightmapPtr& InHeightmap, const TArray<FIntVector2>& InMaskPoints, float InMaxAngleThreshold) const;
+
+	/// <summary>
+	/// Whether the neighbor at MaskPoints[MaskIndex] can be moved to from the cell at Index
+	/// </summary>
+	FORCEINLINE bool IsTraversable(int32 Index, int32 MaskIndex) const
+	{
+		return (Edges[Index] >> MaskIndex) & 1u;
+	}
+
+	FORCEINLINE uint32 GetEdges(int32 Index) const
+	{
+		return Edges[Index];
+	}
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+
+	/// <summary>
+	/// Test the edges of every cell inside Cells
+	/// </summary>
+	void BuildEdges(const FQuantizedHeightmap& Grid, const FIntRect& Cells);
+
+	//Heightmap the mask was built from, only used to tell whether it is still current
+	TWeakPtr<const FQuantizedHeightmap, ESPMode::ThreadSafe> Heightmap;
+};
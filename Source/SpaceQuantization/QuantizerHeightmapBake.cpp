@@ -0,0 +1,259 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "QuantizerHeightmapBake.h"
+
+#include "HAL/PlatformFileManager.h"
+#include "HAL/FileManager.h"
+#include "Async/MappedFileHandle.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+namespace QuantizerBake
+{
+	static constexpr uint32 Magic = 0x504D4851;	//"QHMP"
+
+	//Sections are aligned so the arrays can be copied with wide loads
+	static constexpr uint64 SectionAlignment = 16;
+
+	enum class ESection : uint32
+	{
+		Heights = 0,
+		ValidCells = 1,
+		//MaxAngleThreshold, number of mask points and the mask points, empty without an edge mask
+		EdgeSettings = 2,
+		Edges = 3,
+
+		Count
+	};
+
+	struct FSection
+	{
+		uint32 Id;
+		uint32 Padding;
+		uint64 Offset;	//From the start of the file
+		uint64 Size;	//In bytes
+	};
+
+	struct FHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		FQuantizerBakeKey Key;
+		int32 DimensionsX;
+		int32 DimensionsY;
+		int32 Resolution;
+		uint32 NumSections;
+	};
+
+	static uint64 NumValidCellBytes(int32 NumCells)
+	{
+		return (uint64)FMath::DivideAndRoundUp(NumCells, 32) * sizeof(uint32);
+	}
+
+	static uint64 NumEdgeSettingsBytes(int32 NumMaskPoints)
+	{
+		return sizeof(float) + sizeof(int32) + (uint64)NumMaskPoints * sizeof(FIntVector2);
+	}
+}
+
+
+bool FQuantizerHeightmapBake::Save(const FString& Filename, const FQuantizerBakeKey& Key, const FQuantizedHeightmap& Heightmap, const FQuantizerEdgeMask* EdgeMask)
+{
+	using namespace QuantizerBake;
+
+	//Edges are reordered along with the heights
+	TArray<uint32> LinearEdges;
+	TArray<uint8> EdgeSettings;
+
+	if (EdgeMask)
+	{
+		EdgeMask->GetLinearEdges(Heightmap, LinearEdges);
+
+		const int32 NumMaskPoints = EdgeMask->MaskPoints.Num();
+
+		EdgeSettings.SetNumZeroed((int32)NumEdgeSettingsBytes(NumMaskPoints));
+		FMemory::Memcpy(EdgeSettings.GetData(), &EdgeMask->MaxAngleThreshold, sizeof(float));
+		FMemory::Memcpy(EdgeSettings.GetData() + sizeof(float), &NumMaskPoints, sizeof(int32));
+		FMemory::Memcpy(EdgeSettings.GetData() + sizeof(float) + sizeof(int32), EdgeMask->MaskPoints.GetData(), NumMaskPoints * sizeof(FIntVector2));
+	}
+
+	//Bakes always hold linear float heights so they load the same whatever is done to the heightmap afterwards
+	TOptional<FQuantizedHeightmap> Expanded;
+
+	if (Heightmap.IsCompact() || Heightmap.Layout != EQuantizerGridLayout::Linear)
+	{
+		Expanded.Emplace(Heightmap);
+		Expanded->Expand();
+		Expanded->SetLayout(EQuantizerGridLayout::Linear);
+	}
+
+	const FQuantizedHeightmap& Linear = Expanded.IsSet() ? Expanded.GetValue() : Heightmap;
+
+	FHeader Header;
+	FMemory::Memzero(Header);
+	Header.Magic = Magic;
+	Header.Version = Version;
+	Header.Key = Key;
+	Header.DimensionsX = Linear.Dimensions.X;
+	Header.DimensionsY = Linear.Dimensions.Y;
+	Header.Resolution = Linear.Resolution;
+	Header.NumSections = (uint32)ESection::Count;
+
+	//Raw bytes of every section in ESection order
+	const void* SectionData[] = { Linear.Heights.GetData(), Linear.ValidCells.GetData(), EdgeSettings.GetData(), LinearEdges.GetData() };
+	const uint64 SectionSizes[] = {
+		(uint64)Linear.Heights.Num() * sizeof(float), NumValidCellBytes(Linear.Num()),
+		(uint64)EdgeSettings.Num(), (uint64)LinearEdges.Num() * sizeof(uint32) };
+
+	FSection Sections[(uint32)ESection::Count];
+
+	uint64 Offset = Align(sizeof(FHeader) + sizeof(Sections), SectionAlignment);
+
+	for (uint32 SectionIndex = 0; SectionIndex < (uint32)ESection::Count; SectionIndex++)
+	{
+		Sections[SectionIndex].Id = SectionIndex;
+		Sections[SectionIndex].Padding = 0;
+		Sections[SectionIndex].Offset = Offset;
+		Sections[SectionIndex].Size = SectionSizes[SectionIndex];
+
+		Offset = Align(Offset + SectionSizes[SectionIndex], SectionAlignment);
+	}
+
+	TArray64<uint8> Buffer;
+	Buffer.SetNumZeroed((int64)Offset);
+
+	FMemory::Memcpy(Buffer.GetData(), &Header, sizeof(FHeader));
+	FMemory::Memcpy(Buffer.GetData() + sizeof(FHeader), Sections, sizeof(Sections));
+
+	for (uint32 SectionIndex = 0; SectionIndex < (uint32)ESection::Count; SectionIndex++)
+	{
+		FMemory::Memcpy(Buffer.GetData() + Sections[SectionIndex].Offset, SectionData[SectionIndex], Sections[SectionIndex].Size);
+	}
+
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(Filename), true);
+
+	return FFileHelper::SaveArrayToFile(Buffer, *Filename);
+}
+
+
+TSharedPtr<FQuantizedHeightmap, ESPMode::ThreadSafe> FQuantizerHeightmapBake::Load(const FString& Filename, const FQuantizerBakeKey& Key, FQuantizerBakedEdges* OutEdges)
+{
+	using namespace QuantizerBake;
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+	//Map the file when the platform allows it, files inside a pak can only be read
+	TUniquePtr<IMappedFileHandle> MappedFile(PlatformFile.OpenMapped(*Filename));
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+	TArray64<uint8> LoadedFile;
+
+	const uint8* Data = nullptr;
+	int64 Size = 0;
+
+	if (MappedFile.IsValid())
+	{
+		MappedRegion.Reset(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
+	}
+
+	if (MappedRegion.IsValid())
+	{
+		Data = MappedRegion->GetMappedPtr();
+		Size = MappedRegion->GetMappedSize();
+	}
+	else if (FFileHelper::LoadFileToArray(LoadedFile, *Filename, FILEREAD_Silent))
+	{
+		Data = LoadedFile.GetData();
+		Size = LoadedFile.Num();
+	}
+	else
+	{
+		return nullptr;
+	}
+
+	if (Size < (int64)(sizeof(FHeader) + sizeof(FSection) * (uint32)ESection::Count))
+	{
+		return nullptr;
+	}
+
+	FHeader Header;
+	FMemory::Memcpy(&Header, Data, sizeof(FHeader));
+
+	if (Header.Magic != Magic || Header.Version != Version || Header.NumSections != (uint32)ESection::Count)
+	{
+		UE_LOG(LogTemp, Display, TEXT("Baked heightmap %s is from another version"), *Filename);
+		return nullptr;
+	}
+
+	if (Header.Key != Key)
+	{
+		UE_LOG(LogTemp, Display, TEXT("Baked heightmap %s does not match the current landscape or settings"), *Filename);
+		return nullptr;
+	}
+
+	if (Header.DimensionsX <= 0 || Header.DimensionsY <= 0 || (int64)Header.DimensionsX * Header.DimensionsY > MAX_int32)
+	{
+		return nullptr;
+	}
+
+	FSection Sections[(uint32)ESection::Count];
+	FMemory::Memcpy(Sections, Data + sizeof(FHeader), sizeof(Sections));
+
+	TSharedRef<FQuantizedHeightmap, ESPMode::ThreadSafe> Heightmap = MakeShared<FQuantizedHeightmap, ESPMode::ThreadSafe>();
+	Heightmap->Init(FIntVector2(Header.DimensionsX, Header.DimensionsY), Header.Resolution);
+
+	void* SectionData[] = { Heightmap->Heights.GetData(), Heightmap->ValidCells.GetData() };
+	const uint64 SectionSizes[] = { (uint64)Heightmap->Heights.Num() * sizeof(float), NumValidCellBytes(Heightmap->Num()) };
+
+	for (uint32 SectionIndex = 0; SectionIndex < (uint32)ESection::Count; SectionIndex++)
+	{
+		const FSection& Section = Sections[SectionIndex];
+
+		if (Section.Id != SectionIndex || Section.Offset + Section.Size > (uint64)Size)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Baked heightmap %s is corrupt"), *Filename);
+			return nullptr;
+		}
+
+		//Grid sections always have the size of the grid, the edge sections are read below
+		if (SectionIndex < UE_ARRAY_COUNT(SectionData))
+		{
+			if (Section.Size != SectionSizes[SectionIndex])
+			{
+				UE_LOG(LogTemp, Warning, TEXT("Baked heightmap %s is corrupt"), *Filename);
+				return nullptr;
+			}
+
+			//Straight copy of the whole array, no per-cell parsing
+			FMemory::Memcpy(SectionData[SectionIndex], Data + Section.Offset, Section.Size);
+		}
+	}
+
+	const FSection& SettingsSection = Sections[(uint32)ESection::EdgeSettings];
+	const FSection& EdgesSection = Sections[(uint32)ESection::Edges];
+
+	if (OutEdges && SettingsSection.Size >= NumEdgeSettingsBytes(0))
+	{
+		const uint8* Settings = Data + SettingsSection.Offset;
+
+		int32 NumMaskPoints = 0;
+		FMemory::Memcpy(&OutEdges->MaxAngleThreshold, Settings, sizeof(float));
+		FMemory::Memcpy(&NumMaskPoints, Settings + sizeof(float), sizeof(int32));
+
+		const uint64 NumCells = (uint64)Header.DimensionsX * Header.DimensionsY;
+
+		if (NumMaskPoints < 0 || SettingsSection.Size != NumEdgeSettingsBytes(NumMaskPoints) || EdgesSection.Size != NumCells * sizeof(uint32))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Edge mask of baked heightmap %s is corrupt, it will be rebuilt"), *Filename);
+			return Heightmap;
+		}
+
+		OutEdges->MaskPoints.SetNumUninitialized(NumMaskPoints);
+		FMemory::Memcpy(OutEdges->MaskPoints.GetData(), Settings + sizeof(float) + sizeof(int32), NumMaskPoints * sizeof(FIntVector2));
+
+		OutEdges->Edges.SetNumUninitialized((int32)NumCells);
+		FMemory::Memcpy(OutEdges->Edges.GetData(), Data + EdgesSection.Offset, EdgesSection.Size);
+	}
+
+	return Heightmap;
+}
@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "QuantizedHeightmap.h"
+#include "QuantizerEdgeMask.h"
+
+/// <summary>
+/// Everything a baked heightmap depends on, a bake is only used when its key matches the Quantizer's exactly
+/// </summary>
+struct FQuantizerBakeKey
+{
+	uint32 LandscapeId = 0;	//Hash of the landscape's path and bounds
+	int32 Resolution = 0;
+	float SampleMaxHeight = 0;
+	float SampleMaxDepth = 0;
+	uint32 HeightSource = 0;
+	uint32 HeightSourceId = 0;	//Hash of the asset heights are read from, 0 unless it is HeightmapTexture
+
+	bool operator==(const FQuantizerBakeKey& Other) const
+	{
+		return LandscapeId == Other.LandscapeId && Resolution == Other.Resolution && SampleMaxHeight == Other.SampleMaxHeight
+			&& SampleMaxDepth == Other.SampleMaxDepth && HeightSource == Other.HeightSource && HeightSourceId == Other.HeightSourceId;
+	}
+
+	bool operator!=(const FQuantizerBakeKey& Other) const
+	{
+		return !(*this == Other);
+	}
+};
+
+/// <summary>
+/// Edge mask stored in a bake, only usable when its settings match the Quantizer's
+/// </summary>
+struct FQuantizerBakedEdges
+{
+	TArray<FIntVector2> MaskPoints;
+	float MaxAngleThreshold = 0.f;
+
+	//Row-major like the baked heights, empty if the bake has no edge mask
+	TArray<uint32> Edges;
+};
+
+/// <summary>
+/// Reads and writes heightmaps as a flat binary file: a fixed header, a section table and the raw grid arrays,
+/// so loading is a few bulk copies straight out of a memory mapped file
+/// </summary>
+struct SPACEQUANTIZATION_API FQuantizerHeightmapBake
+{
+	//Bumped whenever the layout of the file or of any section changes
+	static constexpr uint32 Version = 3;
+
+	/// <summary>
+	/// Write the heightmap to Filename
+	/// </summary>
+	/// <param name="Filename"></param>
+	/// <param name="Key"></param>
+	/// <param name="Heightmap"></param>
+	/// <param name="EdgeMask">Edges tested on Heightmap to store along with it, optional</param>
+	/// <returns>Success</returns>
+	static bool Save(const FString& Filename, const FQuantizerBakeKey& Key, const FQuantizedHeightmap& Heightmap, const FQuantizerEdgeMask* EdgeMask = nullptr);
+
+	/// <summary>
+	/// Load a heightmap written by Save
+	/// </summary>
+	/// <param name="Filename"></param>
+	/// <param name="Key"></param>
+	/// <param name="OutEdges">Receives the baked edge mask if there is one, optional</param>
+	/// <returns>Null if the file is missing, from another version or baked with a different key. Not shared yet, so it may still be compacted</returns>
+	static TSharedPtr<FQuantizedHeightmap, ESPMode::ThreadSafe> Load(const FString& Filename, const FQuantizerBakeKey& Key, FQuantizerBakedEdges* OutEdges = nullptr);
+};
@@ -0,0 +1,176 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "QuantizerHeightmapImport.h"
+
+#include "Engine/Texture2D.h"
+#include "Async/ParallelFor.h"
+
+bool FQuantizerHeightmapImport::ReadTexture(UTexture2D* Texture, FQuantizerHeightfield& OutHeightfield)
+{
+	if (Texture == nullptr)
+	{
+		return false;
+	}
+
+#if WITH_EDITORONLY_DATA
+	//Source data is the imported file at full precision, prefer it while in the editor
+	FTextureSource& TextureSource = Texture->Source;
+
+	TArray64<uint8> MipData;
+
+	if (TextureSource.IsValid() && TextureSource.GetMipData(MipData, 0))
+	{
+		const FIntPoint Size(TextureSource.GetSizeX(), TextureSource.GetSizeY());
+		const int32 NumTexels = Size.X * Size.Y;
+
+		OutHeightfield.Size = Size;
+		OutHeightfield.Texels.SetNumUninitialized(NumTexels);
+
+		switch (TextureSource.GetFormat())
+		{
+		case TSF_G16:
+			FMemory::Memcpy(OutHeightfield.Texels.GetData(), MipData.GetData(), NumTexels * sizeof(uint16));
+			return true;
+
+		case TSF_RGBA16:
+			for (int32 Texel = 0; Texel < NumTexels; Texel++)
+			{
+				OutHeightfield.Texels[Texel] = ((const uint16*)MipData.GetData())[Texel * 4];
+			}
+			return true;
+
+		case TSF_G8:
+			for (int32 Texel = 0; Texel < NumTexels; Texel++)
+			{
+				OutHeightfield.Texels[Texel] = (uint16)(MipData[Texel] * 257);
+			}
+			return true;
+
+		case TSF_BGRA8:
+			//Red channel
+			for (int32 Texel = 0; Texel < NumTexels; Texel++)
+			{
+				OutHeightfield.Texels[Texel] = (uint16)(MipData[Texel * 4 + 2] * 257);
+			}
+			return true;
+
+		default:
+			break;
+		}
+	}
+#endif
+
+	//Cooked data, only resident on the CPU for uncompressed textures that are never streamed
+	const FTexturePlatformData* PlatformData = Texture->GetPlatformData();
+
+	if (PlatformData == nullptr || PlatformData->Mips.Num() == 0)
+	{
+		return false;
+	}
+
+	const EPixelFormat Format = PlatformData->PixelFormat;
+
+	if (Format != PF_G16 && Format != PF_G8 && Format != PF_B8G8R8A8)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Heightmap texture %s has unsupported pixel format %i, use a G16 or uncompressed texture"),
+			*Texture->GetName(), (int32)Format);
+		return false;
+	}
+
+	const FTexture2DMipMap& Mip = PlatformData->Mips[0];
+	const uint8* Data = (const uint8*)Mip.BulkData.LockReadOnly();
+
+	if (Data == nullptr)
+	{
+		Mip.BulkData.Unlock();
+		return false;
+	}
+
+	const FIntPoint Size(Mip.SizeX, Mip.SizeY);
+	const int32 NumTexels = Size.X * Size.Y;
+
+	OutHeightfield.Size = Size;
+	OutHeightfield.Texels.SetNumUninitialized(NumTexels);
+
+	for (int32 Texel = 0; Texel < NumTexels; Texel++)
+	{
+		switch (Format)
+		{
+		case PF_G16:
+			OutHeightfield.Texels[Texel] = ((const uint16*)Data)[Texel];
+			break;
+
+		case PF_G8:
+			OutHeightfield.Texels[Texel] = (uint16)(Data[Texel] * 257);
+			break;
+
+		default:
+			//Red channel of B8G8R8A8
+			OutHeightfield.Texels[Texel] = (uint16)(Data[Texel * 4 + 2] * 257);
+			break;
+		}
+	}
+
+	Mip.BulkData.Unlock();
+
+	return true;
+}
+
+
+int32 FQuantizerHeightmapImport::Resample(const FQuantizerHeightfield& Heightfield, FQuantizedHeightmap& Heightmap)
+{
+	const FIntPoint Size = Heightfield.Size;
+
+	if (Size.X < 2 || Size.Y < 2 || Heightfield.Texels.Num() != Size.X * Size.Y)
+	{
+		return 0;
+	}
+
+	const FIntVector2 Dimensions = Heightmap.Dimensions;
+
+	//Rows share words of the validity bitset, so filled cells are flagged per cell and folded in afterwards
+	TArray<uint8> Filled;
+	Filled.SetNumZeroed(Heightmap.Num());
+
+	ParallelFor(Dimensions.Y, [&Heightfield, &Heightmap, &Filled, Size, Dimensions](int32 y)
+	{
+		//Texel space coordinate of this row
+		const double V = ((double)(Heightmap.Origin.Y + y) * Heightmap.Resolution - Heightfield.WorldOrigin.Y) / Heightfield.TexelSpacing.Y;
+
+		if (V < 0 || V > Size.Y - 1)
+		{
+			return;
+		}
+
+		const int32 V0 = FMath::Min((int32)V, Size.Y - 2);
+		const float FracV = (float)(V - V0);
+
+		const uint16* Row0 = &Heightfield.Texels[V0 * Size.X];
+		const uint16* Row1 = Row0 + Size.X;
+
+		for (int32 x = 0; x < Dimensions.X; x++)
+		{
+			const double U = ((double)(Heightmap.Origin.X + x) * Heightmap.Resolution - Heightfield.WorldOrigin.X) / Heightfield.TexelSpacing.X;
+
+			if (U < 0 || U > Size.X - 1)
+			{
+				continue;
+			}
+
+			const int32 U0 = FMath::Min((int32)U, Size.X - 2);
+			const float FracU = (float)(U - U0);
+
+			//Bilinear blend of the four texels around the cell
+			const float Top = FMath::Lerp((float)Row0[U0], (float)Row0[U0 + 1], FracU);
+			const float Bottom = FMath::Lerp((float)Row1[U0], (float)Row1[U0 + 1], FracU);
+
+			const int32 Index = Heightmap.GetIndex(x, y);
+
+			Heightmap.Heights[Index] = Heightfield.HeightOffset + FMath::Lerp(Top, Bottom, FracV) * Heightfield.HeightScale;
+			Filled[Index] = 1;
+		}
+	});
+
+	return Heightmap.SetValidCells(Filled);
+}
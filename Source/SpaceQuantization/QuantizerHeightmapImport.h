@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "QuantizedHeightmap.h"
+
+class UTexture2D;
+
+/// <summary>
+/// A 16-bit heightfield and where it lies in the world, texel (0, 0) sits on WorldOrigin and texels are TexelSpacing units apart
+/// </summary>
+struct FQuantizerHeightfield
+{
+	FIntPoint Size = FIntPoint::ZeroValue;
+
+	TArray<uint16> Texels;
+
+	FVector2D WorldOrigin = FVector2D::ZeroVector;
+	FVector2D TexelSpacing = FVector2D::UnitVector;
+
+	//World height of a texel is HeightOffset + Texel * HeightScale
+	float HeightOffset = 0.f;
+	float HeightScale = 1.f;
+};
+
+/// <summary>
+/// Builds heightmaps from height data that already exists instead of tracing the terrain
+/// </summary>
+struct SPACEQUANTIZATION_API FQuantizerHeightmapImport
+{
+	/// <summary>
+	/// Read the top mip of a grayscale texture as 16-bit texels, 8-bit textures are widened
+	/// </summary>
+	/// <param name="Texture"></param>
+	/// <param name="OutHeightfield">Size and Texels are filled in, placement is left to the caller</param>
+	/// <returns>False if the texture data is not available on the CPU or has an unsupported format</returns>
+	static bool ReadTexture(UTexture2D* Texture, FQuantizerHeightfield& OutHeightfield);
+
+	/// <summary>
+	/// Fill every cell of the heightmap by bilinearly resampling the heightfield, cells outside of it are left invalid
+	/// </summary>
+	/// <param name="Heightfield"></param>
+	/// <param name="Heightmap"></param>
+	/// <returns>Number of cells that were filled</returns>
+	static int32 Resample(const FQuantizerHeightfield& Heightfield, FQuantizedHeightmap& Heightmap);
+};
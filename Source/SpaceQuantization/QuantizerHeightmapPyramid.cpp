@@ -0,0 +1,220 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "QuantizerHeightmapPyramid.h"
+
+#include "Async/ParallelFor.h"
+
+FQuantizerHeightmapPyramidPtr FQuantizerHeightmapPyramid::Build(const FQuantizedHeightmapPtr& InHeightmap, const FQuantizerEdgeMaskPtr& InEdgeMask, int32 InNumLevels)
+{
+	if (!InHeightmap.IsValid() || !InEdgeMask.IsValid())
+	{
+		return nullptr;
+	}
+
+	TSharedRef<FQuantizerHeightmapPyramid, ESPMode::ThreadSafe> Pyramid = MakeShared<FQuantizerHeightmapPyramid, ESPMode::ThreadSafe>();
+	Pyramid->NumLevelsRequested = InNumLevels;
+	Pyramid->Levels.Add(InHeightmap);
+	Pyramid->EdgeMasks.Add(InEdgeMask);
+
+	const float MaxAngleThreshold = InEdgeMask->MaxAngleThreshold;
+	const bool bAnySlope = MaxAngleThreshold >= 90.f;
+	const float MaxTangent = bAnySlope ? MAX_flt : (float)FMath::Tan(FMath::DegreesToRadians((double)FMath::Max(MaxAngleThreshold, 0.f)));
+
+	//Steepest rise over run inside every cell of the current level, cells of level 0 are single points
+	TArray<float> Slopes;
+	Slopes.SetNumZeroed(InHeightmap->Num());
+
+	//Pairs of the four children of a coarse cell that are a step apart, as child numbers x + 2y
+	static const int32 ChildPairs[6][2] = { { 0, 1 }, { 2, 3 }, { 0, 2 }, { 1, 3 }, { 0, 3 }, { 1, 2 } };
+
+	for (int32 Level = 1; Level <= InNumLevels; Level++)
+	{
+		const FQuantizedHeightmap& Fine = *Pyramid->Levels.Last();
+
+		const FIntVector2 Dimensions((Fine.Dimensions.X + 1) / 2, (Fine.Dimensions.Y + 1) / 2);
+
+		//Nothing left to gain from a grid this small
+		if (Dimensions.X < 2 || Dimensions.Y < 2)
+		{
+			break;
+		}
+
+		TSharedRef<FQuantizedHeightmap, ESPMode::ThreadSafe> Coarse = MakeShared<FQuantizedHeightmap, ESPMode::ThreadSafe>();
+		Coarse->Init(Dimensions, Fine.Resolution * 2, Fine.Layout);
+		Coarse->Origin = FIntVector2(Fine.Origin.X / 2, Fine.Origin.Y / 2);
+
+		TArray<float> CoarseSlopes;
+		CoarseSlopes.SetNumZeroed(Coarse->Num());
+
+		//Written by several rows at once, folded into ValidCells afterwards
+		TArray<uint8> CellFlags;
+		CellFlags.SetNumZeroed(Coarse->Num());
+
+		FQuantizedHeightmap& CoarseGrid = *Coarse;
+
+		ParallelFor(Dimensions.Y, [&Fine, &CoarseGrid, &Slopes, &CoarseSlopes, &CellFlags, MaxTangent](int32 y)
+		{
+			for (int32 x = 0; x < CoarseGrid.Dimensions.X; x++)
+			{
+				float ChildHeights[4];
+				bool bChildPresent[4];
+
+				bool bValid = true;
+				float HeightSum = 0;
+				int32 NumChildren = 0;
+				float Slope = 0;
+
+				for (int32 Child = 0; Child < 4 && bValid; Child++)
+				{
+					const int32 FineX = x * 2 + (Child & 1);
+					const int32 FineY = y * 2 + (Child >> 1);
+
+					//Cells on the far edge of an odd sized grid have fewer children
+					bChildPresent[Child] = Fine.IsInBounds(FineX, FineY);
+
+					if (!bChildPresent[Child])
+					{
+						continue;
+					}
+
+					const int32 FineIndex = Fine.GetIndex(FineX, FineY);
+
+					if (!Fine.IsValidIndex(FineIndex))
+					{
+						bValid = false;
+						break;
+					}
+
+					ChildHeights[Child] = Fine.GetHeight(FineIndex);
+					HeightSum += ChildHeights[Child];
+					NumChildren++;
+
+					Slope = FMath::Max(Slope, Slopes[FineIndex]);
+				}
+
+				if (!bValid || NumChildren == 0)
+				{
+					continue;
+				}
+
+				//Steps between the children themselves
+				for (const int32* Pair : ChildPairs)
+				{
+					if (!bChildPresent[Pair[0]] || !bChildPresent[Pair[1]])
+					{
+						continue;
+					}
+
+					const bool bDiagonal = (Pair[0] & 1) != (Pair[1] & 1) && (Pair[0] >> 1) != (Pair[1] >> 1);
+					const float Run = (bDiagonal ? UE_SQRT_2 : 1.f) * Fine.Resolution;
+
+					Slope = FMath::Max(Slope, FMath::Abs(ChildHeights[Pair[1]] - ChildHeights[Pair[0]]) / Run);
+				}
+
+				const int32 Index = CoarseGrid.GetIndex(x, y);
+
+				CoarseSlopes[Index] = Slope;
+
+				//Too steep somewhere inside, the coarse cell must not be crossed
+				if (Slope > MaxTangent)
+				{
+					continue;
+				}
+
+				CoarseGrid.Heights[Index] = HeightSum / NumChildren;
+				CellFlags[Index] = 1;
+			}
+		});
+
+		Coarse->SetValidCells(CellFlags);
+
+		Pyramid->EdgeMasks.Add(BuildCoarseEdges(Fine, *Pyramid->EdgeMasks.Last(), Coarse));
+		Pyramid->Levels.Add(Coarse);
+
+		Slopes = MoveTemp(CoarseSlopes);
+	}
+
+	return Pyramid;
+}
+
+
+FQuantizerEdgeMaskPtr FQuantizerHeightmapPyramid::BuildCoarseEdges(const FQuantizedHeightmap& Fine, const FQuantizerEdgeMask& FineEdges, const FQuantizedHeightmapPtr& Coarse)
+{
+	const FQuantizedHeightmap& CoarseGrid = *Coarse;
+	const TArray<FIntVector2>& MaskPoints = FineEdges.MaskPoints;
+	const int32 NumMaskPoints = FMath::Min(MaskPoints.Num(), FQuantizerEdgeMask::MaxMaskPoints);
+
+	TArray<uint32> LinearEdges;
+	LinearEdges.SetNumZeroed(CoarseGrid.Dimensions.X * CoarseGrid.Dimensions.Y);
+
+	ParallelFor(CoarseGrid.Dimensions.Y, [&Fine, &FineEdges, &CoarseGrid, &MaskPoints, &LinearEdges, NumMaskPoints](int32 y)
+	{
+		for (int32 x = 0; x < CoarseGrid.Dimensions.X; x++)
+		{
+			if (!CoarseGrid.IsCellValid(x, y))
+			{
+				continue;
+			}
+
+			uint32 CellEdges = 0;
+
+			for (int32 i = 0; i < NumMaskPoints; i++)
+			{
+				const FIntVector2& Offset = MaskPoints[i];
+
+				if (!CoarseGrid.IsCellValid(x + Offset.X, y + Offset.Y))
+				{
+					continue;
+				}
+
+				//A coarse offset is twice the fine one, so every child steps twice to reach the same child of the neighbor
+				bool bTraversable = true;
+
+				for (int32 Child = 0; Child < 4 && bTraversable; Child++)
+				{
+					const int32 FineX = x * 2 + (Child & 1);
+					const int32 FineY = y * 2 + (Child >> 1);
+
+					//Children missing on the far edge of an odd sized grid have no edges to check
+					if (!Fine.IsInBounds(FineX, FineY) || !Fine.IsInBounds(FineX + Offset.X * 2, FineY + Offset.Y * 2))
+					{
+						continue;
+					}
+
+					bTraversable = FineEdges.IsTraversable(Fine.GetIndex(FineX, FineY), i)
+						&& FineEdges.IsTraversable(Fine.GetIndex(FineX + Offset.X, FineY + Offset.Y), i);
+				}
+
+				if (bTraversable)
+				{
+					CellEdges |= 1u << i;
+				}
+			}
+
+			LinearEdges[y * CoarseGrid.Dimensions.X + x] = CellEdges;
+		}
+	});
+
+	return FQuantizerEdgeMask::FromLinearEdges(Coarse, MaskPoints, FineEdges.MaxAngleThreshold, LinearEdges);
+}
+
+
+bool FQuantizerHeightmapPyramid::Matches(const FQuantizedHeightmapPtr& InHeightmap, const FQuantizerEdgeMaskPtr& InEdgeMask, int32 InNumLevels) const
+{
+	return Levels.Num() > 0 && Levels[0] == InHeightmap && EdgeMasks[0] == InEdgeMask && NumLevelsRequested == InNumLevels;
+}
+
+
+SIZE_T FQuantizerHeightmapPyramid::GetAllocatedSize() const
+{
+	SIZE_T Size = Levels.GetAllocatedSize() + EdgeMasks.GetAllocatedSize();
+
+	//Level 0 belongs to whoever built the pyramid
+	for (int32 Level = 1; Level < Levels.Num(); Level++)
+	{
+		Size += Levels[Level]->GetAllocatedSize() + EdgeMasks[Level]->GetAllocatedSize();
+	}
+
+	return Size;
+}
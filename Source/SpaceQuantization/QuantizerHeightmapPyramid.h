@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "QuantizedHeightmap.h"
+#include "QuantizerEdgeMask.h"
+
+class FQuantizerHeightmapPyramid;
+
+//Pyramids are replaced rather than modified, like the heightmap they are built from
+typedef TSharedPtr<const FQuantizerHeightmapPyramid, ESPMode::ThreadSafe> FQuantizerHeightmapPyramidPtr;
+
+/// <summary>
+/// Mip chain of a heightmap for coarse-to-fine searches. Every level halves the grid, a coarse cell covers 2x2 cells of
+/// the level below and its grid point lies on the grid point of its first child. Downsampling keeps the steepest slope
+/// rather than averaging it away: a coarse cell is only valid when all of its children are valid and no step between
+/// or inside them is steeper than MaxAngleThreshold. Coarse edges come from the edges of the level below rather than
+/// from the averaged heights: a coarse step is only traversable when every child can take the same step twice into
+/// the matching child of the neighbor, so a coarse path never crosses terrain the fine grid cannot
+/// </summary>
+class SPACEQUANTIZATION_API FQuantizerHeightmapPyramid
+{
+public:
+
+	/// <summary>
+	/// Downsample a heightmap until NumLevels coarse levels are built or the grid gets too small to halve
+	/// </summary>
+	/// <param name="InHeightmap">Level 0</param>
+	/// <param name="InEdgeMask">Traversable edges of InHeightmap, coarse levels use its mask and angle threshold</param>
+	/// <param name="InNumLevels">Coarse levels to build on top of InHeightmap</param>
+	/// <returns>Null if there is no heightmap or edge mask</returns>
+	static FQuantizerHeightmapPyramidPtr Build(const FQuantizedHeightmapPtr& InHeightmap, const FQuantizerEdgeMaskPtr& InEdgeMask, int32 InNumLevels);
+
+	/// <summary>
+	/// Whether this pyramid was built from the passed data and settings
+	/// </summary>
+	bool Matches(const FQuantizedHeightmapPtr& InHeightmap, const FQuantizerEdgeMaskPtr& InEdgeMask, int32 InNumLevels) const;
+
+	/// <summary>
+	/// Number of levels including the source heightmap
+	/// </summary>
+	FORCEINLINE int32 Num() const
+	{
+		return Levels.Num();
+	}
+
+	FORCEINLINE const FQuantizedHeightmapPtr& GetLevel(int32 Level) const
+	{
+		return Levels[Level];
+	}
+
+	FORCEINLINE const FQuantizerEdgeMaskPtr& GetEdgeMask(int32 Level) const
+	{
+		return EdgeMasks[Level];
+	}
+
+	/// <summary>
+	/// Cell of a level that contains a cell of level 0
+	/// </summary>
+	static FORCEINLINE FIntVector2 GetLevelCell(const FIntVector2& Cell, int32 Level)
+	{
+		return FIntVector2(Cell.X >> Level, Cell.Y >> Level);
+	}
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+
+	/// <summary>
+	/// Edges of a coarse level, a coarse edge is blocked if any fine edge crossing the boundary in its direction is
+	/// </summary>
+	/// <param name="Fine">Level below</param>
+	/// <param name="FineEdges">Traversable edges of Fine</param>
+	/// <param name="Coarse">Level built from Fine</param>
+	/// <returns></returns>
+	static FQuantizerEdgeMaskPtr BuildCoarseEdges(const FQuantizedHeightmap& Fine, const FQuantizerEdgeMask& FineEdges, const FQuantizedHeightmapPtr& Coarse);
+
+	//Level 0 is the source heightmap, every following level halves the one before it
+	TArray<FQuantizedHeightmapPtr> Levels;
+	TArray<FQuantizerEdgeMaskPtr> EdgeMasks;
+
+	//Coarse levels that were asked for, fewer are built on small grids
+	int32 NumLevelsRequested = 0;
+};
@@ -0,0 +1,288 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "QuantizerHeightmapTiles.h"
+
+void FQuantizerHeightmapTiles::Init(FIntVector2 InGridDimensions, int32 InResolution, int32 InTileSize, FQuantizerTileSampler InSampler)
+{
+	Empty();
+
+	GridDimensions = InGridDimensions;
+	Resolution = InResolution;
+	TileSize = FMath::Max(InTileSize, 1);
+	Sampler = MoveTemp(InSampler);
+}
+
+
+void FQuantizerHeightmapTiles::SetMemoryBudget(SIZE_T InMaxBytes)
+{
+	MaxBytes = InMaxBytes;
+
+	Trim();
+}
+
+
+FIntRect FQuantizerHeightmapTiles::GetTileRect(const FIntRect& Cells) const
+{
+	const FIntRect Clipped(
+		FMath::Max(Cells.Min.X, 0), FMath::Max(Cells.Min.Y, 0),
+		FMath::Min(Cells.Max.X, GridDimensions.X), FMath::Min(Cells.Max.Y, GridDimensions.Y));
+
+	if (Clipped.Width() <= 0 || Clipped.Height() <= 0)
+	{
+		return FIntRect();
+	}
+
+	return FIntRect(
+		Clipped.Min.X / TileSize, Clipped.Min.Y / TileSize,
+		FMath::DivideAndRoundUp(Clipped.Max.X, TileSize), FMath::DivideAndRoundUp(Clipped.Max.Y, TileSize));
+}
+
+
+int32 FQuantizerHeightmapTiles::Request(const FIntRect& TileRect, int32 MaxNewTiles)
+{
+	int32 NumSampled = 0;
+
+	for (int32 y = TileRect.Min.Y; y < TileRect.Max.Y; y++)
+	{
+		for (int32 x = TileRect.Min.X; x < TileRect.Max.X; x++)
+		{
+			const FIntPoint Coord(x, y);
+
+			if (const int32* Found = Lookup.Find(Coord))
+			{
+				Touch(*Found);
+				continue;
+			}
+
+			if (NumSampled >= MaxNewTiles)
+			{
+				continue;
+			}
+
+			FindOrSample(Coord);
+			NumSampled++;
+		}
+	}
+
+	return NumSampled;
+}
+
+
+TSharedPtr<FQuantizedHeightmap, ESPMode::ThreadSafe> FQuantizerHeightmapTiles::MakeWindow(const FIntRect& Cells)
+{
+	const FIntRect TileRect = GetTileRect(Cells);
+
+	if (TileRect.Area() <= 0)
+	{
+		return nullptr;
+	}
+
+	//Every tile of the window has to stay in memory while it is copied
+	if (TileRect.Area() > GetMaxResidentTiles())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Window of %i x %i cells needs %i tiles but only %i fit in the budget in FQuantizerHeightmapTiles::MakeWindow"),
+			Cells.Width(), Cells.Height(), TileRect.Area(), GetMaxResidentTiles());
+		return nullptr;
+	}
+
+	const FIntRect Clipped(
+		FMath::Max(Cells.Min.X, 0), FMath::Max(Cells.Min.Y, 0),
+		FMath::Min(Cells.Max.X, GridDimensions.X), FMath::Min(Cells.Max.Y, GridDimensions.Y));
+
+	TSharedRef<FQuantizedHeightmap, ESPMode::ThreadSafe> Window = MakeShared<FQuantizedHeightmap, ESPMode::ThreadSafe>();
+	Window->Init(FIntVector2(Clipped.Width(), Clipped.Height()), Resolution);
+	Window->Origin = FIntVector2(Clipped.Min.X, Clipped.Min.Y);
+
+	for (int32 TileY = TileRect.Min.Y; TileY < TileRect.Max.Y; TileY++)
+	{
+		for (int32 TileX = TileRect.Min.X; TileX < TileRect.Max.X; TileX++)
+		{
+			const FQuantizedHeightmap& Tile = Tiles[FindOrSample(FIntPoint(TileX, TileY))].Heightmap;
+
+			//World cells shared by the tile and the window
+			const int32 MinX = FMath::Max(Tile.Origin.X, Clipped.Min.X);
+			const int32 MinY = FMath::Max(Tile.Origin.Y, Clipped.Min.Y);
+			const int32 MaxX = FMath::Min(Tile.Origin.X + Tile.Dimensions.X, Clipped.Max.X);
+			const int32 MaxY = FMath::Min(Tile.Origin.Y + Tile.Dimensions.Y, Clipped.Max.Y);
+
+			for (int32 y = MinY; y < MaxY; y++)
+			{
+				const int32 TileRow = Tile.GetIndex(MinX - Tile.Origin.X, y - Tile.Origin.Y);
+				const int32 WindowRow = Window->GetIndex(MinX - Clipped.Min.X, y - Clipped.Min.Y);
+
+				FMemory::Memcpy(&Window->Heights[WindowRow], &Tile.Heights[TileRow], (MaxX - MinX) * sizeof(float));
+
+				for (int32 x = 0; x < MaxX - MinX; x++)
+				{
+					Window->ValidCells[WindowRow + x] = Tile.ValidCells[TileRow + x];
+				}
+			}
+		}
+	}
+
+	return Window;
+}
+
+
+void FQuantizerHeightmapTiles::Invalidate(const FIntRect& Cells)
+{
+	const FIntRect TileRect = GetTileRect(Cells);
+
+	for (int32 y = TileRect.Min.Y; y < TileRect.Max.Y; y++)
+	{
+		for (int32 x = TileRect.Min.X; x < TileRect.Max.X; x++)
+		{
+			if (const int32* Found = Lookup.Find(FIntPoint(x, y)))
+			{
+				Remove(*Found);
+			}
+		}
+	}
+}
+
+
+void FQuantizerHeightmapTiles::Empty()
+{
+	Tiles.Empty();
+	FreeTiles.Empty();
+	Lookup.Empty();
+
+	MostRecent = INDEX_NONE;
+	LeastRecent = INDEX_NONE;
+
+	UsedBytes = 0;
+}
+
+
+int32 FQuantizerHeightmapTiles::GetMaxResidentTiles() const
+{
+	//Tiles cut short at the far edges of the world are smaller, a full tile is the worst case
+	const SIZE_T TileBytes = sizeof(FTile) + (SIZE_T)TileSize * TileSize * sizeof(float) + FMath::DivideAndRoundUp(TileSize * TileSize, 8);
+
+	return (int32)FMath::Min<SIZE_T>(MaxBytes / TileBytes, MAX_int32);
+}
+
+
+int32 FQuantizerHeightmapTiles::FindOrSample(const FIntPoint& Coord)
+{
+	if (const int32* Found = Lookup.Find(Coord))
+	{
+		Touch(*Found);
+		return *Found;
+	}
+
+	const int32 TileIndex = FreeTiles.Num() > 0 ? FreeTiles.Pop(false) : Tiles.AddDefaulted();
+
+	FTile& Tile = Tiles[TileIndex];
+	Tile.Coord = Coord;
+
+	//Tiles on the far edges of the world are cut short
+	const FIntVector2 Origin(Coord.X * TileSize, Coord.Y * TileSize);
+	const FIntVector2 Dimensions(FMath::Min(TileSize, GridDimensions.X - Origin.X), FMath::Min(TileSize, GridDimensions.Y - Origin.Y));
+
+	Tile.Heightmap.Init(Dimensions, Resolution);
+	Tile.Heightmap.Origin = Origin;
+
+	if (Sampler)
+	{
+		Sampler(Tile.Heightmap);
+	}
+
+	Lookup.Add(Coord, TileIndex);
+	Link(TileIndex);
+
+	UsedBytes += GetTileBytes(Tile.Heightmap);
+
+	Trim();
+
+	return TileIndex;
+}
+
+
+SIZE_T FQuantizerHeightmapTiles::GetTileBytes(const FQuantizedHeightmap& Heightmap)
+{
+	return sizeof(FTile) + Heightmap.GetAllocatedSize();
+}
+
+
+void FQuantizerHeightmapTiles::Touch(int32 TileIndex)
+{
+	if (TileIndex != MostRecent)
+	{
+		Unlink(TileIndex);
+		Link(TileIndex);
+	}
+}
+
+
+void FQuantizerHeightmapTiles::Link(int32 TileIndex)
+{
+	FTile& Tile = Tiles[TileIndex];
+	Tile.Newer = INDEX_NONE;
+	Tile.Older = MostRecent;
+
+	if (MostRecent != INDEX_NONE)
+	{
+		Tiles[MostRecent].Newer = TileIndex;
+	}
+
+	MostRecent = TileIndex;
+
+	if (LeastRecent == INDEX_NONE)
+	{
+		LeastRecent = TileIndex;
+	}
+}
+
+
+void FQuantizerHeightmapTiles::Unlink(int32 TileIndex)
+{
+	FTile& Tile = Tiles[TileIndex];
+
+	if (Tile.Newer != INDEX_NONE)
+	{
+		Tiles[Tile.Newer].Older = Tile.Older;
+	}
+	else
+	{
+		MostRecent = Tile.Older;
+	}
+
+	if (Tile.Older != INDEX_NONE)
+	{
+		Tiles[Tile.Older].Newer = Tile.Newer;
+	}
+	else
+	{
+		LeastRecent = Tile.Newer;
+	}
+
+	Tile.Newer = INDEX_NONE;
+	Tile.Older = INDEX_NONE;
+}
+
+
+void FQuantizerHeightmapTiles::Remove(int32 TileIndex)
+{
+	FTile& Tile = Tiles[TileIndex];
+
+	Unlink(TileIndex);
+
+	Lookup.Remove(Tile.Coord);
+
+	UsedBytes -= GetTileBytes(Tile.Heightmap);
+
+	Tile.Heightmap.Reset();
+
+	FreeTiles.Add(TileIndex);
+}
+
+
+void FQuantizerHeightmapTiles::Trim()
+{
+	while (UsedBytes > MaxBytes && LeastRecent != INDEX_NONE && LeastRecent != MostRecent)
+	{
+		Remove(LeastRecent);
+	}
+}
@@ -0,0 +1,144 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "QuantizedHeightmap.h"
+
+/// <summary>
+/// Fills in the heights of a tile, its Dimensions, Resolution and Origin are set and every cell starts out invalid
+/// </summary>
+typedef TFunction<void(FQuantizedHeightmap& Tile)> FQuantizerTileSampler;
+
+/// <summary>
+/// Heightmap of a world too large to keep in memory at once. The world grid is split into square tiles that are
+/// sampled the first time they are needed and evicted least recently used first once the tiles in memory go over the
+/// budget. Searches run on windows, dense heightmaps copied out of the tiles around a query, so resident memory is
+/// bounded by the budget rather than by the size of the world
+/// </summary>
+class SPACEQUANTIZATION_API FQuantizerHeightmapTiles
+{
+public:
+
+	/// <summary>
+	/// Forget every tile and describe the world grid tiles are cut from
+	/// </summary>
+	/// <param name="InGridDimensions">Cells of the whole world grid</param>
+	/// <param name="InResolution"></param>
+	/// <param name="InTileSize">Width of tiles in cells</param>
+	/// <param name="InSampler">Called on the game thread for every tile that is paged in</param>
+	void Init(FIntVector2 InGridDimensions, int32 InResolution, int32 InTileSize, FQuantizerTileSampler InSampler);
+
+	/// <summary>
+	/// Least recently used tiles are evicted until the tiles in memory fit
+	/// </summary>
+	void SetMemoryBudget(SIZE_T InMaxBytes);
+
+	/// <summary>
+	/// Tiles that overlap a rectangle of world cells, Max is exclusive for both
+	/// </summary>
+	FIntRect GetTileRect(const FIntRect& Cells) const;
+
+	/// <summary>
+	/// Page in the tiles of a rectangle of tiles that are not in memory yet, and mark all of them recently used
+	/// </summary>
+	/// <param name="Tiles">Max is exclusive</param>
+	/// <param name="MaxNewTiles">Stop after sampling this many tiles, so streaming can be spread over frames</param>
+	/// <returns>Number of tiles sampled</returns>
+	int32 Request(const FIntRect& Tiles, int32 MaxNewTiles = MAX_int32);
+
+	/// <summary>
+	/// Copy a rectangle of world cells out of the tiles into one heightmap, paging in any missing tiles
+	/// </summary>
+	/// <param name="Cells">Max is exclusive, clipped to the world grid</param>
+	/// <returns>Null if the rectangle needs more tiles than fit in the budget. Not shared yet, so it may still be compacted</returns>
+	TSharedPtr<FQuantizedHeightmap, ESPMode::ThreadSafe> MakeWindow(const FIntRect& Cells);
+
+	/// <summary>
+	/// Evict the tiles that overlap a rectangle of world cells so they are sampled again the next time they are needed
+	/// </summary>
+	void Invalidate(const FIntRect& Cells);
+
+	void Empty();
+
+	FORCEINLINE bool IsInitialized() const
+	{
+		return TileSize > 0;
+	}
+
+	FORCEINLINE FIntVector2 GetGridDimensions() const
+	{
+		return GridDimensions;
+	}
+
+	FORCEINLINE int32 GetTileSize() const
+	{
+		return TileSize;
+	}
+
+	/// <summary>
+	/// Number of tiles in memory
+	/// </summary>
+	FORCEINLINE int32 Num() const
+	{
+		return Lookup.Num();
+	}
+
+	FORCEINLINE SIZE_T GetUsedBytes() const
+	{
+		return UsedBytes;
+	}
+
+	/// <summary>
+	/// Most tiles that fit in the budget at once
+	/// </summary>
+	int32 GetMaxResidentTiles() const;
+
+private:
+
+	struct FTile
+	{
+		FIntPoint Coord;
+		FQuantizedHeightmap Heightmap;
+
+		//Neighbors in the recency list, INDEX_NONE at either end
+		int32 Newer = INDEX_NONE;
+		int32 Older = INDEX_NONE;
+	};
+
+	/// <summary>
+	/// Tile slot of a tile coordinate, sampled if it is not in memory
+	/// </summary>
+	int32 FindOrSample(const FIntPoint& Coord);
+
+	static SIZE_T GetTileBytes(const FQuantizedHeightmap& Heightmap);
+
+	void Touch(int32 TileIndex);
+	void Link(int32 TileIndex);
+	void Unlink(int32 TileIndex);
+	void Remove(int32 TileIndex);
+
+	/// <summary>
+	/// Evict the least recently used tiles until the tiles in memory fit, the most recent tile always stays
+	/// </summary>
+	void Trim();
+
+	FIntVector2 GridDimensions = FIntVector2(0, 0);
+	int32 Resolution = 1;
+	int32 TileSize = 0;
+
+	FQuantizerTileSampler Sampler;
+
+	//Slots of tiles, evicted ones are listed in FreeTiles and reused
+	TArray<FTile> Tiles;
+	TArray<int32> FreeTiles;
+
+	TMap<FIntPoint, int32> Lookup;
+
+	int32 MostRecent = INDEX_NONE;
+	int32 LeastRecent = INDEX_NONE;
+
+	SIZE_T UsedBytes = 0;
+	SIZE_T MaxBytes = 0;
+};
@@ -0,0 +1,452 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "QuantizerHierarchy.h"
+
+#include "QuantizerPathfinder.h"
+#include "Async/ParallelFor.h"
+
+namespace QuantizerHierarchy
+{
+	//Stretches of crossable border at least this long get an entrance at both ends instead of one in the middle
+	static constexpr int32 LongEntranceLength = 6;
+
+	static const FIntVector2 CrossingOffsets[4] = { FIntVector2(1, 0), FIntVector2(-1, 0), FIntVector2(0, 1), FIntVector2(0, -1) };
+}
+
+
+FQuantizerHierarchyPtr FQuantizerHierarchy::Build(const FQuantizedHeightmapPtr& InHeightmap, const FQuantizerEdgeMaskPtr& InEdgeMask, float InLengthCostWeight, int32 InClusterSize)
+{
+	using namespace QuantizerHierarchy;
+
+	if (!InHeightmap.IsValid() || !InEdgeMask.IsValid() || InHeightmap->IsEmpty())
+	{
+		return nullptr;
+	}
+
+	TSharedRef<FQuantizerHierarchy, ESPMode::ThreadSafe> Hierarchy = MakeShared<FQuantizerHierarchy, ESPMode::ThreadSafe>();
+	Hierarchy->Heightmap = InHeightmap;
+	Hierarchy->EdgeMask = InEdgeMask;
+	Hierarchy->LengthCostWeight = InLengthCostWeight;
+	Hierarchy->ClusterSize = FMath::Max(InClusterSize, 2);
+
+	const TArray<FIntVector2>& MaskPoints = InEdgeMask->MaskPoints;
+	const int32 NumMaskPoints = FMath::Min(MaskPoints.Num(), FQuantizerEdgeMask::MaxMaskPoints);
+
+	//Borders are only crossed orthogonally, so the mask has to be able to do that
+	for (int32 Direction = 0; Direction < 4; Direction++)
+	{
+		Hierarchy->CrossingMaskIndices[Direction] = MaskPoints.Find(CrossingOffsets[Direction]);
+
+		if (Hierarchy->CrossingMaskIndices[Direction] == INDEX_NONE || Hierarchy->CrossingMaskIndices[Direction] >= NumMaskPoints)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("SampleMask has no (%i, %i) offset, hierarchical search is not available"),
+				CrossingOffsets[Direction].X, CrossingOffsets[Direction].Y);
+			return nullptr;
+		}
+	}
+
+	Hierarchy->StepCosts.SetNumUninitialized(NumMaskPoints);
+
+	for (int32 i = 0; i < NumMaskPoints; i++)
+	{
+		Hierarchy->StepCosts[i] = FVector2f((float)MaskPoints[i].X, (float)MaskPoints[i].Y).Length() * InLengthCostWeight;
+	}
+
+	const FIntVector2 Dimensions = InHeightmap->Dimensions;
+	const int32 Size = Hierarchy->ClusterSize;
+
+	Hierarchy->NumClusters = FIntVector2(FMath::DivideAndRoundUp(Dimensions.X, Size), FMath::DivideAndRoundUp(Dimensions.Y, Size));
+
+	const int32 NumClusters = Hierarchy->NumClusters.X * Hierarchy->NumClusters.Y;
+
+	Hierarchy->Clusters.SetNum(NumClusters);
+	Hierarchy->Borders.SetNum(NumClusters * 2);
+
+	for (int32 ClusterIndex = 0; ClusterIndex < NumClusters; ClusterIndex++)
+	{
+		const FIntPoint Min((ClusterIndex % Hierarchy->NumClusters.X) * Size, (ClusterIndex / Hierarchy->NumClusters.X) * Size);
+		const FIntPoint Max(FMath::Min(Min.X + Size, Dimensions.X), FMath::Min(Min.Y + Size, Dimensions.Y));
+
+		Hierarchy->Clusters[ClusterIndex].Bounds = FIntRect(Min, Max);
+	}
+
+	//Every border and cluster only writes its own entry
+	ParallelFor(NumClusters * 2, [&Hierarchy](int32 BorderIndex)
+	{
+		Hierarchy->BuildBorder(BorderIndex / 2, BorderIndex % 2);
+	});
+
+	ParallelFor(NumClusters, [&Hierarchy](int32 ClusterIndex)
+	{
+		Hierarchy->BuildCluster(ClusterIndex);
+	});
+
+	Hierarchy->LinkGraph();
+
+	return Hierarchy;
+}
+
+
+FQuantizerHierarchyPtr FQuantizerHierarchy::Rebuild(const FQuantizedHeightmapPtr& InHeightmap, const FQuantizerEdgeMaskPtr& InEdgeMask, const FIntRect& ChangedCells) const
+{
+	if (!InHeightmap.IsValid() || !InEdgeMask.IsValid() || InHeightmap->Dimensions != Heightmap->Dimensions || InEdgeMask->MaskPoints != EdgeMask->MaskPoints)
+	{
+		return Build(InHeightmap, InEdgeMask, LengthCostWeight, ClusterSize);
+	}
+
+	TSharedRef<FQuantizerHierarchy, ESPMode::ThreadSafe> Hierarchy = MakeShared<FQuantizerHierarchy, ESPMode::ThreadSafe>(*this);
+	Hierarchy->Heightmap = InHeightmap;
+	Hierarchy->EdgeMask = InEdgeMask;
+
+	//Edges into the region start up to the longest offset away from it
+	int32 Reach = 0;
+
+	for (const FIntVector2& Offset : InEdgeMask->MaskPoints)
+	{
+		Reach = FMath::Max(Reach, FMath::Max(FMath::Abs(Offset.X), FMath::Abs(Offset.Y)));
+	}
+
+	const FIntVector2 Dimensions = InHeightmap->Dimensions;
+
+	const FIntPoint MinCluster(
+		FMath::Clamp(ChangedCells.Min.X - Reach, 0, Dimensions.X - 1) / ClusterSize,
+		FMath::Clamp(ChangedCells.Min.Y - Reach, 0, Dimensions.Y - 1) / ClusterSize);
+	const FIntPoint MaxCluster(
+		FMath::Clamp(ChangedCells.Max.X - 1 + Reach, 0, Dimensions.X - 1) / ClusterSize,
+		FMath::Clamp(ChangedCells.Max.Y - 1 + Reach, 0, Dimensions.Y - 1) / ClusterSize);
+
+	//Borders touching a changed cluster, then every cluster sharing one of those borders
+	TArray<int32> DirtyBorders;
+	TArray<int32> DirtyClusters;
+
+	for (int32 y = MinCluster.Y - 1; y <= MaxCluster.Y + 1; y++)
+	{
+		for (int32 x = MinCluster.X - 1; x <= MaxCluster.X + 1; x++)
+		{
+			if (x < 0 || y < 0 || x >= NumClusters.X || y >= NumClusters.Y)
+			{
+				continue;
+			}
+
+			const int32 ClusterIndex = y * NumClusters.X + x;
+
+			DirtyClusters.Add(ClusterIndex);
+
+			if (x <= MaxCluster.X && y >= MinCluster.Y && y <= MaxCluster.Y)
+			{
+				DirtyBorders.Add(ClusterIndex * 2);
+			}
+
+			if (y <= MaxCluster.Y && x >= MinCluster.X && x <= MaxCluster.X)
+			{
+				DirtyBorders.Add(ClusterIndex * 2 + 1);
+			}
+		}
+	}
+
+	ParallelFor(DirtyBorders.Num(), [&Hierarchy, &DirtyBorders](int32 i)
+	{
+		Hierarchy->BuildBorder(DirtyBorders[i] / 2, DirtyBorders[i] % 2);
+	});
+
+	ParallelFor(DirtyClusters.Num(), [&Hierarchy, &DirtyClusters](int32 i)
+	{
+		Hierarchy->BuildCluster(DirtyClusters[i]);
+	});
+
+	Hierarchy->LinkGraph();
+
+	UE_LOG(LogTemp, Display, TEXT("Rebuilt %i of %i clusters"), DirtyClusters.Num(), Clusters.Num());
+
+	return Hierarchy;
+}
+
+
+bool FQuantizerHierarchy::Matches(const FQuantizedHeightmapPtr& InHeightmap, const FQuantizerEdgeMaskPtr& InEdgeMask, float InLengthCostWeight, int32 InClusterSize) const
+{
+	return Heightmap == InHeightmap && EdgeMask == InEdgeMask && LengthCostWeight == InLengthCostWeight && ClusterSize == FMath::Max(InClusterSize, 2);
+}
+
+
+void FQuantizerHierarchy::BuildBorder(int32 ClusterIndex, int32 Axis)
+{
+	using namespace QuantizerHierarchy;
+
+	TArray<FQuantizerTransition>& Transitions = Borders[ClusterIndex * 2 + Axis];
+	Transitions.Reset();
+
+	const FIntPoint ClusterCoords(ClusterIndex % NumClusters.X, ClusterIndex / NumClusters.X);
+
+	//No cluster on the other side
+	if ((Axis == 0 && ClusterCoords.X + 1 >= NumClusters.X) || (Axis == 1 && ClusterCoords.Y + 1 >= NumClusters.Y))
+	{
+		return;
+	}
+
+	const FIntRect& Bounds = Clusters[ClusterIndex].Bounds;
+
+	const int32 Forward = CrossingMaskIndices[Axis * 2];
+	const int32 Backward = CrossingMaskIndices[Axis * 2 + 1];
+
+	//Walk along the border, Axis 0 walks up the last column and Axis 1 along the last row
+	const int32 Length = Axis == 0 ? Bounds.Height() : Bounds.Width();
+
+	auto GetCells = [this, &Bounds, Axis](int32 Step, int32& OutCellA, int32& OutCellB)
+	{
+		const FIntVector2 CellA = Axis == 0 ? FIntVector2(Bounds.Max.X - 1, Bounds.Min.Y + Step) : FIntVector2(Bounds.Min.X + Step, Bounds.Max.Y - 1);
+		const FIntVector2 CellB = Axis == 0 ? FIntVector2(CellA.X + 1, CellA.Y) : FIntVector2(CellA.X, CellA.Y + 1);
+
+		OutCellA = Heightmap->GetIndex(CellA);
+		OutCellB = Heightmap->GetIndex(CellB);
+	};
+
+	auto AddTransition = [this, &Transitions, &GetCells, Forward, Backward](int32 Step)
+	{
+		FQuantizerTransition Transition;
+		GetCells(Step, Transition.CellA, Transition.CellB);
+
+		Transition.CostAB = EdgeMask->IsTraversable(Transition.CellA, Forward) ? StepCosts[Forward] : MAX_flt;
+		Transition.CostBA = EdgeMask->IsTraversable(Transition.CellB, Backward) ? StepCosts[Backward] : MAX_flt;
+
+		Transitions.Add(Transition);
+	};
+
+	int32 RunStart = INDEX_NONE;
+
+	for (int32 Step = 0; Step <= Length; Step++)
+	{
+		bool bCrossable = false;
+
+		if (Step < Length)
+		{
+			int32 CellA, CellB;
+			GetCells(Step, CellA, CellB);
+
+			bCrossable = EdgeMask->IsTraversable(CellA, Forward) || EdgeMask->IsTraversable(CellB, Backward);
+		}
+
+		if (bCrossable && RunStart == INDEX_NONE)
+		{
+			RunStart = Step;
+		}
+		else if (!bCrossable && RunStart != INDEX_NONE)
+		{
+			//End of a stretch of crossable cells
+			const int32 RunLength = Step - RunStart;
+
+			if (RunLength >= LongEntranceLength)
+			{
+				AddTransition(RunStart);
+				AddTransition(Step - 1);
+			}
+			else
+			{
+				AddTransition(RunStart + RunLength / 2);
+			}
+
+			RunStart = INDEX_NONE;
+		}
+	}
+}
+
+
+void FQuantizerHierarchy::BuildCluster(int32 ClusterIndex)
+{
+	FQuantizerCluster& Cluster = Clusters[ClusterIndex];
+	Cluster.Entrances.Reset();
+
+	const FIntPoint ClusterCoords(ClusterIndex % NumClusters.X, ClusterIndex / NumClusters.X);
+
+	//Upper borders are stored with this cluster, lower borders with the neighbor below
+	for (const FQuantizerTransition& Transition : Borders[ClusterIndex * 2])
+	{
+		Cluster.Entrances.AddUnique(Transition.CellA);
+	}
+
+	for (const FQuantizerTransition& Transition : Borders[ClusterIndex * 2 + 1])
+	{
+		Cluster.Entrances.AddUnique(Transition.CellA);
+	}
+
+	if (ClusterCoords.X > 0)
+	{
+		for (const FQuantizerTransition& Transition : Borders[(ClusterIndex - 1) * 2])
+		{
+			Cluster.Entrances.AddUnique(Transition.CellB);
+		}
+	}
+
+	if (ClusterCoords.Y > 0)
+	{
+		for (const FQuantizerTransition& Transition : Borders[(ClusterIndex - NumClusters.X) * 2 + 1])
+		{
+			Cluster.Entrances.AddUnique(Transition.CellB);
+		}
+	}
+
+	const int32 NumEntrances = Cluster.Entrances.Num();
+
+	Cluster.Costs.SetNumUninitialized(NumEntrances * NumEntrances);
+
+	TArray<float> RowCosts;
+
+	//One search per entrance costs it to all the others
+	for (int32 From = 0; From < NumEntrances; From++)
+	{
+		ComputeClusterCosts(ClusterIndex, Cluster.Entrances[From], false, Cluster.Entrances, RowCosts);
+
+		FMemory::Memcpy(&Cluster.Costs[From * NumEntrances], RowCosts.GetData(), NumEntrances * sizeof(float));
+	}
+}
+
+
+void FQuantizerHierarchy::LinkGraph()
+{
+	Nodes.Reset();
+	NodeIndices.Reset();
+
+	for (int32 ClusterIndex = 0; ClusterIndex < Clusters.Num(); ClusterIndex++)
+	{
+		for (int32 Cell : Clusters[ClusterIndex].Entrances)
+		{
+			NodeIndices.Add(Cell, Nodes.Num());
+
+			FQuantizerAbstractNode& Node = Nodes.AddDefaulted_GetRef();
+			Node.Cell = Cell;
+			Node.Cluster = ClusterIndex;
+		}
+	}
+
+	//Edges inside clusters
+	for (const FQuantizerCluster& Cluster : Clusters)
+	{
+		const int32 NumEntrances = Cluster.Entrances.Num();
+
+		for (int32 From = 0; From < NumEntrances; From++)
+		{
+			FQuantizerAbstractNode& Node = Nodes[NodeIndices[Cluster.Entrances[From]]];
+
+			for (int32 To = 0; To < NumEntrances; To++)
+			{
+				const float Cost = Cluster.Costs[From * NumEntrances + To];
+
+				if (From != To && Cost != MAX_flt)
+				{
+					Node.Edges.Add({ NodeIndices[Cluster.Entrances[To]], Cost });
+				}
+			}
+		}
+	}
+
+	//Edges across borders
+	for (const TArray<FQuantizerTransition>& Transitions : Borders)
+	{
+		for (const FQuantizerTransition& Transition : Transitions)
+		{
+			const int32 NodeA = NodeIndices[Transition.CellA];
+			const int32 NodeB = NodeIndices[Transition.CellB];
+
+			if (Transition.CostAB != MAX_flt)
+			{
+				Nodes[NodeA].Edges.Add({ NodeB, Transition.CostAB });
+			}
+
+			if (Transition.CostBA != MAX_flt)
+			{
+				Nodes[NodeB].Edges.Add({ NodeA, Transition.CostBA });
+			}
+		}
+	}
+}
+
+
+void FQuantizerHierarchy::ComputeClusterCosts(int32 ClusterIndex, int32 Cell, bool bReverse, const TArray<int32>& Targets, TArray<float>& OutCosts) const
+{
+	const FIntRect& Bounds = Clusters[ClusterIndex].Bounds;
+	const int32 Width = Bounds.Width();
+	const int32 NumLocalCells = Width * Bounds.Height();
+
+	auto ToLocal = [&Bounds, Width](const FIntVector2& GridCell)
+	{
+		return (GridCell.Y - Bounds.Min.Y) * Width + (GridCell.X - Bounds.Min.X);
+	};
+
+	const TArray<FIntVector2>& MaskPoints = EdgeMask->MaskPoints;
+
+	//Dijkstra over the cells of the cluster, nodes are indexed locally so the scratch arrays stay small
+	TArray<float> Distances;
+	Distances.Init(MAX_flt, NumLocalCells);
+
+	TQuantizerIndexedHeap<FAStarNode> Open;
+	Open.Reset(NumLocalCells);
+
+	const int32 Start = ToLocal(Heightmap->GetCell(Cell));
+	Distances[Start] = 0;
+	Open.Push(FAStarNode(0, 0, Start));
+
+	while (!Open.IsEmpty())
+	{
+		const FAStarNode Current = Open.Pop();
+
+		const FIntVector2 CurrentCell(Bounds.Min.X + Current.Index % Width, Bounds.Min.Y + Current.Index / Width);
+		const int32 CurrentIndex = Heightmap->GetIndex(CurrentCell);
+
+		for (int32 i = 0; i < StepCosts.Num(); i++)
+		{
+			//Backwards searches follow edges that lead into the current cell
+			const FIntVector2 NextCell = bReverse
+				? FIntVector2(CurrentCell.X - MaskPoints[i].X, CurrentCell.Y - MaskPoints[i].Y)
+				: FIntVector2(CurrentCell.X + MaskPoints[i].X, CurrentCell.Y + MaskPoints[i].Y);
+
+			if (!Bounds.Contains(FIntPoint(NextCell.X, NextCell.Y)))
+			{
+				continue;
+			}
+
+			if (!EdgeMask->IsTraversable(bReverse ? Heightmap->GetIndex(NextCell) : CurrentIndex, i))
+			{
+				continue;
+			}
+
+			const int32 Next = ToLocal(NextCell);
+			const float Distance = Current.Cost + StepCosts[i];
+
+			if (Distance < Distances[Next])
+			{
+				Distances[Next] = Distance;
+				Open.PushOrUpdate(FAStarNode(Distance, Distance, Next));
+			}
+		}
+	}
+
+	OutCosts.SetNumUninitialized(Targets.Num());
+
+	for (int32 TargetIndex = 0; TargetIndex < Targets.Num(); TargetIndex++)
+	{
+		OutCosts[TargetIndex] = Distances[ToLocal(Heightmap->GetCell(Targets[TargetIndex]))];
+	}
+}
+
+
+SIZE_T FQuantizerHierarchy::GetAllocatedSize() const
+{
+	SIZE_T Size = Clusters.GetAllocatedSize() + Borders.GetAllocatedSize() + Nodes.GetAllocatedSize() + NodeIndices.GetAllocatedSize() + StepCosts.GetAllocatedSize();
+
+	for (const FQuantizerCluster& Cluster : Clusters)
+	{
+		Size += Cluster.Entrances.GetAllocatedSize() + Cluster.Costs.GetAllocatedSize();
+	}
+
+	for (const TArray<FQuantizerTransition>& Transitions : Borders)
+	{
+		Size += Transitions.GetAllocatedSize();
+	}
+
+	for (const FQuantizerAbstractNode& Node : Nodes)
+	{
+		Size += Node.Edges.GetAllocatedSize();
+	}
+
+	return Size;
+}
@@ -0,0 +1,174 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "QuantizedHeightmap.h"
+#include "QuantizerEdgeMask.h"
+
+class FQuantizerHierarchy;
+
+//Hierarchies are replaced rather than modified, like the heightmap they are built from
+typedef TSharedPtr<const FQuantizerHierarchy, ESPMode::ThreadSafe> FQuantizerHierarchyPtr;
+
+/// <summary>
+/// A pair of cells on either side of a cluster border that the abstract graph crosses between
+/// </summary>
+struct FQuantizerTransition
+{
+	int32 CellA;	//Cell in the lower cluster
+	int32 CellB;	//Cell in the upper cluster
+
+	//Cost of each crossing, MAX_flt if the edge is not traversable in that direction
+	float CostAB;
+	float CostBA;
+};
+
+/// <summary>
+/// Square block of cells, its entrances and the cost of moving between every pair of them inside the block
+/// </summary>
+struct FQuantizerCluster
+{
+	//Cells of the cluster, Max is exclusive
+	FIntRect Bounds;
+
+	//Cells on the cluster's side of its transitions
+	TArray<int32> Entrances;
+
+	//Entrances.Num() squared costs, row is the entrance moved from, MAX_flt if unreachable inside the cluster
+	TArray<float> Costs;
+};
+
+struct FQuantizerAbstractEdge
+{
+	int32 Target;	//Index of the node in the abstract graph
+	float Cost;
+};
+
+/// <summary>
+/// Entrance cell in the abstract graph
+/// </summary>
+struct FQuantizerAbstractNode
+{
+	int32 Cell;
+	int32 Cluster;
+	TArray<FQuantizerAbstractEdge> Edges;
+};
+
+/// <summary>
+/// Abstract graph for hierarchical pathfinding (HPA*). The grid is split into fixed size clusters, entrances are placed
+/// on every stretch of traversable cells along cluster borders and the cost between every pair of entrances of a
+/// cluster is found once with a search that stays inside the cluster. Queries search the small abstract graph and only
+/// refine the clusters on the resulting corridor
+/// </summary>
+class SPACEQUANTIZATION_API FQuantizerHierarchy
+{
+public:
+
+	/// <summary>
+	/// Build the clusters and abstract graph of a heightmap
+	/// </summary>
+	/// <param name="InHeightmap"></param>
+	/// <param name="InEdgeMask">Traversable edges of InHeightmap, its mask must contain the four orthogonal offsets</param>
+	/// <param name="InLengthCostWeight"></param>
+	/// <param name="InClusterSize">Width of clusters in cells</param>
+	/// <returns>Null if the mask cannot cross cluster borders</returns>
+	static FQuantizerHierarchyPtr Build(const FQuantizedHeightmapPtr& InHeightmap, const FQuantizerEdgeMaskPtr& InEdgeMask, float InLengthCostWeight, int32 InClusterSize);
+
+	/// <summary>
+	/// Copy of this hierarchy for a heightmap that only changed inside a region, only the clusters around the region
+	/// are rebuilt. Falls back to a full build if the grid size changed
+	/// </summary>
+	/// <param name="InHeightmap"></param>
+	/// <param name="InEdgeMask"></param>
+	/// <param name="ChangedCells">Cells whose height changed, Max is exclusive</param>
+	/// <returns></returns>
+	FQuantizerHierarchyPtr Rebuild(const FQuantizedHeightmapPtr& InHeightmap, const FQuantizerEdgeMaskPtr& InEdgeMask, const FIntRect& ChangedCells) const;
+
+	/// <summary>
+	/// Whether this hierarchy was built from the passed data and settings
+	/// </summary>
+	bool Matches(const FQuantizedHeightmapPtr& InHeightmap, const FQuantizerEdgeMaskPtr& InEdgeMask, float InLengthCostWeight, int32 InClusterSize) const;
+
+	FORCEINLINE int32 GetClusterSize() const
+	{
+		return ClusterSize;
+	}
+
+	FORCEINLINE int32 GetClusterIndex(const FIntVector2& Cell) const
+	{
+		return (Cell.Y / ClusterSize) * NumClusters.X + Cell.X / ClusterSize;
+	}
+
+	FORCEINLINE const FQuantizerCluster& GetCluster(int32 ClusterIndex) const
+	{
+		return Clusters[ClusterIndex];
+	}
+
+	FORCEINLINE const TArray<FQuantizerAbstractNode>& GetNodes() const
+	{
+		return Nodes;
+	}
+
+	/// <summary>
+	/// Abstract node of an entrance cell, INDEX_NONE if the cell is not an entrance
+	/// </summary>
+	FORCEINLINE int32 FindNode(int32 Cell) const
+	{
+		const int32* Node = NodeIndices.Find(Cell);
+		return Node ? *Node : INDEX_NONE;
+	}
+
+	/// <summary>
+	/// Cost of the cheapest path from a cell to each target without leaving the cluster
+	/// </summary>
+	/// <param name="ClusterIndex"></param>
+	/// <param name="Cell">Cell inside the cluster</param>
+	/// <param name="bReverse">Measure from each target to Cell instead</param>
+	/// <param name="Targets">Cells inside the cluster</param>
+	/// <param name="OutCosts">One cost per target, MAX_flt if unreachable</param>
+	void ComputeClusterCosts(int32 ClusterIndex, int32 Cell, bool bReverse, const TArray<int32>& Targets, TArray<float>& OutCosts) const;
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+
+	/// <summary>
+	/// Find the transitions across the upper border of a cluster in one axis, 0 is X and 1 is Y
+	/// </summary>
+	void BuildBorder(int32 ClusterIndex, int32 Axis);
+
+	/// <summary>
+	/// Gather a cluster's entrances from its four borders and cost every pair of them
+	/// </summary>
+	void BuildCluster(int32 ClusterIndex);
+
+	/// <summary>
+	/// Rebuild Nodes from the clusters and borders
+	/// </summary>
+	void LinkGraph();
+
+	FQuantizedHeightmapPtr Heightmap;
+	FQuantizerEdgeMaskPtr EdgeMask;
+
+	float LengthCostWeight = 1.f;
+	int32 ClusterSize = 32;
+
+	//Number of clusters in the X and Y axes
+	FIntVector2 NumClusters = FIntVector2(0, 0);
+
+	//Mask indices of the +X, -X, +Y and -Y offsets borders are crossed with
+	int32 CrossingMaskIndices[4];
+
+	//Cost of a step along every mask offset
+	TArray<float> StepCosts;
+
+	TArray<FQuantizerCluster> Clusters;
+
+	//Transitions across the upper X and Y borders of every cluster, two lists per cluster
+	TArray<TArray<FQuantizerTransition>> Borders;
+
+	TArray<FQuantizerAbstractNode> Nodes;
+	TMap<int32, int32> NodeIndices;
+};
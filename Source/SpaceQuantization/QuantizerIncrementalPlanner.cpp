@@ -0,0 +1,435 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "QuantizerIncrementalPlanner.h"
+
+bool FQuantizerIncrementalPlanner::FindPath(const FQuantizedHeightmapPtr& InHeightmap, const FQuantizerSearchParams& InParams, int32 SourceIndex, int32 DestinationIndex, TArray<int32>& OutCells)
+{
+	OutCells.Reset();
+	NodesExpanded = 0;
+
+	if (!InHeightmap.IsValid() || !InParams.EdgeMask.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Heightmap or edge mask is null in FQuantizerIncrementalPlanner::FindPath"));
+		return false;
+	}
+
+	//Any change to the grid or costs that did not come through UpdateTerrain invalidates the whole search
+	const bool bSameSearch = Heightmap == InHeightmap && Params.EdgeMask == InParams.EdgeMask && Params.LengthCostWeight == InParams.LengthCostWeight;
+
+	if (!bSameSearch)
+	{
+		Heightmap = InHeightmap;
+		Params = InParams;
+
+		const TArray<FIntVector2>& MaskPoints = Params.EdgeMask->MaskPoints;
+		const int32 NumMaskPoints = FMath::Min(MaskPoints.Num(), FQuantizerEdgeMask::MaxMaskPoints);
+
+		StepCosts.SetNumUninitialized(NumMaskPoints);
+
+		for (int32 i = 0; i < NumMaskPoints; i++)
+		{
+			StepCosts[i] = FVector2f((float)MaskPoints[i].X, (float)MaskPoints[i].Y).Length() * Params.LengthCostWeight;
+		}
+
+		Root = INDEX_NONE;
+	}
+
+	const int32 RootIndex = bRootIsSource ? SourceIndex : DestinationIndex;
+	const int32 TipIndex = bRootIsSource ? DestinationIndex : SourceIndex;
+
+	if (Root == INDEX_NONE || RootIndex != Root)
+	{
+		//Root the new search at whichever end did not move since the last query, the other one is likely to keep moving
+		bRootIsSource = SourceIndex == LastSourceIndex && DestinationIndex != LastDestinationIndex;
+
+		Initialize(bRootIsSource ? SourceIndex : DestinationIndex, bRootIsSource ? DestinationIndex : SourceIndex);
+	}
+	else if (TipIndex != Tip)
+	{
+		//Moving the tip lowers every heuristic by at most the distance moved, raising km keeps the old keys valid
+		KeyModifier += Heuristic(LastTip, TipIndex);
+		LastTip = TipIndex;
+		Tip = TipIndex;
+	}
+
+	LastSourceIndex = SourceIndex;
+	LastDestinationIndex = DestinationIndex;
+
+	ComputeShortestPath();
+
+	if (GetG(Tip) == MAX_flt)
+	{
+		return false;
+	}
+
+	const TArray<FIntVector2>& MaskPoints = Params.EdgeMask->MaskPoints;
+	const FQuantizerEdgeMask& EdgeMask = *Params.EdgeMask;
+
+	//Walk from the tip down the cost gradient to the root
+	TArray<int32> Cells;
+	Cells.Add(Tip);
+
+	int32 Current = Tip;
+
+	while (Current != Root)
+	{
+		const FIntVector2 Cell = Heightmap->GetCell(Current);
+
+		int32 Best = INDEX_NONE;
+		float BestCost = MAX_flt;
+
+		for (int32 i = 0; i < StepCosts.Num(); i++)
+		{
+			int32 Next;
+
+			if (bRootIsSource)
+			{
+				//Tree grows along edges out of the source, so walk them backwards
+				const FIntVector2 NextCell(Cell.X - MaskPoints[i].X, Cell.Y - MaskPoints[i].Y);
+
+				if (!Heightmap->IsInBounds(NextCell.X, NextCell.Y))
+				{
+					continue;
+				}
+
+				Next = Heightmap->GetIndex(NextCell);
+
+				if (!EdgeMask.IsTraversable(Next, i))
+				{
+					continue;
+				}
+			}
+			else
+			{
+				if (!EdgeMask.IsTraversable(Current, i))
+				{
+					continue;
+				}
+
+				Next = Heightmap->GetIndex(Cell.X + MaskPoints[i].X, Cell.Y + MaskPoints[i].Y);
+			}
+
+			const float NextG = GetG(Next);
+
+			if (NextG != MAX_flt && StepCosts[i] + NextG < BestCost)
+			{
+				BestCost = StepCosts[i] + NextG;
+				Best = Next;
+			}
+		}
+
+		//Costs are consistent once ComputeShortestPath returns, a dead end means the search is corrupt
+		if (Best == INDEX_NONE || Cells.Num() > Heightmap->Num())
+		{
+			UE_LOG(LogTemp, Error, TEXT("Path extraction failed in FQuantizerIncrementalPlanner::FindPath"));
+			Root = INDEX_NONE;
+			return false;
+		}
+
+		Cells.Add(Best);
+		Current = Best;
+	}
+
+	//Same order as FQuantizerPathfinder, destination back to source
+	if (bRootIsSource)
+	{
+		OutCells = MoveTemp(Cells);
+	}
+	else
+	{
+		OutCells.Reserve(Cells.Num());
+
+		for (int32 i = Cells.Num() - 1; i >= 0; i--)
+		{
+			OutCells.Add(Cells[i]);
+		}
+	}
+
+	return true;
+}
+
+
+void FQuantizerIncrementalPlanner::UpdateTerrain(const FQuantizedHeightmapPtr& InHeightmap, const FQuantizerEdgeMaskPtr& InEdgeMask, const FIntRect& ChangedCells)
+{
+	if (Root == INDEX_NONE || !Heightmap.IsValid() || !Params.EdgeMask.IsValid() || !InHeightmap.IsValid() || !InEdgeMask.IsValid()
+		|| InHeightmap->Dimensions != Heightmap->Dimensions || InEdgeMask->MaskPoints != Params.EdgeMask->MaskPoints)
+	{
+		Reset();
+		return;
+	}
+
+	const FQuantizerEdgeMaskPtr OldEdgeMask = Params.EdgeMask;
+
+	Heightmap = InHeightmap;
+	Params.EdgeMask = InEdgeMask;
+
+	//Edges of cells up to the longest offset away lead into the region
+	const TArray<FIntVector2>& MaskPoints = InEdgeMask->MaskPoints;
+	int32 Reach = 0;
+
+	for (const FIntVector2& Offset : MaskPoints)
+	{
+		Reach = FMath::Max(Reach, FMath::Max(FMath::Abs(Offset.X), FMath::Abs(Offset.Y)));
+	}
+
+	FIntRect Cells(ChangedCells.Min - FIntPoint(Reach), ChangedCells.Max + FIntPoint(Reach));
+	Cells.Clip(FIntRect(0, 0, Heightmap->Dimensions.X, Heightmap->Dimensions.Y));
+
+	for (int32 y = Cells.Min.Y; y < Cells.Max.Y; y++)
+	{
+		for (int32 x = Cells.Min.X; x < Cells.Max.X; x++)
+		{
+			const int32 Index = Heightmap->GetIndex(x, y);
+			const uint32 ChangedEdges = OldEdgeMask->GetEdges(Index) ^ InEdgeMask->GetEdges(Index);
+
+			if (ChangedEdges == 0)
+			{
+				continue;
+			}
+
+			//Both ends of a changed edge may have used it for their lookahead
+			UpdateVertex(Index);
+
+			for (uint32 Remaining = ChangedEdges; Remaining != 0; Remaining &= Remaining - 1)
+			{
+				const int32 i = (int32)FMath::CountTrailingZeros(Remaining);
+				const FIntVector2 NextCell(x + MaskPoints[i].X, y + MaskPoints[i].Y);
+
+				if (Heightmap->IsInBounds(NextCell.X, NextCell.Y))
+				{
+					UpdateVertex(Heightmap->GetIndex(NextCell));
+				}
+			}
+		}
+	}
+}
+
+
+void FQuantizerIncrementalPlanner::Reset()
+{
+	Root = INDEX_NONE;
+	Heightmap.Reset();
+	Params.EdgeMask.Reset();
+}
+
+
+void FQuantizerIncrementalPlanner::Initialize(int32 InRoot, int32 InTip)
+{
+	const int32 NumCells = Heightmap->Num();
+
+	if (Stamps.Num() != NumCells)
+	{
+		G.SetNumUninitialized(NumCells);
+		Rhs.SetNumUninitialized(NumCells);
+		Stamps.Init(0, NumCells);
+		Generation = 0;
+	}
+
+	//Older stamps read as infinite, so nothing is cleared unless the counter wraps
+	if (Generation == MAX_uint32)
+	{
+		FMemory::Memzero(Stamps.GetData(), Stamps.Num() * sizeof(uint32));
+		Generation = 0;
+	}
+
+	Generation++;
+
+	Root = InRoot;
+	Tip = InTip;
+	LastTip = InTip;
+	KeyModifier = 0;
+
+	Frontier.Reset(NumCells);
+
+	SetRhs(Root, 0);
+	Frontier.Push(CalculateKey(Root));
+}
+
+
+void FQuantizerIncrementalPlanner::ComputeShortestPath()
+{
+	const TArray<FIntVector2>& MaskPoints = Params.EdgeMask->MaskPoints;
+	const FQuantizerEdgeMask& EdgeMask = *Params.EdgeMask;
+
+	//Cells whose lookahead depends on a cell, the ones on the far side from the root
+	auto UpdateDependents = [this, &MaskPoints, &EdgeMask](int32 Index)
+	{
+		const FIntVector2 Cell = Heightmap->GetCell(Index);
+
+		for (int32 i = 0; i < StepCosts.Num(); i++)
+		{
+			if (bRootIsSource)
+			{
+				if (EdgeMask.IsTraversable(Index, i))
+				{
+					UpdateVertex(Heightmap->GetIndex(Cell.X + MaskPoints[i].X, Cell.Y + MaskPoints[i].Y));
+				}
+			}
+			else
+			{
+				const FIntVector2 PreviousCell(Cell.X - MaskPoints[i].X, Cell.Y - MaskPoints[i].Y);
+
+				if (Heightmap->IsInBounds(PreviousCell.X, PreviousCell.Y))
+				{
+					const int32 Previous = Heightmap->GetIndex(PreviousCell);
+
+					if (EdgeMask.IsTraversable(Previous, i))
+					{
+						UpdateVertex(Previous);
+					}
+				}
+			}
+		}
+	};
+
+	while (!Frontier.IsEmpty() && (Frontier.Top() < CalculateKey(Tip) || GetRhs(Tip) != GetG(Tip)))
+	{
+		const FDStarNode Top = Frontier.Top();
+		const FDStarNode NewKey = CalculateKey(Top.Index);
+
+		//Key went stale when the tip moved
+		if (Top < NewKey)
+		{
+			Frontier.PushOrUpdate(NewKey);
+			continue;
+		}
+
+		Frontier.Pop();
+		NodesExpanded++;
+
+		if (GetG(Top.Index) > GetRhs(Top.Index))
+		{
+			//Overconsistent, the cost only went down
+			SetG(Top.Index, GetRhs(Top.Index));
+			UpdateDependents(Top.Index);
+		}
+		else
+		{
+			//Underconsistent, the cost went up so the cell and everything that used it are recomputed
+			SetG(Top.Index, MAX_flt);
+			UpdateVertex(Top.Index);
+			UpdateDependents(Top.Index);
+		}
+	}
+}
+
+
+void FQuantizerIncrementalPlanner::UpdateVertex(int32 Index)
+{
+	if (Index != Root)
+	{
+		SetRhs(Index, GetLowestRhs(Index));
+	}
+
+	if (GetG(Index) != GetRhs(Index))
+	{
+		Frontier.PushOrUpdate(CalculateKey(Index));
+	}
+	else if (Frontier.Contains(Index))
+	{
+		Frontier.Remove(Index);
+	}
+}
+
+
+FDStarNode FQuantizerIncrementalPlanner::CalculateKey(int32 Index) const
+{
+	const float Cost = FMath::Min(GetG(Index), GetRhs(Index));
+
+	if (Cost == MAX_flt)
+	{
+		return FDStarNode(MAX_flt, MAX_flt, Index);
+	}
+
+	return FDStarNode(Cost + Heuristic(Tip, Index) + KeyModifier, Cost, Index);
+}
+
+
+float FQuantizerIncrementalPlanner::GetLowestRhs(int32 Index) const
+{
+	const TArray<FIntVector2>& MaskPoints = Params.EdgeMask->MaskPoints;
+	const FQuantizerEdgeMask& EdgeMask = *Params.EdgeMask;
+	const FIntVector2 Cell = Heightmap->GetCell(Index);
+
+	float Lowest = MAX_flt;
+
+	for (int32 i = 0; i < StepCosts.Num(); i++)
+	{
+		int32 Next;
+
+		if (bRootIsSource)
+		{
+			const FIntVector2 PreviousCell(Cell.X - MaskPoints[i].X, Cell.Y - MaskPoints[i].Y);
+
+			if (!Heightmap->IsInBounds(PreviousCell.X, PreviousCell.Y))
+			{
+				continue;
+			}
+
+			Next = Heightmap->GetIndex(PreviousCell);
+
+			if (!EdgeMask.IsTraversable(Next, i))
+			{
+				continue;
+			}
+		}
+		else
+		{
+			if (!EdgeMask.IsTraversable(Index, i))
+			{
+				continue;
+			}
+
+			Next = Heightmap->GetIndex(Cell.X + MaskPoints[i].X, Cell.Y + MaskPoints[i].Y);
+		}
+
+		const float NextG = GetG(Next);
+
+		if (NextG != MAX_flt)
+		{
+			Lowest = FMath::Min(Lowest, NextG + StepCosts[i]);
+		}
+	}
+
+	return Lowest;
+}
+
+
+float FQuantizerIncrementalPlanner::Heuristic(int32 From, int32 To) const
+{
+	const FIntVector2 FromCell = Heightmap->GetCell(From);
+	const FIntVector2 ToCell = Heightmap->GetCell(To);
+
+	return FVector2f((float)(ToCell.X - FromCell.X), (float)(ToCell.Y - FromCell.Y)).Length() * Params.LengthCostWeight;
+}
+
+
+void FQuantizerIncrementalPlanner::SetG(int32 Index, float Value)
+{
+	if (Stamps[Index] != Generation)
+	{
+		Stamps[Index] = Generation;
+		Rhs[Index] = MAX_flt;
+	}
+
+	G[Index] = Value;
+}
+
+
+void FQuantizerIncrementalPlanner::SetRhs(int32 Index, float Value)
+{
+	if (Stamps[Index] != Generation)
+	{
+		Stamps[Index] = Generation;
+		G[Index] = MAX_flt;
+	}
+
+	Rhs[Index] = Value;
+}
+
+
+SIZE_T FQuantizerIncrementalPlanner::GetAllocatedSize() const
+{
+	return Frontier.GetAllocatedSize() + G.GetAllocatedSize() + Rhs.GetAllocatedSize() + Stamps.GetAllocatedSize() + StepCosts.GetAllocatedSize();
+}
@@ -0,0 +1,141 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "QuantizedHeightmap.h"
+#include "QuantizerOpenList.h"
+#include "QuantizerPathfinder.h"
+
+/// <summary>
+/// Node on the D* Lite open list, ordered by the two part key
+/// </summary>
+struct FDStarNode
+{
+	float Key1;	//min(g, rhs) + h + km
+	float Key2;	//min(g, rhs)
+	int32 Index;
+
+	FDStarNode()
+		: Key1(0), Key2(0), Index(INDEX_NONE)
+	{}
+
+	FDStarNode(float _Key1, float _Key2, int32 _Index)
+		: Key1(_Key1), Key2(_Key2), Index(_Index)
+	{}
+
+	bool operator<(const FDStarNode& Other) const
+	{
+		return Key1 < Other.Key1 || (Key1 == Other.Key1 && Key2 < Other.Key2);
+	}
+};
+
+/// <summary>
+/// D* Lite planner that keeps its search between queries. The search is rooted at one end of the path, so moving the
+/// other end only repairs the part of the search that the move invalidates instead of starting over, and terrain changes
+/// only reopen the cells whose edges changed. Whichever end stayed put becomes the root when the search has to restart
+/// </summary>
+class SPACEQUANTIZATION_API FQuantizerIncrementalPlanner
+{
+public:
+
+	/// <summary>
+	/// Plan a path, reusing the previous search if the heightmap, settings and one of the two ends are unchanged
+	/// </summary>
+	/// <param name="InHeightmap"></param>
+	/// <param name="InParams">EdgeMask must be set</param>
+	/// <param name="SourceIndex"></param>
+	/// <param name="DestinationIndex"></param>
+	/// <param name="OutCells">Cells of the path from destination back to source</param>
+	/// <returns>Success</returns>
+	bool FindPath(const FQuantizedHeightmapPtr& InHeightmap, const FQuantizerSearchParams& InParams, int32 SourceIndex, int32 DestinationIndex, TArray<int32>& OutCells);
+
+	/// <summary>
+	/// Switch to a heightmap that only changed inside a region, cells whose edges changed are reopened
+	/// </summary>
+	/// <param name="InHeightmap">Heightmap with the same dimensions</param>
+	/// <param name="InEdgeMask">Traversable edges of InHeightmap with the same settings</param>
+	/// <param name="ChangedCells">Cells whose height changed, Max is exclusive</param>
+	void UpdateTerrain(const FQuantizedHeightmapPtr& InHeightmap, const FQuantizerEdgeMaskPtr& InEdgeMask, const FIntRect& ChangedCells);
+
+	/// <summary>
+	/// Forget the search, the next query starts over
+	/// </summary>
+	void Reset();
+
+	/// <summary>
+	/// Number of nodes expanded by the last query
+	/// </summary>
+	FORCEINLINE int32 GetNodesExpanded() const
+	{
+		return NodesExpanded;
+	}
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+
+	/// <summary>
+	/// Start a new search rooted at Root
+	/// </summary>
+	void Initialize(int32 InRoot, int32 InTip);
+
+	void ComputeShortestPath();
+
+	void UpdateVertex(int32 Index);
+
+	FDStarNode CalculateKey(int32 Index) const;
+
+	/// <summary>
+	/// Lowest cost over the neighbors the root's tree is built through, edges into the cell if the root is the source
+	/// and edges out of it if the root is the destination
+	/// </summary>
+	float GetLowestRhs(int32 Index) const;
+
+	float Heuristic(int32 From, int32 To) const;
+
+	FORCEINLINE float GetG(int32 Index) const
+	{
+		return Stamps[Index] == Generation ? G[Index] : MAX_flt;
+	}
+
+	FORCEINLINE float GetRhs(int32 Index) const
+	{
+		return Stamps[Index] == Generation ? Rhs[Index] : MAX_flt;
+	}
+
+	void SetG(int32 Index, float Value);
+	void SetRhs(int32 Index, float Value);
+
+	FQuantizedHeightmapPtr Heightmap;
+	FQuantizerSearchParams Params;
+
+	//Cost of a step along every mask offset
+	TArray<float> StepCosts;
+
+	//End of the path the search is rooted at and the end that is free to move
+	int32 Root = INDEX_NONE;
+	int32 Tip = INDEX_NONE;
+
+	//Whether Root is the source, edges are followed backwards when it is
+	bool bRootIsSource = false;
+
+	//Where the tip was when km was last updated, and the key modifier
+	int32 LastTip = INDEX_NONE;
+	float KeyModifier = 0;
+
+	//Ends of the previous query, used to pick the root when the search restarts
+	int32 LastSourceIndex = INDEX_NONE;
+	int32 LastDestinationIndex = INDEX_NONE;
+
+	TQuantizerIndexedHeap<FDStarNode> Frontier;
+
+	//Per cell cost to the root and its one step lookahead, cells stamped with an older generation read as infinite
+	TArray<float> G;
+	TArray<float> Rhs;
+	TArray<uint32> Stamps;
+	uint32 Generation = 0;
+
+	int32 NodesExpanded = 0;
+};
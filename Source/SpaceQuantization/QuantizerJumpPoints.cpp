@@ -0,0 +1,263 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "QuantizerJumpPoints.h"
+
+#include "Async/ParallelFor.h"
+
+const FIntVector2 FQuantizerJumpPoints::Directions[FQuantizerJumpPoints::NumDirections] =
+{
+	FIntVector2(1, 0), FIntVector2(1, 1), FIntVector2(0, 1), FIntVector2(-1, 1),
+	FIntVector2(-1, 0), FIntVector2(-1, -1), FIntVector2(0, -1), FIntVector2(1, -1)
+};
+
+namespace QuantizerJumpPoints
+{
+	//Path lengths are sums of 1 and sqrt(2), anything closer than this is a tie
+	static constexpr float LengthTolerance = 1e-3f;
+
+	/// <summary>
+	/// Neighbors that stay unpruned without any blocked edges, straight moves keep going and diagonal moves also
+	/// keep their two straight components
+	/// </summary>
+	static uint8 GetNaturalDirections(int32 Direction)
+	{
+		if (Direction & 1)
+		{
+			return (uint8)((1 << Direction) | (1 << ((Direction + 1) & 7)) | (1 << ((Direction + 7) & 7)));
+		}
+
+		return (uint8)(1 << Direction);
+	}
+
+	/// <summary>
+	/// Edges between the eight cells around a cell, RingEdges[From] has a bit for every traversable step to another ring cell
+	/// </summary>
+	struct FRing
+	{
+		uint8 RingEdges[FQuantizerJumpPoints::NumDirections];
+		uint8 CellEdges;	//Traversable steps out of the center cell
+	};
+}
+
+
+FQuantizerJumpPointsPtr FQuantizerJumpPoints::Build(const FQuantizedHeightmapPtr& InHeightmap, const FQuantizerEdgeMaskPtr& InEdgeMask)
+{
+	if (!InHeightmap.IsValid() || !InEdgeMask.IsValid())
+	{
+		return nullptr;
+	}
+
+	TSharedRef<FQuantizerJumpPoints, ESPMode::ThreadSafe> JumpPoints = MakeShared<FQuantizerJumpPoints, ESPMode::ThreadSafe>();
+	JumpPoints->Heightmap = InHeightmap;
+	JumpPoints->EdgeMask = InEdgeMask;
+
+	const TArray<FIntVector2>& MaskPoints = InEdgeMask->MaskPoints;
+
+	//Jumps only work when the mask is exactly the eight neighbors
+	if (MaskPoints.Num() != NumDirections)
+	{
+		return nullptr;
+	}
+
+	for (int32 Direction = 0; Direction < NumDirections; Direction++)
+	{
+		JumpPoints->DirectionMaskIndices[Direction] = MaskPoints.Find(Directions[Direction]);
+
+		if (JumpPoints->DirectionMaskIndices[Direction] == INDEX_NONE)
+		{
+			return nullptr;
+		}
+	}
+
+	const FQuantizedHeightmap& Grid = *InHeightmap;
+
+	JumpPoints->ForcedDirections.SetNumZeroed(Grid.Num());
+	JumpPoints->UnprunedDirections.SetNumZeroed(Grid.Num() * NumDirections);
+
+	ParallelFor(Grid.Dimensions.Y, [&Grid, &JumpPoints](int32 y)
+	{
+		for (int32 x = 0; x < Grid.Dimensions.X; x++)
+		{
+			const int32 Index = Grid.GetIndex(x, y);
+
+			if (!Grid.IsValidIndex(Index))
+			{
+				continue;
+			}
+
+			uint8 Forced = 0;
+
+			for (int32 Direction = 0; Direction < NumDirections; Direction++)
+			{
+				const uint8 Unpruned = JumpPoints->FindUnprunedDirections(FIntVector2(x, y), Direction);
+				JumpPoints->UnprunedDirections[Index * NumDirections + Direction] = Unpruned;
+
+				if (Unpruned & ~QuantizerJumpPoints::GetNaturalDirections(Direction))
+				{
+					Forced |= 1 << Direction;
+				}
+			}
+
+			JumpPoints->ForcedDirections[Index] = Forced;
+		}
+	});
+
+	return JumpPoints;
+}
+
+
+uint8 FQuantizerJumpPoints::GetTraversableDirections(int32 Index) const
+{
+	uint8 AllDirections = 0;
+
+	for (int32 Next = 0; Next < NumDirections; Next++)
+	{
+		if (IsTraversable(Index, Next))
+		{
+			AllDirections |= 1 << Next;
+		}
+	}
+
+	return AllDirections;
+}
+
+
+int32 FQuantizerJumpPoints::GetDirection(int32 DeltaX, int32 DeltaY)
+{
+	const FIntVector2 Step(FMath::Sign(DeltaX), FMath::Sign(DeltaY));
+
+	for (int32 Direction = 0; Direction < NumDirections; Direction++)
+	{
+		if (Directions[Direction] == Step)
+		{
+			return Direction;
+		}
+	}
+
+	return INDEX_NONE;
+}
+
+
+uint8 FQuantizerJumpPoints::FindUnprunedDirections(const FIntVector2& Cell, int32 Direction) const
+{
+	using namespace QuantizerJumpPoints;
+
+	const FQuantizedHeightmap& Grid = *Heightmap;
+	const int32 Index = Grid.GetIndex(Cell);
+
+	FRing Ring;
+	Ring.CellEdges = 0;
+
+	//Steps between the cells around this one, ring cells are adjacent to the next one around and straight ones also
+	//to the straight ones either side
+	for (int32 From = 0; From < NumDirections; From++)
+	{
+		Ring.RingEdges[From] = 0;
+
+		if (IsTraversable(Index, From))
+		{
+			Ring.CellEdges |= 1 << From;
+		}
+
+		const FIntVector2 FromCell(Cell.X + Directions[From].X, Cell.Y + Directions[From].Y);
+
+		if (!Grid.IsCellValid(FromCell.X, FromCell.Y))
+		{
+			continue;
+		}
+
+		const int32 FromIndex = Grid.GetIndex(FromCell);
+
+		for (int32 Offset = -2; Offset <= 2; Offset++)
+		{
+			if (Offset == 0 || ((From & 1) && FMath::Abs(Offset) == 2))
+			{
+				continue;
+			}
+
+			const int32 To = (From + Offset + NumDirections) & 7;
+			const int32 StepDirection = GetDirection(Directions[To].X - Directions[From].X, Directions[To].Y - Directions[From].Y);
+
+			if (IsTraversable(FromIndex, StepDirection))
+			{
+				Ring.RingEdges[From] |= 1 << To;
+			}
+		}
+	}
+
+	//Shortest paths from the parent to every ring cell without passing through this one
+	const int32 Parent = (Direction + 4) & 7;
+
+	float Distances[NumDirections];
+	bool bDone[NumDirections];
+
+	for (int32 i = 0; i < NumDirections; i++)
+	{
+		Distances[i] = MAX_flt;
+		bDone[i] = false;
+	}
+
+	Distances[Parent] = 0;
+
+	for (int32 Iteration = 0; Iteration < NumDirections; Iteration++)
+	{
+		int32 Closest = INDEX_NONE;
+
+		for (int32 i = 0; i < NumDirections; i++)
+		{
+			if (!bDone[i] && Distances[i] != MAX_flt && (Closest == INDEX_NONE || Distances[i] < Distances[Closest]))
+			{
+				Closest = i;
+			}
+		}
+
+		if (Closest == INDEX_NONE)
+		{
+			break;
+		}
+
+		bDone[Closest] = true;
+
+		for (int32 To = 0; To < NumDirections; To++)
+		{
+			if (Ring.RingEdges[Closest] & (1 << To))
+			{
+				const FIntVector2 Step(Directions[To].X - Directions[Closest].X, Directions[To].Y - Directions[Closest].Y);
+				const float Distance = Distances[Closest] + ((Step.X != 0 && Step.Y != 0) ? UE_SQRT_2 : 1.f);
+
+				Distances[To] = FMath::Min(Distances[To], Distance);
+			}
+		}
+	}
+
+	//A neighbor is pruned if the detour is no longer, straight moves win ties and diagonal moves do not
+	uint8 Unpruned = 0;
+
+	for (int32 Next = 0; Next < NumDirections; Next++)
+	{
+		if (!(Ring.CellEdges & (1 << Next)))
+		{
+			continue;
+		}
+
+		const float Through = GetStepLength(Direction) + GetStepLength(Next);
+
+		const bool bPruned = (Direction & 1)
+			? Distances[Next] < Through - LengthTolerance
+			: Distances[Next] <= Through + LengthTolerance;
+
+		if (!bPruned)
+		{
+			Unpruned |= 1 << Next;
+		}
+	}
+
+	return Unpruned;
+}
+
+
+SIZE_T FQuantizerJumpPoints::GetAllocatedSize() const
+{
+	return ForcedDirections.GetAllocatedSize() + UnprunedDirections.GetAllocatedSize();
+}
@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "QuantizedHeightmap.h"
+#include "QuantizerEdgeMask.h"
+
+class FQuantizerJumpPoints;
+
+//Built once per edge mask and shared by every search, like the edge mask itself
+typedef TSharedPtr<const FQuantizerJumpPoints, ESPMode::ThreadSafe> FQuantizerJumpPointsPtr;
+
+/// <summary>
+/// Pruning data for Jump Point Search on the 8-connected grid. Moves are blocked per edge rather than per cell, so
+/// forced neighbors are found by checking, inside the 3x3 block around a cell, whether a neighbor can be reached from
+/// the parent as cheaply without passing through the cell. The unpruned neighbors of every cell and direction of travel
+/// are precomputed, so expansions look them up and jumps only test one bit per step
+/// </summary>
+class SPACEQUANTIZATION_API FQuantizerJumpPoints
+{
+public:
+
+	static constexpr int32 NumDirections = 8;
+
+	//Counter clockwise from +X, even directions are straight and odd ones diagonal
+	static const FIntVector2 Directions[NumDirections];
+
+	/// <summary>
+	/// Find the forced neighbors of every cell
+	/// </summary>
+	/// <param name="InHeightmap"></param>
+	/// <param name="InEdgeMask">Its mask has to be exactly the 8 neighbors of a cell, in any order</param>
+	/// <returns>Null if the mask is not 8-connected</returns>
+	static FQuantizerJumpPointsPtr Build(const FQuantizedHeightmapPtr& InHeightmap, const FQuantizerEdgeMaskPtr& InEdgeMask);
+
+	/// <summary>
+	/// Whether this data was built from the passed edge mask
+	/// </summary>
+	FORCEINLINE bool Matches(const FQuantizerEdgeMaskPtr& InEdgeMask) const
+	{
+		return EdgeMask == InEdgeMask;
+	}
+
+	/// <summary>
+	/// Whether the step from the cell at Index in Direction is traversable
+	/// </summary>
+	FORCEINLINE bool IsTraversable(int32 Index, int32 Direction) const
+	{
+		return EdgeMask->IsTraversable(Index, DirectionMaskIndices[Direction]);
+	}
+
+	/// <summary>
+	/// Whether a cell has a forced neighbor when it is entered travelling in Direction, i.e. a jump has to stop there
+	/// </summary>
+	FORCEINLINE bool IsJumpPoint(int32 Index, int32 Direction) const
+	{
+		return (ForcedDirections[Index] >> Direction) & 1;
+	}
+
+	/// <summary>
+	/// Directions to search from a cell entered travelling in Direction, its natural and forced neighbors
+	/// </summary>
+	/// <param name="Cell"></param>
+	/// <param name="Direction">INDEX_NONE for the start of a search, which searches every direction</param>
+	/// <returns>One bit per direction</returns>
+	FORCEINLINE uint8 GetSuccessorDirections(const FIntVector2& Cell, int32 Direction) const
+	{
+		const int32 Index = Heightmap->GetIndex(Cell);
+
+		if (Direction == INDEX_NONE)
+		{
+			return GetTraversableDirections(Index);
+		}
+
+		return UnprunedDirections[Index * NumDirections + Direction];
+	}
+
+	/// <summary>
+	/// Direction of a straight or diagonal step
+	/// </summary>
+	static int32 GetDirection(int32 DeltaX, int32 DeltaY);
+
+	FORCEINLINE static float GetStepLength(int32 Direction)
+	{
+		return (Direction & 1) ? UE_SQRT_2 : 1.f;
+	}
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+
+	/// <summary>
+	/// One bit per traversable step out of the cell at Index
+	/// </summary>
+	uint8 GetTraversableDirections(int32 Index) const;
+
+	/// <summary>
+	/// Every traversable neighbor of a cell that is not reached at least as cheaply from the parent some other way
+	/// </summary>
+	uint8 FindUnprunedDirections(const FIntVector2& Cell, int32 Direction) const;
+
+	FQuantizedHeightmapPtr Heightmap;
+	FQuantizerEdgeMaskPtr EdgeMask;
+
+	//Mask index of every direction
+	int32 DirectionMaskIndices[NumDirections];
+
+	//Per cell, one bit per direction of travel that has forced neighbors
+	TArray<uint8> ForcedDirections;
+
+	//Per cell and direction of travel, one bit per unpruned neighbor
+	TArray<uint8> UnprunedDirections;
+};
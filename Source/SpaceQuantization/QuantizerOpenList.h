@@ -0,0 +1,228 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/// <summary>
+/// Binary min-heap of search nodes with a handle per heightmap cell, so a node can be found, re-prioritised
+/// or removed in O(log n) by its cell index. ElementType needs an int32 Index member and a less-than operator
+/// </summary>
+template <typename ElementType>
+class TQuantizerIndexedHeap
+{
+public:
+
+	/// <summary>
+	/// Empty the heap and size the handle table for a grid of NumCells cells
+	/// </summary>
+	/// <param name="NumCells"></param>
+	void Reset(int32 NumCells)
+	{
+		if (Handles.Num() != NumCells)
+		{
+			Heap.Reset();
+			Handles.Init(INDEX_NONE, NumCells);
+			return;
+		}
+
+		//Only the cells still on the heap have handles to clear
+		for (const ElementType& Element : Heap)
+		{
+			Handles[Element.Index] = INDEX_NONE;
+		}
+
+		Heap.Reset();
+	}
+
+	FORCEINLINE int32 Num() const
+	{
+		return Heap.Num();
+	}
+
+	FORCEINLINE bool IsEmpty() const
+	{
+		return Heap.Num() == 0;
+	}
+
+	FORCEINLINE bool Contains(int32 CellIndex) const
+	{
+		return Handles[CellIndex] != INDEX_NONE;
+	}
+
+	/// <summary>
+	/// Node on the heap for the passed cell, nullptr if the cell is not on the heap
+	/// </summary>
+	FORCEINLINE const ElementType* Find(int32 CellIndex) const
+	{
+		const int32 Handle = Handles[CellIndex];
+		return Handle != INDEX_NONE ? &Heap[Handle] : nullptr;
+	}
+
+	/// <summary>
+	/// Lowest node on the heap, heap must not be empty
+	/// </summary>
+	FORCEINLINE const ElementType& Top() const
+	{
+		return Heap[0];
+	}
+
+	/// <summary>
+	/// Add a node for a cell that is not on the heap yet
+	/// </summary>
+	/// <param name="Element"></param>
+	void Push(const ElementType& Element)
+	{
+		checkSlow(!Contains(Element.Index));
+
+		const int32 Handle = Heap.Add(Element);
+		Handles[Element.Index] = Handle;
+
+		SiftUp(Handle);
+	}
+
+	/// <summary>
+	/// Add the node, or replace the node already on the heap for the same cell and restore heap order
+	/// </summary>
+	/// <param name="Element"></param>
+	void PushOrUpdate(const ElementType& Element)
+	{
+		const int32 Handle = Handles[Element.Index];
+
+		if (Handle == INDEX_NONE)
+		{
+			Push(Element);
+			return;
+		}
+
+		const bool bDecreased = Element < Heap[Handle];
+		Heap[Handle] = Element;
+
+		if (bDecreased)
+		{
+			SiftUp(Handle);
+		}
+		else
+		{
+			SiftDown(Handle);
+		}
+	}
+
+	/// <summary>
+	/// Remove and return the lowest node, heap must not be empty
+	/// </summary>
+	/// <returns></returns>
+	ElementType Pop()
+	{
+		ElementType Result = Heap[0];
+		RemoveAt(0);
+
+		return Result;
+	}
+
+	/// <summary>
+	/// Remove the node for the passed cell if it is on the heap
+	/// </summary>
+	/// <param name="CellIndex"></param>
+	void Remove(int32 CellIndex)
+	{
+		const int32 Handle = Handles[CellIndex];
+
+		if (Handle != INDEX_NONE)
+		{
+			RemoveAt(Handle);
+		}
+	}
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return Heap.GetAllocatedSize() + Handles.GetAllocatedSize();
+	}
+
+private:
+
+	void RemoveAt(int32 Handle)
+	{
+		Handles[Heap[Handle].Index] = INDEX_NONE;
+
+		//Fill the hole with the last node and move it to where it belongs
+		const int32 LastHandle = Heap.Num() - 1;
+
+		if (Handle != LastHandle)
+		{
+			Heap[Handle] = Heap[LastHandle];
+			Handles[Heap[Handle].Index] = Handle;
+		}
+
+		Heap.RemoveAt(LastHandle, 1, false);
+
+		if (Handle < Heap.Num())
+		{
+			SiftDown(Handle);
+			SiftUp(Handle);
+		}
+	}
+
+	void SiftUp(int32 Handle)
+	{
+		ElementType Element = Heap[Handle];
+
+		while (Handle > 0)
+		{
+			const int32 ParentHandle = (Handle - 1) / 2;
+
+			if (!(Element < Heap[ParentHandle]))
+			{
+				break;
+			}
+
+			//Move parent down into the hole
+			Heap[Handle] = Heap[ParentHandle];
+			Handles[Heap[Handle].Index] = Handle;
+
+			Handle = ParentHandle;
+		}
+
+		Heap[Handle] = Element;
+		Handles[Element.Index] = Handle;
+	}
+
+	void SiftDown(int32 Handle)
+	{
+		ElementType Element = Heap[Handle];
+		const int32 Count = Heap.Num();
+
+		while (true)
+		{
+			int32 ChildHandle = Handle * 2 + 1;
+
+			if (ChildHandle >= Count)
+			{
+				break;
+			}
+
+			//Pick the lower of the two children
+			if (ChildHandle + 1 < Count && Heap[ChildHandle + 1] < Heap[ChildHandle])
+			{
+				ChildHandle++;
+			}
+
+			if (!(Heap[ChildHandle] < Element))
+			{
+				break;
+			}
+
+			//Move child up into the hole
+			Heap[Handle] = Heap[ChildHandle];
+			Handles[Heap[Handle].Index] = Handle;
+
+			Handle = ChildHandle;
+		}
+
+		Heap[Handle] = Element;
+		Handles[Element.Index] = Handle;
+	}
+
+	TArray<ElementType> Heap;	//Nodes in heap order
+	TArray<int32> Handles;		//Position of every cell's node in Heap, INDEX_NONE if not on the heap
+};
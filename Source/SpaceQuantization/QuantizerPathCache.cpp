@@ -0,0 +1,296 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "QuantizerPathCache.h"
+
+void FQuantizerPathCache::SetMaxBytes(SIZE_T InMaxBytes)
+{
+	MaxBytes = InMaxBytes;
+
+	Trim();
+}
+
+
+bool FQuantizerPathCache::Find(const FQuantizerPathCacheKey& Key, uint32 HeightmapVersion, bool bAllowReverse, bool bAllowSubPaths, TArray<int32>& OutCells)
+{
+	OutCells.Reset();
+
+	if (const int32* Found = Lookup.Find(Key))
+	{
+		const int32 EntryIndex = *Found;
+
+		if (Entries[EntryIndex].HeightmapVersion == HeightmapVersion)
+		{
+			Touch(EntryIndex);
+			OutCells = Entries[EntryIndex].Cells;
+
+			Hits++;
+			return true;
+		}
+
+		//Found on a heightmap that has changed since
+		Remove(EntryIndex);
+	}
+
+	if (!bAllowReverse && !bAllowSubPaths)
+	{
+		Misses++;
+		return false;
+	}
+
+	//Any path that starts or ends at one of the query's cells may pass through the other
+	int32 Match = INDEX_NONE;
+	bool bReversed = false;
+
+	TArray<int32, TInlineAllocator<16>> StaleEntries;
+
+	const int32 Ends[2] = { Key.SourceIndex, Key.DestinationIndex };
+
+	for (int32 End = 0; End < 2 && Match == INDEX_NONE; End++)
+	{
+		for (TMultiMap<uint64, int32>::TConstKeyIterator It = Endpoints.CreateConstKeyIterator(MakeEndpointKey(Key.SettingsHash, Ends[End])); It; ++It)
+		{
+			const FEntry& Entry = Entries[It.Value()];
+
+			if (Entry.HeightmapVersion != HeightmapVersion)
+			{
+				StaleEntries.AddUnique(It.Value());
+				continue;
+			}
+
+			//Without sub-paths only the same two cells the other way round will do
+			const bool bSameEnds = Entry.Key.SourceIndex == Key.DestinationIndex && Entry.Key.DestinationIndex == Key.SourceIndex;
+
+			if (!bAllowSubPaths && !bSameEnds)
+			{
+				continue;
+			}
+
+			if (ExtractPath(Entry, Key.SourceIndex, Key.DestinationIndex, bAllowReverse, OutCells, bReversed))
+			{
+				Match = It.Value();
+				break;
+			}
+		}
+	}
+
+	//Removed after iterating, removing changes the multimap
+	for (int32 EntryIndex : StaleEntries)
+	{
+		Remove(EntryIndex);
+	}
+
+	if (Match == INDEX_NONE)
+	{
+		OutCells.Reset();
+
+		Misses++;
+		return false;
+	}
+
+	if (OutCells.Num() < Entries[Match].Cells.Num())
+	{
+		SubPathHits++;
+	}
+	else if (bReversed)
+	{
+		ReversedHits++;
+	}
+
+	Touch(Match);
+
+	Hits++;
+	return true;
+}
+
+
+void FQuantizerPathCache::Add(const FQuantizerPathCacheKey& Key, uint32 HeightmapVersion, const TArray<int32>& Cells)
+{
+	if (Cells.Num() == 0)
+	{
+		return;
+	}
+
+	//Entry, its cells and its three map entries
+	const SIZE_T Bytes = sizeof(FEntry) + Cells.Num() * sizeof(int32) + sizeof(TPair<FQuantizerPathCacheKey, int32>) + 2 * sizeof(TPair<uint64, int32>);
+
+	if (Bytes > MaxBytes)
+	{
+		return;
+	}
+
+	if (const int32* Existing = Lookup.Find(Key))
+	{
+		Remove(*Existing);
+	}
+
+	const int32 EntryIndex = FreeEntries.Num() > 0 ? FreeEntries.Pop(false) : Entries.AddDefaulted();
+
+	FEntry& Entry = Entries[EntryIndex];
+	Entry.Key = Key;
+	Entry.HeightmapVersion = HeightmapVersion;
+	Entry.Cells = Cells;
+	Entry.Bytes = Bytes;
+
+	Lookup.Add(Key, EntryIndex);
+	Endpoints.Add(MakeEndpointKey(Key.SettingsHash, Key.SourceIndex), EntryIndex);
+
+	if (Key.DestinationIndex != Key.SourceIndex)
+	{
+		Endpoints.Add(MakeEndpointKey(Key.SettingsHash, Key.DestinationIndex), EntryIndex);
+	}
+
+	Link(EntryIndex);
+
+	UsedBytes += Bytes;
+
+	Trim();
+}
+
+
+void FQuantizerPathCache::Empty()
+{
+	Entries.Empty();
+	FreeEntries.Empty();
+	Lookup.Empty();
+	Endpoints.Empty();
+
+	MostRecent = INDEX_NONE;
+	LeastRecent = INDEX_NONE;
+
+	UsedBytes = 0;
+}
+
+
+void FQuantizerPathCache::ResetStats()
+{
+	Hits = 0;
+	Misses = 0;
+	ReversedHits = 0;
+	SubPathHits = 0;
+}
+
+
+bool FQuantizerPathCache::ExtractPath(const FEntry& Entry, int32 SourceIndex, int32 DestinationIndex, bool bAllowReverse, TArray<int32>& OutCells, bool& bOutReversed)
+{
+	const int32 SourcePosition = Entry.Cells.Find(SourceIndex);
+	const int32 DestinationPosition = Entry.Cells.Find(DestinationIndex);
+
+	if (SourcePosition == INDEX_NONE || DestinationPosition == INDEX_NONE)
+	{
+		return false;
+	}
+
+	//Cells run from the entry's destination back to its source, so the query's source comes after its destination
+	bOutReversed = SourcePosition < DestinationPosition;
+
+	if (bOutReversed && !bAllowReverse)
+	{
+		return false;
+	}
+
+	OutCells.Reset();
+
+	if (bOutReversed)
+	{
+		for (int32 i = DestinationPosition; i >= SourcePosition; i--)
+		{
+			OutCells.Add(Entry.Cells[i]);
+		}
+	}
+	else
+	{
+		OutCells.Append(&Entry.Cells[DestinationPosition], SourcePosition - DestinationPosition + 1);
+	}
+
+	return true;
+}
+
+
+void FQuantizerPathCache::Touch(int32 EntryIndex)
+{
+	if (EntryIndex != MostRecent)
+	{
+		Unlink(EntryIndex);
+		Link(EntryIndex);
+	}
+}
+
+
+void FQuantizerPathCache::Link(int32 EntryIndex)
+{
+	FEntry& Entry = Entries[EntryIndex];
+	Entry.Newer = INDEX_NONE;
+	Entry.Older = MostRecent;
+
+	if (MostRecent != INDEX_NONE)
+	{
+		Entries[MostRecent].Newer = EntryIndex;
+	}
+
+	MostRecent = EntryIndex;
+
+	if (LeastRecent == INDEX_NONE)
+	{
+		LeastRecent = EntryIndex;
+	}
+}
+
+
+void FQuantizerPathCache::Unlink(int32 EntryIndex)
+{
+	FEntry& Entry = Entries[EntryIndex];
+
+	if (Entry.Newer != INDEX_NONE)
+	{
+		Entries[Entry.Newer].Older = Entry.Older;
+	}
+	else
+	{
+		MostRecent = Entry.Older;
+	}
+
+	if (Entry.Older != INDEX_NONE)
+	{
+		Entries[Entry.Older].Newer = Entry.Newer;
+	}
+	else
+	{
+		LeastRecent = Entry.Newer;
+	}
+
+	Entry.Newer = INDEX_NONE;
+	Entry.Older = INDEX_NONE;
+}
+
+
+void FQuantizerPathCache::Remove(int32 EntryIndex)
+{
+	FEntry& Entry = Entries[EntryIndex];
+
+	Unlink(EntryIndex);
+
+	Lookup.Remove(Entry.Key);
+	Endpoints.RemoveSingle(MakeEndpointKey(Entry.Key.SettingsHash, Entry.Key.SourceIndex), EntryIndex);
+
+	if (Entry.Key.DestinationIndex != Entry.Key.SourceIndex)
+	{
+		Endpoints.RemoveSingle(MakeEndpointKey(Entry.Key.SettingsHash, Entry.Key.DestinationIndex), EntryIndex);
+	}
+
+	UsedBytes -= Entry.Bytes;
+
+	Entry.Cells.Empty();
+	Entry.Bytes = 0;
+
+	FreeEntries.Add(EntryIndex);
+}
+
+
+void FQuantizerPathCache::Trim()
+{
+	while (UsedBytes > MaxBytes && LeastRecent != INDEX_NONE)
+	{
+		Remove(LeastRecent);
+	}
+}
@@ -0,0 +1,166 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/// <summary>
+/// Identifies a cached path by its quantized ends and the settings it was searched with
+/// </summary>
+struct FQuantizerPathCacheKey
+{
+	int32 SourceIndex = INDEX_NONE;
+	int32 DestinationIndex = INDEX_NONE;
+
+	//Hash of MaxAngleThreshold, the mask and any other setting that changes which path is found
+	uint32 SettingsHash = 0;
+
+	bool operator==(const FQuantizerPathCacheKey& Other) const
+	{
+		return SourceIndex == Other.SourceIndex && DestinationIndex == Other.DestinationIndex && SettingsHash == Other.SettingsHash;
+	}
+};
+
+FORCEINLINE uint32 GetTypeHash(const FQuantizerPathCacheKey& Key)
+{
+	return HashCombine(HashCombine(GetTypeHash(Key.SourceIndex), GetTypeHash(Key.DestinationIndex)), Key.SettingsHash);
+}
+
+/// <summary>
+/// Least recently used cache of search results, capped by memory. Entries remember the heightmap version they were
+/// found on and are dropped when they are looked up after the heightmap changed. A query can also be answered by a
+/// cached path between the same cells in the other direction, or by any stretch of a cached path that runs between
+/// its two cells, when the caller says those are valid for its settings
+/// </summary>
+class SPACEQUANTIZATION_API FQuantizerPathCache
+{
+public:
+
+	/// <summary>
+	/// Least recently used paths are evicted until the cache fits
+	/// </summary>
+	/// <param name="InMaxBytes">0 disables the cache</param>
+	void SetMaxBytes(SIZE_T InMaxBytes);
+
+	/// <summary>
+	/// Look up a path, counts as a hit or a miss
+	/// </summary>
+	/// <param name="Key"></param>
+	/// <param name="HeightmapVersion">Version of the heightmap the query is for, older entries are stale</param>
+	/// <param name="bAllowReverse">Paths may be followed backwards, true when every edge is traversable both ways at the same cost</param>
+	/// <param name="bAllowSubPaths">Part of a longer path may be returned, true when the search is exact so every part of a shortest path is itself shortest</param>
+	/// <param name="OutCells">Cells of the path from destination back to source</param>
+	/// <returns>Whether a path was found</returns>
+	bool Find(const FQuantizerPathCacheKey& Key, uint32 HeightmapVersion, bool bAllowReverse, bool bAllowSubPaths, TArray<int32>& OutCells);
+
+	/// <summary>
+	/// Store a path as the most recently used entry
+	/// </summary>
+	/// <param name="Key"></param>
+	/// <param name="HeightmapVersion">Version of the heightmap the path was found on</param>
+	/// <param name="Cells">Cells of the path from destination back to source</param>
+	void Add(const FQuantizerPathCacheKey& Key, uint32 HeightmapVersion, const TArray<int32>& Cells);
+
+	/// <summary>
+	/// Remove every entry, the hit counts are kept
+	/// </summary>
+	void Empty();
+
+	void ResetStats();
+
+	FORCEINLINE int32 Num() const
+	{
+		return Lookup.Num();
+	}
+
+	FORCEINLINE uint64 GetHits() const
+	{
+		return Hits;
+	}
+
+	FORCEINLINE uint64 GetMisses() const
+	{
+		return Misses;
+	}
+
+	//Hits answered by a path in the other direction
+	FORCEINLINE uint64 GetReversedHits() const
+	{
+		return ReversedHits;
+	}
+
+	//Hits answered by part of a longer path
+	FORCEINLINE uint64 GetSubPathHits() const
+	{
+		return SubPathHits;
+	}
+
+	/// <summary>
+	/// Memory counted against the cap
+	/// </summary>
+	FORCEINLINE SIZE_T GetUsedBytes() const
+	{
+		return UsedBytes;
+	}
+
+private:
+
+	struct FEntry
+	{
+		FQuantizerPathCacheKey Key;
+		uint32 HeightmapVersion = 0;
+		TArray<int32> Cells;
+
+		//Neighbors in the recency list, INDEX_NONE at either end
+		int32 Newer = INDEX_NONE;
+		int32 Older = INDEX_NONE;
+
+		SIZE_T Bytes = 0;
+	};
+
+	/// <summary>
+	/// Cells of an entry between two cells on it, oriented from Destination back to Source
+	/// </summary>
+	/// <param name="bOutReversed">Whether the stretch runs the other way along the entry's path</param>
+	/// <returns>False if either cell is not on the entry's path, or the stretch runs the wrong way and bAllowReverse is false</returns>
+	static bool ExtractPath(const FEntry& Entry, int32 SourceIndex, int32 DestinationIndex, bool bAllowReverse, TArray<int32>& OutCells, bool& bOutReversed);
+
+	static FORCEINLINE uint64 MakeEndpointKey(uint32 SettingsHash, int32 Cell)
+	{
+		return ((uint64)SettingsHash << 32) | (uint32)Cell;
+	}
+
+	/// <summary>
+	/// Make an entry the most recently used one
+	/// </summary>
+	void Touch(int32 EntryIndex);
+
+	void Link(int32 EntryIndex);
+	void Unlink(int32 EntryIndex);
+	void Remove(int32 EntryIndex);
+
+	/// <summary>
+	/// Evict the least recently used entries until the cache is under its cap
+	/// </summary>
+	void Trim();
+
+	//Slots of entries, removed ones are listed in FreeEntries and reused
+	TArray<FEntry> Entries;
+	TArray<int32> FreeEntries;
+
+	TMap<FQuantizerPathCacheKey, int32> Lookup;
+
+	//Entries under both of their ends, for reversed and partial lookups
+	TMultiMap<uint64, int32> Endpoints;
+
+	int32 MostRecent = INDEX_NONE;
+	int32 LeastRecent = INDEX_NONE;
+
+	SIZE_T UsedBytes = 0;
+	SIZE_T MaxBytes = 0;
+
+	uint64 Hits = 0;
+	uint64 Misses = 0;
+	uint64 ReversedHits = 0;
+	uint64 SubPathHits = 0;
+};
@@ -0,0 +1,169 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "QuantizerPathSmoothing.h"
+#include "QuantizerStats.h"
+
+#include "Algo/Reverse.h"
+
+int32 FQuantizerPathSmoothing::Smooth(const FQuantizedHeightmap& Heightmap, const FQuantizerSmoothingParams& Params, TArray<int32>& InOutCells)
+{
+	QUANTIZER_SCOPE(SmoothPath);
+
+	const int32 NumCells = InOutCells.Num();
+
+	if (Params.Mode == EQuantizerPathSmoothing::None || NumCells < 3)
+	{
+		return 0;
+	}
+
+	const float MaxTangent = Params.MaxAngleThreshold >= 90.f ? MAX_flt : (float)FMath::Tan(FMath::DegreesToRadians((double)FMath::Max(Params.MaxAngleThreshold, 0.f)));
+
+	//Positions into InOutCells of the cells that are kept, in order
+	TArray<int32, TInlineAllocator<64>> Kept;
+
+	if (Params.Mode == EQuantizerPathSmoothing::Greedy)
+	{
+		int32 Anchor = 0;
+		Kept.Add(Anchor);
+
+		//Neighbors on the path are always in line of sight, so stretch the shortcut until the next cell falls out of it
+		for (int32 Position = Anchor + 1; Position < NumCells - 1; Position++)
+		{
+			if (!HasLineOfSight(Heightmap, InOutCells[Anchor], InOutCells[Position + 1], MaxTangent))
+			{
+				Anchor = Position;
+				Kept.Add(Anchor);
+			}
+		}
+
+		Kept.Add(NumCells - 1);
+	}
+	else
+	{
+		const int32 Lookahead = FMath::Max(Params.Lookahead, 1);
+
+		//Shortest distance along shortcuts to every cell of the path, and the cell it was reached from
+		TArray<double> Distances;
+		Distances.Init(MAX_dbl, NumCells);
+		Distances[0] = 0;
+
+		TArray<int32> Parents;
+		Parents.Init(INDEX_NONE, NumCells);
+
+		for (int32 From = 0; From < NumCells - 1; From++)
+		{
+			const FVector FromLocation = Heightmap.GetWorldLocation(InOutCells[From]);
+
+			for (int32 To = From + 1; To <= FMath::Min(From + Lookahead, NumCells - 1); To++)
+			{
+				const double Distance = Distances[From] + FVector::Dist(FromLocation, Heightmap.GetWorldLocation(InOutCells[To]));
+
+				//Line of sight is the expensive part, only test shortcuts that would improve on what is known
+				if (Distance >= Distances[To])
+				{
+					continue;
+				}
+
+				if (To == From + 1 || HasLineOfSight(Heightmap, InOutCells[From], InOutCells[To], MaxTangent))
+				{
+					Distances[To] = Distance;
+					Parents[To] = From;
+				}
+			}
+		}
+
+		for (int32 Position = NumCells - 1; Position != INDEX_NONE; Position = Parents[Position])
+		{
+			Kept.Add(Position);
+		}
+
+		Algo::Reverse(Kept);
+	}
+
+	for (int32 i = 0; i < Kept.Num(); i++)
+	{
+		InOutCells[i] = InOutCells[Kept[i]];
+	}
+
+	InOutCells.SetNum(Kept.Num(), false);
+
+	return NumCells - Kept.Num();
+}
+
+
+bool FQuantizerPathSmoothing::HasLineOfSight(const FQuantizedHeightmap& Heightmap, int32 FromIndex, int32 ToIndex, float MaxTangent)
+{
+	const FIntVector2 From = Heightmap.GetCell(FromIndex);
+	const FIntVector2 To = Heightmap.GetCell(ToIndex);
+
+	const double DeltaX = To.X - From.X;
+	const double DeltaY = To.Y - From.Y;
+
+	//Two samples per cell crossed, so no grid point the line passes near is skipped
+	const int32 NumSteps = FMath::Max(1, FMath::CeilToInt(2 * FMath::Max(FMath::Abs(DeltaX), FMath::Abs(DeltaY))));
+
+	const float MaxRise = MaxTangent == MAX_flt ? MAX_flt : (float)(MaxTangent * FMath::Sqrt(DeltaX * DeltaX + DeltaY * DeltaY) * Heightmap.Resolution / NumSteps);
+
+	float PreviousHeight = Heightmap.GetHeight(FromIndex);
+
+	for (int32 Step = 1; Step <= NumSteps; Step++)
+	{
+		const double Alpha = (double)Step / NumSteps;
+
+		float Height;
+
+		if (!SampleHeight(Heightmap, From.X + DeltaX * Alpha, From.Y + DeltaY * Alpha, Height))
+		{
+			return false;
+		}
+
+		if (FMath::Abs(Height - PreviousHeight) > MaxRise)
+		{
+			return false;
+		}
+
+		PreviousHeight = Height;
+	}
+
+	return true;
+}
+
+
+bool FQuantizerPathSmoothing::SampleHeight(const FQuantizedHeightmap& Heightmap, double X, double Y, float& OutHeight)
+{
+	const int32 X0 = FMath::FloorToInt(X);
+	const int32 Y0 = FMath::FloorToInt(Y);
+
+	const double FracX = X - X0;
+	const double FracY = Y - Y0;
+
+	double Height = 0;
+	double WeightSum = 0;
+
+	for (int32 Corner = 0; Corner < 4; Corner++)
+	{
+		const int32 CornerX = X0 + (Corner & 1);
+		const int32 CornerY = Y0 + (Corner >> 1);
+
+		const double Weight = ((Corner & 1) ? FracX : 1 - FracX) * ((Corner >> 1) ? FracY : 1 - FracY);
+
+		//Points on a grid line only depend on the grid points of that line
+		if (Weight <= UE_KINDA_SMALL_NUMBER)
+		{
+			continue;
+		}
+
+		if (!Heightmap.IsCellValid(CornerX, CornerY))
+		{
+			return false;
+		}
+
+		Height += Weight * Heightmap.GetHeight(Heightmap.GetIndex(CornerX, CornerY));
+		WeightSum += Weight;
+	}
+
+	OutHeight = (float)(Height / WeightSum);
+
+	return true;
+}
@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "QuantizedHeightmap.h"
+
+#include "QuantizerPathSmoothing.generated.h"
+
+/// <summary>
+/// How found paths are shortened before they are turned into world points
+/// </summary>
+UENUM(BlueprintType)
+enum class EQuantizerPathSmoothing : uint8
+{
+	//Keep every cell the search visited
+	None,
+	//Walk the path and skip ahead to the furthest cell in line of sight, one pass
+	Greedy,
+	//Shortest chain of shortcuts that reach at most SmoothingLookahead cells ahead, costs more line of sight tests
+	Optimal
+};
+
+/// <summary>
+/// Settings of a smoothing pass, copied out of the Quantizer so it can run off the game thread
+/// </summary>
+struct FQuantizerSmoothingParams
+{
+	EQuantizerPathSmoothing Mode = EQuantizerPathSmoothing::None;
+
+	//Steepest slope in degrees a shortcut may climb anywhere along it
+	float MaxAngleThreshold = 15.f;
+
+	//Furthest cell along the path Optimal looks for a shortcut to
+	int32 Lookahead = 64;
+};
+
+/// <summary>
+/// String pulling over the heightmap. A shortcut between two cells of a path replaces the cells between them when the
+/// terrain under the straight line is sampled everywhere and never steeper than the angle threshold, so a smoothed
+/// path never crosses ground the search would not
+/// </summary>
+class SPACEQUANTIZATION_API FQuantizerPathSmoothing
+{
+public:
+
+	/// <summary>
+	/// Drop the cells of a path that shortcuts make unnecessary, the first and last cell are always kept
+	/// </summary>
+	/// <param name="Heightmap"></param>
+	/// <param name="Params"></param>
+	/// <param name="InOutCells">Cells of the path in either order</param>
+	/// <returns>Number of cells removed</returns>
+	static int32 Smooth(const FQuantizedHeightmap& Heightmap, const FQuantizerSmoothingParams& Params, TArray<int32>& InOutCells);
+
+	/// <summary>
+	/// Whether the straight line between the grid points of two cells stays on sampled terrain no steeper than MaxTangent
+	/// </summary>
+	/// <param name="Heightmap"></param>
+	/// <param name="FromIndex"></param>
+	/// <param name="ToIndex"></param>
+	/// <param name="MaxTangent">Steepest rise over run between samples</param>
+	/// <returns></returns>
+	static bool HasLineOfSight(const FQuantizedHeightmap& Heightmap, int32 FromIndex, int32 ToIndex, float MaxTangent);
+
+private:
+
+	/// <summary>
+	/// Height of the terrain at a point in cell coordinates, interpolated between the four surrounding grid points
+	/// </summary>
+	/// <returns>False if a grid point the height depends on is outside the grid or has no height</returns>
+	static bool SampleHeight(const FQuantizedHeightmap& Heightmap, double X, double Y, float& OutHeight);
+};
@@ -0,0 +1,1039 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "QuantizerPathfinder.h"
+#include "QuantizerStats.h"
+
+#include "Algo/Reverse.h"
+
+void FQuantizerPathfinder::Init(FQuantizedHeightmapPtr InHeightmap, const FQuantizerSearchParams& InParams)
+{
+	Heightmap = MoveTemp(InHeightmap);
+	Params = InParams;
+
+	SuccessorKernel.Init(Params.MaskPoints, Params.LengthCostWeight, Params.Kernel);
+
+	//Backward steps go to the cell at the negated offset, at the cost of the edge along the original offset
+	TArray<FIntVector2> BackwardMaskPoints;
+	BackwardMaskPoints.Reserve(Params.MaskPoints.Num());
+
+	for (const FIntVector2& MaskPoint : Params.MaskPoints)
+	{
+		BackwardMaskPoints.Add(FIntVector2(-MaskPoint.X, -MaskPoint.Y));
+	}
+
+	BackwardKernel.Init(BackwardMaskPoints, Params.LengthCostWeight, Params.Kernel);
+}
+
+
+bool FQuantizerPathfinder::FindPath(int32 SourceIndex, int32 DestinationIndex, TArray<int32>& OutCells, const std::atomic<bool>* bCancelled)
+{
+	QUANTIZER_SCOPE(FindPath);
+
+	OutCells.Reset();
+	NodesPopped = 0;
+	NodesExpanded = 0;
+	NodesGenerated = 0;
+	PeakFrontierSize = 0;
+
+	if (!PrepareQuery())
+	{
+		return false;
+	}
+
+	bool bUseHierarchy = false;
+
+	if (Params.SearchMode == EQuantizerSearchMode::Hierarchical)
+	{
+		bUseHierarchy = Params.Hierarchy.IsValid() && Params.Hierarchy->Matches(Heightmap, Params.EdgeMask, Params.LengthCostWeight, Params.HierarchyClusterSize);
+
+		if (!bUseHierarchy)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Hierarchy is missing or out of date, falling back to A* in FQuantizerPathfinder::FindPath"));
+		}
+	}
+
+	bool bUseJumpPoints = false;
+
+	if (Params.SearchMode == EQuantizerSearchMode::JumpPoint)
+	{
+		bUseJumpPoints = Params.JumpPoints.IsValid() && Params.JumpPoints->Matches(Params.EdgeMask);
+
+		if (!bUseJumpPoints)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Jump points are missing or SampleMask is not 8-connected, falling back to A* in FQuantizerPathfinder::FindPath"));
+		}
+	}
+
+	bool bUsePyramid = false;
+
+	if (Params.SearchMode == EQuantizerSearchMode::CoarseToFine)
+	{
+		bUsePyramid = Params.Pyramid.IsValid() && Params.Pyramid->Num() > 1 && Params.Pyramid->GetLevel(0) == Heightmap && Params.Pyramid->GetEdgeMask(0) == Params.EdgeMask;
+
+		if (!bUsePyramid)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Heightmap pyramid is missing or out of date, falling back to A* in FQuantizerPathfinder::FindPath"));
+		}
+	}
+
+	bool bFound;
+
+	if (bUseHierarchy)
+	{
+		bFound = FindHierarchicalPath(SourceIndex, DestinationIndex, OutCells, bCancelled);
+	}
+	else if (bUseJumpPoints)
+	{
+		bFound = FindJumpPointPath(SourceIndex, DestinationIndex, OutCells, bCancelled);
+	}
+	else if (bUsePyramid)
+	{
+		bFound = FindCoarseToFinePath(SourceIndex, DestinationIndex, OutCells, bCancelled);
+	}
+	else if (Params.SearchMode == EQuantizerSearchMode::Bidirectional)
+	{
+		bFound = FindBidirectionalPath(SourceIndex, DestinationIndex, OutCells, bCancelled);
+	}
+	else
+	{
+		bFound = FindGridPath(SourceIndex, DestinationIndex, OutCells, bCancelled);
+	}
+
+#if QUANTIZER_VERBOSE_LOGGING
+	UE_LOG(LogTemp, Display, TEXT("Search from %i to %i %s after %i expansions"), SourceIndex, DestinationIndex, bFound ? TEXT("reached the goal") : TEXT("failed"), NodesExpanded);
+#endif
+
+	PublishStats();
+
+	return bFound;
+}
+
+
+bool FQuantizerPathfinder::FindGridPath(int32 SourceIndex, int32 DestinationIndex, TArray<int32>& OutCells, const std::atomic<bool>* bCancelled)
+{
+	OutCells.Reset();
+
+	BeginGridSearch(SourceIndex, DestinationIndex);
+
+	if (StepSearch(MAX_int32, 0, bCancelled) != EQuantizerSearchStatus::Succeeded)
+	{
+		return false;
+	}
+
+	TraceBackPath(DestinationIndex, OutCells);
+
+	return true;
+}
+
+
+bool FQuantizerPathfinder::FindBidirectionalPath(int32 SourceIndex, int32 DestinationIndex, TArray<int32>& OutCells, const std::atomic<bool>* bCancelled)
+{
+	using EDirection = FQuantizerSearchState::EDirection;
+
+	OutCells.Reset();
+
+	DestinationCell = Heightmap->GetCell(DestinationIndex);
+	SourceCell = Heightmap->GetCell(SourceIndex);
+
+	Frontier.Reset(Heightmap->Num());
+	BackwardFrontier.Reset(Heightmap->Num());
+
+	//Both directions share the stamps, so a cell reached from either end is cleared by the same generation
+	SearchState.BeginQuery(Heightmap->Num(), true);
+
+	//Each direction starts at its own end and heads for the other
+	Frontier.Push(FAStarNode(0, 0, SourceIndex));
+	SearchState.Open(SourceIndex, 0, SourceIndex, EDirection::Forward);
+
+	BackwardFrontier.Push(FAStarNode(0, 0, DestinationIndex));
+	SearchState.Open(DestinationIndex, 0, DestinationIndex, EDirection::Backward);
+
+	NodesGenerated += 2;
+
+	MeetingIndex = SourceIndex == DestinationIndex ? SourceIndex : INDEX_NONE;
+	MeetingCost = SourceIndex == DestinationIndex ? 0 : MAX_flt;
+
+	while (true)
+	{
+		//Query was cancelled or superseded
+		if (bCancelled && bCancelled->load(std::memory_order_relaxed))
+		{
+			return false;
+		}
+
+		const float ForwardBound = Frontier.IsEmpty() ? MAX_flt : Frontier.Top().Cost;
+		const float BackwardBound = BackwardFrontier.IsEmpty() ? MAX_flt : BackwardFrontier.Top().Cost;
+
+		//With consistent heuristics the lowest cost on either frontier is a lower bound on the shortest path, so once
+		//either reaches the best meeting no path left to find is cheaper. An empty frontier has searched everything
+		if (FMath::Max(ForwardBound, BackwardBound) >= MeetingCost)
+		{
+			break;
+		}
+
+		//Grow the smaller frontier, keeps both directions about the same size
+		const EDirection Direction = Frontier.Num() <= BackwardFrontier.Num() ? EDirection::Forward : EDirection::Backward;
+
+		const FAStarNode CurrentNode = Direction == EDirection::Forward ? Frontier.Pop() : BackwardFrontier.Pop();
+		NodesPopped++;
+
+		SearchState.Close(CurrentNode.Index, Direction);
+		NodesExpanded++;
+
+		GenerateBidirectionalSuccessors(CurrentNode, Direction);
+	}
+
+	if (MeetingIndex == INDEX_NONE)
+	{
+		return false;
+	}
+
+	//Backward parents lead from the meeting cell to the destination, forward parents lead back to the source
+	for (int32 CurrentIndex = MeetingIndex; CurrentIndex != DestinationIndex; )
+	{
+		CurrentIndex = SearchState.GetParent(CurrentIndex, EDirection::Backward);
+		OutCells.Add(CurrentIndex);
+	}
+
+	Algo::Reverse(OutCells);
+
+	TraceBackPath(MeetingIndex, OutCells);
+
+	return true;
+}
+
+
+void FQuantizerPathfinder::GenerateBidirectionalSuccessors(const FAStarNode& Current, FQuantizerSearchState::EDirection Direction)
+{
+#if QUANTIZER_PER_NODE_STATS
+	SCOPE_CYCLE_COUNTER(STAT_Quantizer_GenerateSuccessors);
+#endif
+
+	using EDirection = FQuantizerSearchState::EDirection;
+
+	const bool bForward = Direction == EDirection::Forward;
+	const EDirection OtherDirection = bForward ? EDirection::Backward : EDirection::Forward;
+
+	const FIntVector2 CurrentCell = Heightmap->GetCell(Current.Index);
+
+	//Forward steps leave along the cell's own edges, backward steps arrive along the edges of the cells before it so
+	//every edge is tested and costed in the direction it is walked
+	const uint32 Edges = bForward ? Params.EdgeMask->GetEdges(Current.Index) : GetIncomingEdges(CurrentCell);
+
+	const FQuantizerSuccessorKernel& Kernel = bForward ? SuccessorKernel : BackwardKernel;
+	TQuantizerIndexedHeap<FAStarNode>& DirectionFrontier = bForward ? Frontier : BackwardFrontier;
+
+	FQuantizerSuccessor Successors[FQuantizerSuccessorKernel::MaxMaskPoints];
+	const int32 NumSuccessors = Kernel.Evaluate(CurrentCell, Current.DistanceFromStart, Edges, bForward ? DestinationCell : SourceCell, Successors);
+
+	for (int32 SuccessorIndex = 0; SuccessorIndex < NumSuccessors; SuccessorIndex++)
+	{
+		const FQuantizerSuccessor& Successor = Successors[SuccessorIndex];
+		const FIntVector2& Offset = Params.MaskPoints[Successor.MaskIndex];
+
+		const FIntVector2 NextCell = bForward
+			? FIntVector2(CurrentCell.X + Offset.X, CurrentCell.Y + Offset.Y)
+			: FIntVector2(CurrentCell.X - Offset.X, CurrentCell.Y - Offset.Y);
+
+		if (bBounded && !SearchBounds.Contains(FIntPoint(NextCell.X, NextCell.Y)))
+		{
+			continue;
+		}
+
+		const FAStarNode NextNode(Successor.Cost, Successor.DistanceFromStart, Heightmap->GetIndex(NextCell));
+
+		//Ignore this node if this direction already reached it with a lower cost
+		if (SearchState.IsVisited(NextNode.Index, Direction) && SearchState.GetDistanceFromStart(NextNode.Index, Direction) <= NextNode.DistanceFromStart)
+		{
+			continue;
+		}
+
+		SearchState.Open(NextNode.Index, NextNode.DistanceFromStart, Current.Index, Direction);
+
+		DirectionFrontier.PushOrUpdate(NextNode);
+		NodesGenerated++;
+
+		//The other direction has been here too, the path through this cell is a candidate
+		if (SearchState.IsVisited(NextNode.Index, OtherDirection))
+		{
+			const float PathCost = NextNode.DistanceFromStart + SearchState.GetDistanceFromStart(NextNode.Index, OtherDirection);
+
+			if (PathCost < MeetingCost)
+			{
+				MeetingCost = PathCost;
+				MeetingIndex = NextNode.Index;
+			}
+		}
+	}
+
+	PeakFrontierSize = FMath::Max(PeakFrontierSize, Frontier.Num() + BackwardFrontier.Num());
+}
+
+
+bool FQuantizerPathfinder::FindCoarseToFinePath(int32 SourceIndex, int32 DestinationIndex, TArray<int32>& OutCells, const std::atomic<bool>* bCancelled)
+{
+	const FQuantizerHeightmapPyramid& Pyramid = *Params.Pyramid;
+
+	const FIntVector2 SourceCell = Heightmap->GetCell(SourceIndex);
+	const FIntVector2 GoalCell = Heightmap->GetCell(DestinationIndex);
+
+	//Start on the coarsest level where both ends are on valid, separate cells
+	int32 TopLevel = 0;
+
+	for (int32 Level = Pyramid.Num() - 1; Level > 0 && TopLevel == 0; Level--)
+	{
+		const FQuantizedHeightmap& Grid = *Pyramid.GetLevel(Level);
+
+		const FIntVector2 LevelSource = FQuantizerHeightmapPyramid::GetLevelCell(SourceCell, Level);
+		const FIntVector2 LevelGoal = FQuantizerHeightmapPyramid::GetLevelCell(GoalCell, Level);
+
+		if (LevelSource != LevelGoal && Grid.IsCellValid(LevelSource.X, LevelSource.Y) && Grid.IsCellValid(LevelGoal.X, LevelGoal.Y))
+		{
+			TopLevel = Level;
+		}
+	}
+
+	if (TopLevel == 0)
+	{
+		return FindGridPath(SourceIndex, DestinationIndex, OutCells, bCancelled);
+	}
+
+	LevelSearchStates.SetNum(Pyramid.Num());
+	LevelFrontiers.SetNum(Pyramid.Num());
+
+	//Level 0 is searched with the pathfinder's own heightmap and workspace
+	const FQuantizedHeightmapPtr BaseHeightmap = Heightmap;
+	const FQuantizerEdgeMaskPtr BaseEdgeMask = Params.EdgeMask;
+
+	bool bFound = true;
+
+	for (int32 Level = TopLevel; Level >= 0 && bFound; Level--)
+	{
+		const FQuantizedHeightmap& Grid = *Pyramid.GetLevel(Level);
+
+		const int32 LevelSourceIndex = Grid.GetIndex(FQuantizerHeightmapPyramid::GetLevelCell(SourceCell, Level));
+		const int32 LevelDestinationIndex = Grid.GetIndex(FQuantizerHeightmapPyramid::GetLevelCell(GoalCell, Level));
+
+		Heightmap = Pyramid.GetLevel(Level);
+		Params.EdgeMask = Pyramid.GetEdgeMask(Level);
+
+		if (Level > 0)
+		{
+			Swap(SearchState, LevelSearchStates[Level]);
+			Swap(Frontier, LevelFrontiers[Level]);
+		}
+
+		//The coarsest level searches everywhere, finer ones stay near the path above them
+		SearchCorridor = Level < TopLevel ? &Corridor : nullptr;
+
+		bFound = FindGridPath(LevelSourceIndex, LevelDestinationIndex, OutCells, bCancelled);
+
+		SearchCorridor = nullptr;
+
+		if (Level > 0)
+		{
+			Swap(SearchState, LevelSearchStates[Level]);
+			Swap(Frontier, LevelFrontiers[Level]);
+		}
+
+		if (!bFound || Level == 0)
+		{
+			break;
+		}
+
+		//Children of every cell on the path, widened by CorridorRadius cells of the next level
+		const FQuantizedHeightmap& NextGrid = *Pyramid.GetLevel(Level - 1);
+		const int32 Radius = FMath::Max(Params.CorridorRadius, 0);
+
+		Corridor.Init(false, NextGrid.Num());
+
+		for (int32 Index : OutCells)
+		{
+			const FIntVector2 Cell = Grid.GetCell(Index);
+
+			const int32 MinX = FMath::Max(Cell.X * 2 - Radius, 0);
+			const int32 MinY = FMath::Max(Cell.Y * 2 - Radius, 0);
+			const int32 MaxX = FMath::Min(Cell.X * 2 + 1 + Radius, NextGrid.Dimensions.X - 1);
+			const int32 MaxY = FMath::Min(Cell.Y * 2 + 1 + Radius, NextGrid.Dimensions.Y - 1);
+
+			for (int32 y = MinY; y <= MaxY; y++)
+			{
+				for (int32 x = MinX; x <= MaxX; x++)
+				{
+					Corridor[NextGrid.GetIndex(x, y)] = true;
+				}
+			}
+		}
+	}
+
+	Heightmap = BaseHeightmap;
+	Params.EdgeMask = BaseEdgeMask;
+
+	if (bFound)
+	{
+		return true;
+	}
+
+	if (bCancelled && bCancelled->load(std::memory_order_relaxed))
+	{
+		return false;
+	}
+
+	//The corridor can miss a path the coarse levels could not see, search the whole grid instead
+	return FindGridPath(SourceIndex, DestinationIndex, OutCells, bCancelled);
+}
+
+
+uint32 FQuantizerPathfinder::GetIncomingEdges(const FIntVector2& Cell) const
+{
+	uint32 Incoming = 0;
+
+	const int32 NumMaskPoints = FMath::Min(Params.MaskPoints.Num(), FQuantizerEdgeMask::MaxMaskPoints);
+
+	for (int32 i = 0; i < NumMaskPoints; i++)
+	{
+		const FIntVector2 PreviousCell(Cell.X - Params.MaskPoints[i].X, Cell.Y - Params.MaskPoints[i].Y);
+
+		if (Heightmap->IsInBounds(PreviousCell.X, PreviousCell.Y) && Params.EdgeMask->IsTraversable(Heightmap->GetIndex(PreviousCell), i))
+		{
+			Incoming |= 1u << i;
+		}
+	}
+
+	return Incoming;
+}
+
+
+bool FQuantizerPathfinder::PrepareQuery()
+{
+	if (!Heightmap.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Heightmap is null in FQuantizerPathfinder"));
+		return false;
+	}
+
+	//Slopes are tested once per heightmap and settings rather than for every generated neighbor
+	if (!Params.EdgeMask.IsValid() || !Params.EdgeMask->Matches(Heightmap, Params.MaskPoints, Params.MaxAngleThreshold))
+	{
+		Params.EdgeMask = FQuantizerEdgeMask::Build(Heightmap, Params.MaskPoints, Params.MaxAngleThreshold);
+	}
+
+	return true;
+}
+
+
+bool FQuantizerPathfinder::BeginSearch(int32 SourceIndex, int32 DestinationIndex)
+{
+	NodesPopped = 0;
+	NodesExpanded = 0;
+	NodesGenerated = 0;
+	PeakFrontierSize = 0;
+	SearchStatus = EQuantizerSearchStatus::Failed;
+
+	if (!PrepareQuery())
+	{
+		return false;
+	}
+
+	BeginGridSearch(SourceIndex, DestinationIndex);
+
+	return true;
+}
+
+
+void FQuantizerPathfinder::BeginGridSearch(int32 SourceIndex, int32 DestinationIndex)
+{
+	SearchDestination = DestinationIndex;
+	SearchStatus = EQuantizerSearchStatus::InProgress;
+
+	DestinationCell = Heightmap->GetCell(DestinationIndex);
+
+	//Heuristic of the start, progress is measured against it
+	const FIntVector2 SourceCell = Heightmap->GetCell(SourceIndex);
+	StartHeuristic = FVector2f((float)(DestinationCell.X - SourceCell.X), (float)(DestinationCell.Y - SourceCell.Y)).Length() * Params.LengthCostWeight;
+
+	ClosestIndex = SourceIndex;
+	ClosestHeuristic = StartHeuristic;
+
+	//Starting node is on the source position, its cost is only the heuristic so the closest node is tracked from it
+	FAStarNode StartNode(StartHeuristic, 0, SourceIndex);
+
+	//Unexplored spaces, clear frontier
+	Frontier.Reset(Heightmap->Num());
+
+	Frontier.Push(StartNode);	//Initialize frontier with starting node
+	NodesGenerated++;
+
+	//Start a new generation of per-cell state, cells from previous queries read as unvisited
+	SearchState.BeginQuery(Heightmap->Num());
+
+	//Parent of start node is itself
+	SearchState.Open(StartNode.Index, 0, StartNode.Index);
+}
+
+
+EQuantizerSearchStatus FQuantizerPathfinder::StepSearch(int32 MaxNodes, double MaxSeconds, const std::atomic<bool>* bCancelled)
+{
+	QUANTIZER_SCOPE(StepSearch);
+
+	if (SearchStatus != EQuantizerSearchStatus::InProgress)
+	{
+		return SearchStatus;
+	}
+
+	//Clock is only read every few expansions, an expansion costs at most one pass over the grid mask
+	constexpr int32 ExpansionsPerClockCheck = 16;
+
+	const uint64 EndCycles = MaxSeconds > 0 ? FPlatformTime::Cycles64() + (uint64)(MaxSeconds / FPlatformTime::GetSecondsPerCycle64()) : MAX_uint64;
+
+	//Loop until goal is found
+	for (int32 Expansions = 0; !Frontier.IsEmpty(); Expansions++)
+	{
+		//Out of budget for this call, the search resumes where it left off
+		if (Expansions >= MaxNodes || (Expansions % ExpansionsPerClockCheck == 0 && Expansions > 0 && FPlatformTime::Cycles64() >= EndCycles))
+		{
+			return SearchStatus;
+		}
+
+		//Query was cancelled or superseded
+		if (bCancelled && bCancelled->load(std::memory_order_relaxed))
+		{
+			SearchStatus = EQuantizerSearchStatus::Failed;
+			return SearchStatus;
+		}
+
+		FAStarNode CurrentNode = PopLowestCostNode();
+
+		//The goal's cost is final once it is the cheapest node on the frontier
+		if (CurrentNode.Index == SearchDestination)
+		{
+			ClosestIndex = SearchDestination;
+			ClosestHeuristic = 0;
+
+			SearchStatus = EQuantizerSearchStatus::Succeeded;
+			return SearchStatus;
+		}
+
+		//Node has been visited
+		SearchState.Close(CurrentNode.Index);
+		NodesExpanded++;
+
+		//Best node so far is the expanded one closest to the goal, h is whatever the cost adds on top of g
+		const float NodeHeuristic = CurrentNode.Cost - CurrentNode.DistanceFromStart;
+
+		if (NodeHeuristic < ClosestHeuristic)
+		{
+			ClosestHeuristic = NodeHeuristic;
+			ClosestIndex = CurrentNode.Index;
+		}
+
+		GenerateSuccessors(CurrentNode);
+	}
+
+	SearchStatus = EQuantizerSearchStatus::Failed;
+	return SearchStatus;
+}
+
+
+void FQuantizerPathfinder::GetSearchPath(TArray<int32>& OutCells) const
+{
+	OutCells.Reset();
+
+	if (ClosestIndex != INDEX_NONE && SearchState.IsVisited(ClosestIndex))
+	{
+		TraceBackPath(ClosestIndex, OutCells);
+	}
+}
+
+
+float FQuantizerPathfinder::GetSearchProgress() const
+{
+	if (SearchStatus == EQuantizerSearchStatus::Succeeded)
+	{
+		return 1.f;
+	}
+
+	return StartHeuristic > 0 ? FMath::Clamp(1.f - ClosestHeuristic / StartHeuristic, 0.f, 1.f) : 0.f;
+}
+
+
+bool FQuantizerPathfinder::FindHierarchicalPath(int32 SourceIndex, int32 DestinationIndex, TArray<int32>& OutCells, const std::atomic<bool>* bCancelled)
+{
+	const FQuantizerHierarchy& Hierarchy = *Params.Hierarchy;
+	const TArray<FQuantizerAbstractNode>& Nodes = Hierarchy.GetNodes();
+
+	const FIntVector2 SourceCell = Heightmap->GetCell(SourceIndex);
+	const FIntVector2 GoalCell = Heightmap->GetCell(DestinationIndex);
+
+	const int32 SourceCluster = Hierarchy.GetClusterIndex(SourceCell);
+	const int32 DestinationCluster = Hierarchy.GetClusterIndex(GoalCell);
+
+	//Nearby queries usually stay inside one cluster
+	if (SourceCluster == DestinationCluster)
+	{
+		SetSearchBounds(Hierarchy.GetCluster(SourceCluster).Bounds);
+		const bool bFound = FindGridPath(SourceIndex, DestinationIndex, OutCells, bCancelled);
+		ClearSearchBounds();
+
+		if (bFound)
+		{
+			return true;
+		}
+	}
+
+	//Source and destination join the abstract graph as two extra nodes, connected to the entrances of their clusters
+	const int32 SourceNode = Nodes.Num();
+	const int32 DestinationNode = Nodes.Num() + 1;
+
+	TArray<int32> SourceTargets = Hierarchy.GetCluster(SourceCluster).Entrances;
+	TArray<float> SourceCosts;
+
+	const int32 NumSourceEntrances = SourceTargets.Num();
+
+	if (SourceCluster == DestinationCluster)
+	{
+		SourceTargets.Add(DestinationIndex);
+	}
+
+	Hierarchy.ComputeClusterCosts(SourceCluster, SourceIndex, false, SourceTargets, SourceCosts);
+
+	const TArray<int32>& DestinationEntrances = Hierarchy.GetCluster(DestinationCluster).Entrances;
+	TArray<float> DestinationCosts;
+
+	Hierarchy.ComputeClusterCosts(DestinationCluster, DestinationIndex, true, DestinationEntrances, DestinationCosts);
+
+	//Cost from an entrance of the destination cluster to the destination
+	TMap<int32, float> GoalEdges;
+
+	for (int32 i = 0; i < DestinationEntrances.Num(); i++)
+	{
+		if (DestinationCosts[i] != MAX_flt)
+		{
+			GoalEdges.Add(Hierarchy.FindNode(DestinationEntrances[i]), DestinationCosts[i]);
+		}
+	}
+
+	auto GetNodeCell = [&Nodes, SourceNode, DestinationNode, SourceIndex, DestinationIndex](int32 Node)
+	{
+		return Node == SourceNode ? SourceIndex : Node == DestinationNode ? DestinationIndex : Nodes[Node].Cell;
+	};
+
+	auto Heuristic = [this, &GetNodeCell, GoalCell](int32 Node)
+	{
+		const FIntVector2 Cell = Heightmap->GetCell(GetNodeCell(Node));
+		return FVector2f((float)(GoalCell.X - Cell.X), (float)(GoalCell.Y - Cell.Y)).Length() * Params.LengthCostWeight;
+	};
+
+	AbstractFrontier.Reset(Nodes.Num() + 2);
+	AbstractSearchState.BeginQuery(Nodes.Num() + 2);
+
+	AbstractFrontier.Push(FAStarNode(Heuristic(SourceNode), 0, SourceNode));
+	AbstractSearchState.Open(SourceNode, 0, SourceNode);
+
+	auto Relax = [this, &Heuristic](const FAStarNode& Current, int32 Next, float EdgeCost)
+	{
+		const float DistanceFromStart = Current.DistanceFromStart + EdgeCost;
+
+		if (AbstractSearchState.IsVisited(Next) && AbstractSearchState.GetDistanceFromStart(Next) <= DistanceFromStart)
+		{
+			return;
+		}
+
+		AbstractSearchState.Open(Next, DistanceFromStart, Current.Index);
+		AbstractFrontier.PushOrUpdate(FAStarNode(DistanceFromStart + Heuristic(Next), DistanceFromStart, Next));
+	};
+
+	bool bFound = false;
+
+	while (!AbstractFrontier.IsEmpty())
+	{
+		if (bCancelled && bCancelled->load(std::memory_order_relaxed))
+		{
+			return false;
+		}
+
+		const FAStarNode Current = AbstractFrontier.Pop();
+		NodesPopped++;
+
+		if (Current.Index == DestinationNode)
+		{
+			bFound = true;
+			break;
+		}
+
+		AbstractSearchState.Close(Current.Index);
+		NodesExpanded++;
+
+		if (Current.Index == SourceNode)
+		{
+			for (int32 i = 0; i < SourceTargets.Num(); i++)
+			{
+				if (SourceCosts[i] != MAX_flt)
+				{
+					Relax(Current, i < NumSourceEntrances ? Hierarchy.FindNode(SourceTargets[i]) : DestinationNode, SourceCosts[i]);
+				}
+			}
+
+			continue;
+		}
+
+		for (const FQuantizerAbstractEdge& Edge : Nodes[Current.Index].Edges)
+		{
+			Relax(Current, Edge.Target, Edge.Cost);
+		}
+
+		if (const float* GoalCost = GoalEdges.Find(Current.Index))
+		{
+			Relax(Current, DestinationNode, *GoalCost);
+		}
+	}
+
+	if (!bFound)
+	{
+		return false;
+	}
+
+	//Abstract path from source to destination
+	TArray<int32> Waypoints;
+
+	for (int32 Node = DestinationNode; ; Node = AbstractSearchState.GetParent(Node))
+	{
+		Waypoints.Insert(GetNodeCell(Node), 0);
+
+		if (Node == SourceNode)
+		{
+			break;
+		}
+	}
+
+	//Refine every leg inside the cluster it crosses, legs between clusters are a single step across a border
+	TArray<int32> Cells;
+	Cells.Add(SourceIndex);
+
+	TArray<int32> LegCells;
+
+	for (int32 Leg = 0; Leg + 1 < Waypoints.Num(); Leg++)
+	{
+		const int32 From = Waypoints[Leg];
+		const int32 To = Waypoints[Leg + 1];
+
+		if (From == To)
+		{
+			continue;
+		}
+
+		const int32 Cluster = Hierarchy.GetClusterIndex(Heightmap->GetCell(From));
+
+		if (Cluster != Hierarchy.GetClusterIndex(Heightmap->GetCell(To)))
+		{
+			Cells.Add(To);
+			continue;
+		}
+
+		SetSearchBounds(Hierarchy.GetCluster(Cluster).Bounds);
+		const bool bRefined = FindGridPath(From, To, LegCells, bCancelled);
+		ClearSearchBounds();
+
+		if (!bRefined)
+		{
+			return false;
+		}
+
+		//Leg cells run from To back to From, which is already in the path
+		for (int32 i = LegCells.Num() - 2; i >= 0; i--)
+		{
+			Cells.Add(LegCells[i]);
+		}
+	}
+
+	//Same order as FindGridPath, destination back to source
+	OutCells.Reset(Cells.Num());
+
+	for (int32 i = Cells.Num() - 1; i >= 0; i--)
+	{
+		OutCells.Add(Cells[i]);
+	}
+
+	return true;
+}
+
+
+bool FQuantizerPathfinder::FindJumpPointPath(int32 SourceIndex, int32 DestinationIndex, TArray<int32>& OutCells, const std::atomic<bool>* bCancelled)
+{
+	OutCells.Reset();
+
+	const FQuantizerJumpPoints& JumpPoints = *Params.JumpPoints;
+
+	DestinationCell = Heightmap->GetCell(DestinationIndex);
+
+	auto Heuristic = [this](const FIntVector2& Cell)
+	{
+		return FVector2f((float)(DestinationCell.X - Cell.X), (float)(DestinationCell.Y - Cell.Y)).Length() * Params.LengthCostWeight;
+	};
+
+	Frontier.Reset(Heightmap->Num());
+	SearchState.BeginQuery(Heightmap->Num());
+
+	Frontier.Push(FAStarNode(Heuristic(Heightmap->GetCell(SourceIndex)), 0, SourceIndex));
+	NodesGenerated++;
+	SearchState.Open(SourceIndex, 0, SourceIndex);
+
+	while (!Frontier.IsEmpty())
+	{
+		if (bCancelled && bCancelled->load(std::memory_order_relaxed))
+		{
+			return false;
+		}
+
+		const FAStarNode Current = PopLowestCostNode();
+
+		if (Current.Index == DestinationIndex)
+		{
+			//Parents are jump points, fill in the straight and diagonal runs between them
+			int32 CurrentIndex = Current.Index;
+			OutCells.Add(CurrentIndex);
+
+			while (CurrentIndex != SearchState.GetParent(CurrentIndex))
+			{
+				const int32 ParentIndex = SearchState.GetParent(CurrentIndex);
+
+				FIntVector2 Cell = Heightmap->GetCell(CurrentIndex);
+				const FIntVector2 ParentCell = Heightmap->GetCell(ParentIndex);
+				const FIntVector2 Step(FMath::Sign(ParentCell.X - Cell.X), FMath::Sign(ParentCell.Y - Cell.Y));
+
+				while (Cell != ParentCell)
+				{
+					Cell.X += Step.X;
+					Cell.Y += Step.Y;
+					OutCells.Add(Heightmap->GetIndex(Cell));
+				}
+
+				CurrentIndex = ParentIndex;
+			}
+
+			return true;
+		}
+
+		SearchState.Close(Current.Index);
+		NodesExpanded++;
+
+		const FIntVector2 CurrentCell = Heightmap->GetCell(Current.Index);
+		const int32 ParentIndex = SearchState.GetParent(Current.Index);
+
+		//Direction the node was entered in, none for the start
+		int32 Direction = INDEX_NONE;
+
+		if (ParentIndex != Current.Index)
+		{
+			const FIntVector2 ParentCell = Heightmap->GetCell(ParentIndex);
+			Direction = FQuantizerJumpPoints::GetDirection(CurrentCell.X - ParentCell.X, CurrentCell.Y - ParentCell.Y);
+		}
+
+		const uint8 SuccessorDirections = JumpPoints.GetSuccessorDirections(CurrentCell, Direction);
+
+		for (int32 NextDirection = 0; NextDirection < FQuantizerJumpPoints::NumDirections; NextDirection++)
+		{
+			if (!(SuccessorDirections & (1 << NextDirection)))
+			{
+				continue;
+			}
+
+			int32 Steps = 0;
+			const int32 NextIndex = Jump(CurrentCell, NextDirection, DestinationIndex, Steps);
+
+			if (NextIndex == INDEX_NONE)
+			{
+				continue;
+			}
+
+			const float DistanceFromStart = Current.DistanceFromStart + Steps * FQuantizerJumpPoints::GetStepLength(NextDirection) * Params.LengthCostWeight;
+
+			if (SearchState.IsVisited(NextIndex) && SearchState.GetDistanceFromStart(NextIndex) <= DistanceFromStart)
+			{
+				continue;
+			}
+
+			SearchState.Open(NextIndex, DistanceFromStart, Current.Index);
+			Frontier.PushOrUpdate(FAStarNode(DistanceFromStart + Heuristic(Heightmap->GetCell(NextIndex)), DistanceFromStart, NextIndex));
+			NodesGenerated++;
+		}
+
+		PeakFrontierSize = FMath::Max(PeakFrontierSize, Frontier.Num());
+	}
+
+	return false;
+}
+
+
+int32 FQuantizerPathfinder::Jump(FIntVector2 Cell, int32 Direction, int32 DestinationIndex, int32& OutSteps) const
+{
+	const FQuantizerJumpPoints& JumpPoints = *Params.JumpPoints;
+	const FIntVector2 Step = FQuantizerJumpPoints::Directions[Direction];
+	const bool bDiagonal = (Direction & 1) != 0;
+
+	int32 Index = Heightmap->GetIndex(Cell);
+	OutSteps = 0;
+
+	while (true)
+	{
+		//Edge mask already knows whether the next cell is on the grid, valid and not too steep
+		if (!JumpPoints.IsTraversable(Index, Direction))
+		{
+			return INDEX_NONE;
+		}
+
+		Cell.X += Step.X;
+		Cell.Y += Step.Y;
+		Index = Heightmap->GetIndex(Cell);
+		OutSteps++;
+
+		if (Index == DestinationIndex || JumpPoints.IsJumpPoint(Index, Direction))
+		{
+			return Index;
+		}
+
+		//Diagonal jumps stop where either of their straight components finds something
+		if (bDiagonal)
+		{
+			int32 StraightSteps;
+
+			if (Jump(Cell, (Direction + 1) & 7, DestinationIndex, StraightSteps) != INDEX_NONE
+				|| Jump(Cell, (Direction + 7) & 7, DestinationIndex, StraightSteps) != INDEX_NONE)
+			{
+				return Index;
+			}
+		}
+	}
+}
+
+
+void FQuantizerPathfinder::SetSearchBounds(const FIntRect& Bounds)
+{
+	SearchBounds = Bounds;
+	bBounded = true;
+}
+
+
+void FQuantizerPathfinder::ClearSearchBounds()
+{
+	bBounded = false;
+}
+
+
+FAStarNode FQuantizerPathfinder::PopLowestCostNode()
+{
+#if QUANTIZER_PER_NODE_STATS
+	SCOPE_CYCLE_COUNTER(STAT_Quantizer_PopLowestCostNode);
+#endif
+
+	NodesPopped++;
+
+	//Remove lowest cost node from Frontier and return it
+	return Frontier.Pop();
+}
+
+
+void FQuantizerPathfinder::GenerateSuccessors(const FAStarNode& Current)
+{
+#if QUANTIZER_PER_NODE_STATS
+	SCOPE_CYCLE_COUNTER(STAT_Quantizer_GenerateSuccessors);
+#endif
+
+	const FIntVector2 CurrentCell = Heightmap->GetCell(Current.Index);
+
+	//Neighbors that are valid and not too steep to move to
+	const uint32 Edges = Params.EdgeMask->GetEdges(Current.Index);
+
+#if QUANTIZER_VERBOSE_LOGGING
+	//Edges that lead off the grid, to a missed trace or up a slope above the angle threshold
+	for (uint32 Blocked = ~Edges & SuccessorKernel.GetValidBits(); Blocked != 0; Blocked &= Blocked - 1)
+	{
+		const int32 i = (int32)FMath::CountTrailingZeros(Blocked);
+		const FIntVector2 NextCell(CurrentCell.X + Params.MaskPoints[i].X, CurrentCell.Y + Params.MaskPoints[i].Y);
+
+		if (!Heightmap->IsCellValid(NextCell.X, NextCell.Y))
+		{
+			const FVector NextLocation = Heightmap->GetCellWorldLocation(NextCell.X, NextCell.Y);
+			UE_LOG(LogTemp, Display, TEXT("Grid point not valid at (%i, %i)"), (int32)NextLocation.X, (int32)NextLocation.Y);
+		}
+	}
+#endif
+
+	//Cost every traversable neighbor at once
+	FQuantizerSuccessor Successors[FQuantizerSuccessorKernel::MaxMaskPoints];
+	const int32 NumSuccessors = SuccessorKernel.Evaluate(CurrentCell, Current.DistanceFromStart, Edges, DestinationCell, Successors);
+
+	for (int32 SuccessorIndex = 0; SuccessorIndex < NumSuccessors; SuccessorIndex++)
+	{
+		const FQuantizerSuccessor& Successor = Successors[SuccessorIndex];
+		const FIntVector2& Offset = Params.MaskPoints[Successor.MaskIndex];
+
+		const FIntVector2 NextCell(CurrentCell.X + Offset.X, CurrentCell.Y + Offset.Y);
+
+		if (bBounded && !SearchBounds.Contains(FIntPoint(NextCell.X, NextCell.Y)))
+		{
+			continue;
+		}
+
+		const FAStarNode NextNode(Successor.Cost, Successor.DistanceFromStart, Heightmap->GetIndex(NextCell));
+
+		if (SearchCorridor && !(*SearchCorridor)[NextNode.Index])
+		{
+			continue;
+		}
+
+		//Ignore this node if it is already open or closed with a lower cost
+		if (SearchState.IsVisited(NextNode.Index) && SearchState.GetDistanceFromStart(NextNode.Index) <= NextNode.DistanceFromStart)
+		{
+			continue;
+		}
+
+		//Set cost and parent, reopens the node if it was closed
+		SearchState.Open(NextNode.Index, NextNode.DistanceFromStart, Current.Index);
+
+		//Add to frontier, or lower the cost of the node already on it
+		Frontier.PushOrUpdate(NextNode);
+		NodesGenerated++;
+	}
+
+	PeakFrontierSize = FMath::Max(PeakFrontierSize, Frontier.Num());
+}
+
+
+void FQuantizerPathfinder::TraceBackPath(int32 LastIndex, TArray<int32>& OutCells) const
+{
+	OutCells.Add(LastIndex);
+
+	int32 CurrentIndex = LastIndex;
+
+	//Trace back until you reach the start
+	while (CurrentIndex != SearchState.GetParent(CurrentIndex))
+	{
+		//Move to next node
+		CurrentIndex = SearchState.GetParent(CurrentIndex);
+
+		//Add current location to array
+		OutCells.Add(CurrentIndex);
+	}
+}
+
+
+void FQuantizerPathfinder::PublishStats() const
+{
+	INC_DWORD_STAT_BY(STAT_Quantizer_NodesPopped, NodesPopped);
+	INC_DWORD_STAT_BY(STAT_Quantizer_NodesExpanded, NodesExpanded);
+	INC_DWORD_STAT_BY(STAT_Quantizer_NodesGenerated, NodesGenerated);
+	SET_DWORD_STAT(STAT_Quantizer_PeakFrontierSize, PeakFrontierSize);
+
+	CSV_CUSTOM_STAT(Quantizer, NodesPopped, NodesPopped, ECsvCustomStatOp::Accumulate);
+	CSV_CUSTOM_STAT(Quantizer, NodesExpanded, NodesExpanded, ECsvCustomStatOp::Accumulate);
+	CSV_CUSTOM_STAT(Quantizer, NodesGenerated, NodesGenerated, ECsvCustomStatOp::Accumulate);
+	CSV_CUSTOM_STAT(Quantizer, PeakFrontierSize, PeakFrontierSize, ECsvCustomStatOp::Max);
+}
+
+
+SIZE_T FQuantizerPathfinder::GetAllocatedSize() const
+{
+	return Frontier.GetAllocatedSize() + BackwardFrontier.GetAllocatedSize() + SearchState.GetAllocatedSize() + (Params.EdgeMask.IsValid() ? Params.EdgeMask->GetAllocatedSize() : 0);
+}
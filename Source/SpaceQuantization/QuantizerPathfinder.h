@@ -0,0 +1,379 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "QuantizedHeightmap.h"
+#include "QuantizerOpenList.h"
+#include "QuantizerSearchState.h"
+#include "QuantizerEdgeMask.h"
+#include "QuantizerSuccessorKernel.h"
+#include "QuantizerHierarchy.h"
+#include "QuantizerJumpPoints.h"
+#include "QuantizerHeightmapPyramid.h"
+
+#include <atomic>
+
+#include "QuantizerPathfinder.generated.h"
+
+/// <summary>
+/// Nodes used in A* algorithm
+/// </summary>
+USTRUCT()
+struct FAStarNode
+{
+	GENERATED_BODY()
+
+	float Cost;	//Cost heuristic
+	float DistanceFromStart;	//Distance (euclidean) from start node
+	int32 Index;	//Index of this node's cell in the heightmap, parent is kept in the search state
+
+	FAStarNode()
+		: Cost(0), DistanceFromStart(0), Index(INDEX_NONE)
+	{}
+
+	FAStarNode(float _Cost, float _DistanceFromStart, int32 _Index)
+	: Cost(_Cost), DistanceFromStart(_DistanceFromStart), Index(_Index)
+	{}
+
+	FAStarNode(const FAStarNode& Other)
+		: Cost(Other.Cost), DistanceFromStart(Other.DistanceFromStart), Index(Other.Index)
+	{}
+
+	FAStarNode& operator=(const FAStarNode& Other) = default;
+
+	bool operator==(const FAStarNode& Other) const
+	{
+		return Equals(Other);
+	}
+
+	bool operator<(const FAStarNode& Other) const
+	{
+		return Cost < Other.Cost;
+	}
+
+	bool Equals(const FAStarNode& Other) const
+	{
+		return Index == Other.Index;
+	}
+
+	static bool CompareLess(const FAStarNode& l, const FAStarNode& r)
+	{
+		return l.Cost > r.Cost;
+	}
+};
+
+/// <summary>
+/// Allows FAStarNode to be used as a key in a TMap
+/// </summary>
+/// <param name="Thing"></param>
+/// <returns></returns>
+FORCEINLINE uint32 GetTypeHash(const FAStarNode& Thing)
+{
+	uint32 Hash = FCrc::MemCrc32(&Thing, sizeof(FAStarNode));
+	return Hash;
+}
+
+/// <summary>
+/// Algorithm a path query runs
+/// </summary>
+UENUM(BlueprintType)
+enum class EQuantizerSearchMode : uint8
+{
+	//A* over every cell of the grid
+	AStar,
+	//A* over the cluster graph of an FQuantizerHierarchy, then over the cells of the clusters on the way
+	Hierarchical,
+	//Jump Point Search, same paths as A* with far fewer nodes on the open list. Needs an 8-connected SampleMask
+	JumpPoint,
+	//D* Lite that repairs the previous search when an end of the path or the terrain moves. Only ComputePath keeps
+	//its search between calls, asynchronous and batched queries run A*
+	Incremental,
+	//A* from both ends at once, stops once neither frontier can improve on the best path where they met
+	Bidirectional,
+	//A* on a coarse level of an FQuantizerHeightmapPyramid, then inside a corridor around that path on every finer
+	//level. Much faster on long queries, paths can be slightly longer than with A*
+	CoarseToFine
+};
+
+/// <summary>
+/// State of a search started with FQuantizerPathfinder::BeginSearch
+/// </summary>
+UENUM(BlueprintType)
+enum class EQuantizerSearchStatus : uint8
+{
+	InProgress,
+	Succeeded,
+	Failed
+};
+
+/// <summary>
+/// Settings a search reads, copied out of the Quantizer so searches can run off the game thread
+/// </summary>
+struct FQuantizerSearchParams
+{
+	//Weights of different types of costs in A* calculation
+	float LengthCostWeight = 1;
+	float AngleCostWeight = 1;
+
+	//Max angle of path
+	float MaxAngleThreshold = 15.f;
+
+	//Cell offsets of the neighbors of every node
+	TArray<FIntVector2> MaskPoints;
+
+	//Traversable edges for MaskPoints and MaxAngleThreshold, built by the search if missing or out of date
+	FQuantizerEdgeMaskPtr EdgeMask;
+
+	EQuantizerSearchMode SearchMode = EQuantizerSearchMode::AStar;
+
+	//Cluster graph used by EQuantizerSearchMode::Hierarchical, the search falls back to A* if it is missing or out of date
+	FQuantizerHierarchyPtr Hierarchy;
+
+	//Cluster width Hierarchy has to be built with to be used
+	int32 HierarchyClusterSize = 32;
+
+	//Forced neighbors used by EQuantizerSearchMode::JumpPoint, the search falls back to A* if it is missing or out of date
+	FQuantizerJumpPointsPtr JumpPoints;
+
+	//Coarse levels used by EQuantizerSearchMode::CoarseToFine, the search falls back to A* if it is missing or out of date
+	FQuantizerHeightmapPyramidPtr Pyramid;
+
+	//Cells a coarse path is widened by on every side before the next level searches inside it, wider corridors give
+	//paths closer to A* at the cost of more expansions
+	int32 CorridorRadius = 2;
+
+	EQuantizerSuccessorKernel Kernel = EQuantizerSuccessorKernel::Specialized;
+};
+
+/// <summary>
+/// A* search over a quantized heightmap. Owns the open list and per-cell state so one instance can be reused
+/// for many queries, and only reads the heightmap so any number of instances can share one snapshot
+/// </summary>
+class SPACEQUANTIZATION_API FQuantizerPathfinder
+{
+public:
+
+	/// <summary>
+	/// Set the heightmap and settings used by following queries
+	/// </summary>
+	/// <param name="InHeightmap"></param>
+	/// <param name="InParams"></param>
+	void Init(FQuantizedHeightmapPtr InHeightmap, const FQuantizerSearchParams& InParams);
+
+	/// <summary>
+	/// Compute the path between two heightmap cells
+	/// </summary>
+	/// <param name="SourceIndex"></param>
+	/// <param name="DestinationIndex"></param>
+	/// <param name="OutCells">Cells of the path from destination back to source</param>
+	/// <param name="bCancelled">Optional flag polled every expansion, the search gives up once it is set</param>
+	/// <returns>Success</returns>
+	bool FindPath(int32 SourceIndex, int32 DestinationIndex, TArray<int32>& OutCells, const std::atomic<bool>* bCancelled = nullptr);
+
+	/// <summary>
+	/// Start an A* search that is run a slice at a time with StepSearch, the search mode is ignored
+	/// </summary>
+	/// <param name="SourceIndex"></param>
+	/// <param name="DestinationIndex"></param>
+	/// <returns>False if there is no heightmap</returns>
+	bool BeginSearch(int32 SourceIndex, int32 DestinationIndex);
+
+	/// <summary>
+	/// Continue the search started with BeginSearch until it finishes or runs out of budget
+	/// </summary>
+	/// <param name="MaxNodes">Most nodes to expand in this call</param>
+	/// <param name="MaxSeconds">Time budget of this call, 0 for none</param>
+	/// <param name="bCancelled">Optional flag polled every expansion, the search fails once it is set</param>
+	/// <returns></returns>
+	EQuantizerSearchStatus StepSearch(int32 MaxNodes, double MaxSeconds, const std::atomic<bool>* bCancelled = nullptr);
+
+	FORCEINLINE EQuantizerSearchStatus GetSearchStatus() const
+	{
+		return SearchStatus;
+	}
+
+	/// <summary>
+	/// Path of a finished search, or the best one so far, ending at the expanded node closest to the destination
+	/// </summary>
+	/// <param name="OutCells">Cells of the path from its last cell back to source</param>
+	void GetSearchPath(TArray<int32>& OutCells) const;
+
+	/// <summary>
+	/// How much closer to the destination the search has got, 0 at the start and 1 once it succeeded
+	/// </summary>
+	float GetSearchProgress() const;
+
+	/// <summary>
+	/// Change the algorithm of following queries without calling Init again
+	/// </summary>
+	FORCEINLINE void SetSearchMode(EQuantizerSearchMode InSearchMode)
+	{
+		Params.SearchMode = InSearchMode;
+	}
+
+	/// <summary>
+	/// Only search cells inside Bounds until ClearSearchBounds is called
+	/// </summary>
+	/// <param name="Bounds">Max is exclusive</param>
+	void SetSearchBounds(const FIntRect& Bounds);
+
+	void ClearSearchBounds();
+
+	/// <summary>
+	/// Pops the lowest cost node off the Frontier
+	/// </summary>
+	/// <returns></returns>
+	FAStarNode PopLowestCostNode();
+
+	/// <summary>
+	/// Use grid mask to generate A* successors, costs and heuristics are computed by SuccessorKernel
+	/// </summary>
+	/// <param name="Current"></param>
+	void GenerateSuccessors(const FAStarNode& Current);
+
+	/// <summary>
+	/// Trace back path from the passed cell to the start
+	/// </summary>
+	/// <param name="LastIndex"></param>
+	/// <param name="OutCells"></param>
+	void TraceBackPath(int32 LastIndex, TArray<int32>& OutCells) const;
+
+	/// <summary>
+	/// Number of nodes expanded by the last query
+	/// </summary>
+	FORCEINLINE int32 GetNodesExpanded() const
+	{
+		return NodesExpanded;
+	}
+
+	/// <summary>
+	/// Number of nodes put on or moved up a frontier by the last query
+	/// </summary>
+	FORCEINLINE int32 GetNodesGenerated() const
+	{
+		return NodesGenerated;
+	}
+
+	/// <summary>
+	/// Add the counters of the last query to the Quantizer stats group, FindPath does this itself once it finishes
+	/// </summary>
+	void PublishStats() const;
+
+	FORCEINLINE const FQuantizedHeightmap& GetHeightmap() const
+	{
+		return *Heightmap;
+	}
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+
+	/// <summary>
+	/// Check the heightmap and build the edge mask if it is missing or out of date
+	/// </summary>
+	/// <returns>False if there is no heightmap</returns>
+	bool PrepareQuery();
+
+	/// <summary>
+	/// Reset the frontier and search state and open the source
+	/// </summary>
+	void BeginGridSearch(int32 SourceIndex, int32 DestinationIndex);
+
+	/// <summary>
+	/// A* over the cells of the grid, adds to NodesExpanded
+	/// </summary>
+	bool FindGridPath(int32 SourceIndex, int32 DestinationIndex, TArray<int32>& OutCells, const std::atomic<bool>* bCancelled);
+
+	/// <summary>
+	/// A* over the hierarchy's abstract graph, refined one cluster at a time with FindGridPath
+	/// </summary>
+	bool FindHierarchicalPath(int32 SourceIndex, int32 DestinationIndex, TArray<int32>& OutCells, const std::atomic<bool>* bCancelled);
+
+	/// <summary>
+	/// Jump Point Search over the cells of the grid, only jump points go on the frontier
+	/// </summary>
+	bool FindJumpPointPath(int32 SourceIndex, int32 DestinationIndex, TArray<int32>& OutCells, const std::atomic<bool>* bCancelled);
+
+	/// <summary>
+	/// A* from the source and from the destination, sharing SearchState, until the best meeting cell is proven shortest
+	/// </summary>
+	bool FindBidirectionalPath(int32 SourceIndex, int32 DestinationIndex, TArray<int32>& OutCells, const std::atomic<bool>* bCancelled);
+
+	/// <summary>
+	/// Open the neighbors of a node in one direction of a bidirectional search and record where the directions meet
+	/// </summary>
+	void GenerateBidirectionalSuccessors(const FAStarNode& Current, FQuantizerSearchState::EDirection Direction);
+
+	/// <summary>
+	/// A* on the coarsest usable pyramid level, then on every finer level inside a corridor around the path above
+	/// </summary>
+	bool FindCoarseToFinePath(int32 SourceIndex, int32 DestinationIndex, TArray<int32>& OutCells, const std::atomic<bool>* bCancelled);
+
+	/// <summary>
+	/// Edges into a cell, bit i is set when the cell at Cell - MaskPoints[i] can move to it along MaskPoints[i]
+	/// </summary>
+	uint32 GetIncomingEdges(const FIntVector2& Cell) const;
+
+	/// <summary>
+	/// Step from a cell in one direction until reaching the destination, a jump point or a blocked edge
+	/// </summary>
+	/// <returns>Cell the jump stopped at, INDEX_NONE if it was blocked</returns>
+	int32 Jump(FIntVector2 Cell, int32 Direction, int32 DestinationIndex, int32& OutSteps) const;
+
+	FQuantizedHeightmapPtr Heightmap;
+	FQuantizerSearchParams Params;
+
+	//A* Data Structures
+	TQuantizerIndexedHeap<FAStarNode> Frontier;	//Unexplored nodes, lowest cost on top
+	FQuantizerSearchState SearchState;	//Per-cell cost, parent and open/closed status
+
+	//Grid point of the destination, cached at the start of every query
+	FIntVector2 DestinationCell;
+
+	//Costs all neighbors of an expanded node together
+	FQuantizerSuccessorKernel SuccessorKernel;
+
+	//Backward half of bidirectional queries, the kernel has the mask negated so it costs the cells a node is reached from
+	TQuantizerIndexedHeap<FAStarNode> BackwardFrontier;
+	FQuantizerSuccessorKernel BackwardKernel;
+	FIntVector2 SourceCell;
+
+	//Cells outside of the corridor are skipped while it is set, indexed like the heightmap being searched
+	const TBitArray<>* SearchCorridor = nullptr;
+
+	//Search workspaces of the coarse pyramid levels, swapped in while their level is searched so each keeps its size
+	TArray<FQuantizerSearchState> LevelSearchStates;
+	TArray<TQuantizerIndexedHeap<FAStarNode>> LevelFrontiers;
+	TBitArray<> Corridor;
+
+	//Cell where the cheapest path between the two directions found so far crosses over, and its cost
+	int32 MeetingIndex = INDEX_NONE;
+	float MeetingCost = MAX_flt;
+
+	//Cells outside of SearchBounds are skipped while bBounded is set
+	FIntRect SearchBounds;
+	bool bBounded = false;
+
+	//Abstract graph search of hierarchical queries, indexed by abstract node
+	TQuantizerIndexedHeap<FAStarNode> AbstractFrontier;
+	FQuantizerSearchState AbstractSearchState;
+
+	//Nodes taken off a frontier, the goal included, and of those the ones whose neighbors were generated
+	int32 NodesPopped = 0;
+	int32 NodesExpanded = 0;
+	int32 NodesGenerated = 0;
+
+	//Most nodes on the frontiers at once during the last query
+	int32 PeakFrontierSize = 0;
+
+	//Destination and state of the current grid search
+	int32 SearchDestination = INDEX_NONE;
+	EQuantizerSearchStatus SearchStatus = EQuantizerSearchStatus::Failed;
+
+	//Expanded node closest to the destination, end of the best path so far
+	int32 ClosestIndex = INDEX_NONE;
+	float ClosestHeuristic = 0;
+	float StartHeuristic = 0;
+};
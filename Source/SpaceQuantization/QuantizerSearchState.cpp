@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "QuantizerSearchState.h"
+
+void FQuantizerSearchState::BeginQuery(int32 NumCells, bool bBidirectional)
+{
+	if (Stamps.Num() != NumCells)
+	{
+		//New grid, every stamp starts out stale
+		DistanceFromStart[0].SetNumUninitialized(NumCells);
+		Parents[0].SetNumUninitialized(NumCells);
+		Stamps.Init(0, NumCells);
+
+		//Backward costs are only kept once a bidirectional query needs them
+		DistanceFromStart[1].Empty();
+		Parents[1].Empty();
+
+		Generation = 0;
+	}
+
+	if (bBidirectional && Parents[1].Num() != NumCells)
+	{
+		DistanceFromStart[1].SetNumUninitialized(NumCells);
+		Parents[1].SetNumUninitialized(NumCells);
+	}
+
+	Generation++;
+
+	//Stamps from a wrapped generation would read as current, clear them once every MaxGeneration queries
+	if (Generation > MaxGeneration)
+	{
+		FMemory::Memzero(Stamps.GetData(), Stamps.Num() * sizeof(uint32));
+		Generation = 1;
+	}
+}
+
+
+SIZE_T FQuantizerSearchState::GetAllocatedSize() const
+{
+	return DistanceFromStart[0].GetAllocatedSize() + DistanceFromStart[1].GetAllocatedSize()
+		+ Parents[0].GetAllocatedSize() + Parents[1].GetAllocatedSize() + Stamps.GetAllocatedSize();
+}
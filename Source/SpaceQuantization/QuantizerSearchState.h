@@ -0,0 +1,117 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/// <summary>
+/// Per-cell A* bookkeeping indexed like the heightmap. Every cell's stamp holds the generation of the query that
+/// last touched it, so cells left over from earlier queries read as unvisited and nothing is cleared between queries
+/// </summary>
+struct SPACEQUANTIZATION_API FQuantizerSearchState
+{
+	enum class ECellStatus : uint32
+	{
+		Unvisited = 0,
+		Open = 1,
+		Closed = 2
+	};
+
+	/// <summary>
+	/// Bidirectional searches keep a status, cost and parent per direction, the forward search is the only one otherwise
+	/// </summary>
+	enum class EDirection : uint32
+	{
+		Forward = 0,
+		Backward = 1
+	};
+
+	/// <summary>
+	/// Start a new query over a grid of NumCells cells, only allocates when the grid size changes
+	/// </summary>
+	/// <param name="NumCells"></param>
+	/// <param name="bBidirectional">Also keep costs and parents for the backward direction</param>
+	void BeginQuery(int32 NumCells, bool bBidirectional = false);
+
+	FORCEINLINE ECellStatus GetStatus(int32 Index, EDirection Direction = EDirection::Forward) const
+	{
+		const uint32 Stamp = Stamps[Index];
+		return (Stamp >> StatusBits) == Generation ? (ECellStatus)((Stamp >> GetShift(Direction)) & DirectionMask) : ECellStatus::Unvisited;
+	}
+
+	FORCEINLINE bool IsVisited(int32 Index, EDirection Direction = EDirection::Forward) const
+	{
+		return GetStatus(Index, Direction) != ECellStatus::Unvisited;
+	}
+
+	FORCEINLINE bool IsClosed(int32 Index, EDirection Direction = EDirection::Forward) const
+	{
+		return GetStatus(Index, Direction) == ECellStatus::Closed;
+	}
+
+	/// <summary>
+	/// Cost from the start of a visited cell
+	/// </summary>
+	FORCEINLINE float GetDistanceFromStart(int32 Index, EDirection Direction = EDirection::Forward) const
+	{
+		return DistanceFromStart[(uint32)Direction][Index];
+	}
+
+	/// <summary>
+	/// Cell a visited cell was reached from, the start cell is its own parent
+	/// </summary>
+	FORCEINLINE int32 GetParent(int32 Index, EDirection Direction = EDirection::Forward) const
+	{
+		return Parents[(uint32)Direction][Index];
+	}
+
+	/// <summary>
+	/// Record a new best cost and parent for a cell and put it on the open list
+	/// </summary>
+	FORCEINLINE void Open(int32 Index, float InDistanceFromStart, int32 Parent, EDirection Direction = EDirection::Forward)
+	{
+		DistanceFromStart[(uint32)Direction][Index] = InDistanceFromStart;
+		Parents[(uint32)Direction][Index] = Parent;
+		SetStatus(Index, ECellStatus::Open, Direction);
+	}
+
+	/// <summary>
+	/// Move an open cell to the closed list
+	/// </summary>
+	FORCEINLINE void Close(int32 Index, EDirection Direction = EDirection::Forward)
+	{
+		SetStatus(Index, ECellStatus::Closed, Direction);
+	}
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+
+	//Two bits of status per direction below the generation
+	static constexpr uint32 DirectionBits = 2;
+	static constexpr uint32 DirectionMask = (1u << DirectionBits) - 1;
+	static constexpr uint32 StatusBits = DirectionBits * 2;
+	static constexpr uint32 MaxGeneration = MAX_uint32 >> StatusBits;
+
+	static FORCEINLINE uint32 GetShift(EDirection Direction)
+	{
+		return (uint32)Direction * DirectionBits;
+	}
+
+	FORCEINLINE void SetStatus(int32 Index, ECellStatus Status, EDirection Direction)
+	{
+		const uint32 Shift = GetShift(Direction);
+		const uint32 Stamp = Stamps[Index];
+
+		//Keep the other direction's status if this query already touched the cell
+		const uint32 Current = (Stamp >> StatusBits) == Generation ? Stamp : (Generation << StatusBits);
+
+		Stamps[Index] = (Current & ~(DirectionMask << Shift)) | ((uint32)Status << Shift);
+	}
+
+	TArray<float> DistanceFromStart[2];	//g cost of every visited cell, per direction
+	TArray<int32> Parents[2];			//Parent cell of every visited cell, per direction
+	TArray<uint32> Stamps;				//Generation and status of every cell, shared by both directions
+
+	uint32 Generation = 0;	//Generation of the current query, stamps from other generations are stale
+};
@@ -0,0 +1,26 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "QuantizerStats.h"
+
+DEFINE_STAT(STAT_Quantizer_GenerateHeightmap);
+DEFINE_STAT(STAT_Quantizer_ComputePath);
+DEFINE_STAT(STAT_Quantizer_ComputePaths);
+DEFINE_STAT(STAT_Quantizer_FindPath);
+DEFINE_STAT(STAT_Quantizer_SmoothPath);
+DEFINE_STAT(STAT_Quantizer_DrawPath);
+DEFINE_STAT(STAT_Quantizer_StepSearch);
+
+DEFINE_STAT(STAT_Quantizer_PopLowestCostNode);
+DEFINE_STAT(STAT_Quantizer_GenerateSuccessors);
+
+DEFINE_STAT(STAT_Quantizer_NodesPopped);
+DEFINE_STAT(STAT_Quantizer_NodesExpanded);
+DEFINE_STAT(STAT_Quantizer_NodesGenerated);
+
+DEFINE_STAT(STAT_Quantizer_PeakFrontierSize);
+DEFINE_STAT(STAT_Quantizer_PathLength);
+
+DEFINE_STAT(STAT_Quantizer_HeightmapMemory);
+
+CSV_DEFINE_CATEGORY_MODULE(SPACEQUANTIZATION_API, Quantizer, true);
@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+//Log every blocked neighbor and finished search, far too slow to leave on. Set to 1 here or in PublicDefinitions to debug searches
+#ifndef QUANTIZER_VERBOSE_LOGGING
+#define QUANTIZER_VERBOSE_LOGGING 0
+#endif
+
+//Time PopLowestCostNode and GenerateSuccessors for every node. A scope costs about as much as the node itself, so
+//searches get noticeably slower while it is on. Set to 1 here or in PublicDefinitions to split a search into its parts
+#ifndef QUANTIZER_PER_NODE_STATS
+#define QUANTIZER_PER_NODE_STATS 0
+#endif
+
+//"stat Quantizer" in the console
+DECLARE_STATS_GROUP(TEXT("Quantizer"), STATGROUP_Quantizer, STATCAT_Advanced);
+
+//Phases, also traced to Insights and CSV captures through QUANTIZER_SCOPE
+DECLARE_CYCLE_STAT_EXTERN(TEXT("GenerateHeightmap"), STAT_Quantizer_GenerateHeightmap, STATGROUP_Quantizer, SPACEQUANTIZATION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("ComputePath"), STAT_Quantizer_ComputePath, STATGROUP_Quantizer, SPACEQUANTIZATION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("ComputePaths"), STAT_Quantizer_ComputePaths, STATGROUP_Quantizer, SPACEQUANTIZATION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("FindPath"), STAT_Quantizer_FindPath, STATGROUP_Quantizer, SPACEQUANTIZATION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("SmoothPath"), STAT_Quantizer_SmoothPath, STATGROUP_Quantizer, SPACEQUANTIZATION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("DrawPath"), STAT_Quantizer_DrawPath, STATGROUP_Quantizer, SPACEQUANTIZATION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("StepSearch"), STAT_Quantizer_StepSearch, STATGROUP_Quantizer, SPACEQUANTIZATION_API);
+
+//Per node, only timed with QUANTIZER_PER_NODE_STATS. The counters below are what to watch otherwise
+DECLARE_CYCLE_STAT_EXTERN(TEXT("PopLowestCostNode"), STAT_Quantizer_PopLowestCostNode, STATGROUP_Quantizer, SPACEQUANTIZATION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("GenerateSuccessors"), STAT_Quantizer_GenerateSuccessors, STATGROUP_Quantizer, SPACEQUANTIZATION_API);
+
+//Summed over every search of the frame
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Nodes Popped"), STAT_Quantizer_NodesPopped, STATGROUP_Quantizer, SPACEQUANTIZATION_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Nodes Expanded"), STAT_Quantizer_NodesExpanded, STATGROUP_Quantizer, SPACEQUANTIZATION_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Nodes Generated"), STAT_Quantizer_NodesGenerated, STATGROUP_Quantizer, SPACEQUANTIZATION_API);
+
+//Of the last search or path
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Peak Frontier Size"), STAT_Quantizer_PeakFrontierSize, STATGROUP_Quantizer, SPACEQUANTIZATION_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Path Length"), STAT_Quantizer_PathLength, STATGROUP_Quantizer, SPACEQUANTIZATION_API);
+
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Heightmap Memory"), STAT_Quantizer_HeightmapMemory, STATGROUP_Quantizer, SPACEQUANTIZATION_API);
+
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(SPACEQUANTIZATION_API, Quantizer);
+
+/// <summary>
+/// Time a phase in "stat Quantizer", as an Insights CPU event and in CSV profiler captures
+/// </summary>
+#define QUANTIZER_SCOPE(Name) \
+	SCOPE_CYCLE_COUNTER(STAT_Quantizer_##Name); \
+	TRACE_CPUPROFILER_EVENT_SCOPE(Quantizer_##Name); \
+	CSV_SCOPED_TIMING_STAT(Quantizer, Name)
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "QuantizerSuccessorKernel.h"
+
+void FQuantizerSuccessorKernel::Init(const TArray<FIntVector2>& MaskPoints, float InLengthCostWeight, EQuantizerSuccessorKernel Kernel)
+{
+	NumMaskPoints = FMath::Min(MaskPoints.Num(), MaxMaskPoints);
+	NumPadded = Align(NumMaskPoints, 4);
+	ValidBits = NumMaskPoints == 32 ? MAX_uint32 : (1u << NumMaskPoints) - 1;
+	LengthCostWeight = InLengthCostWeight;
+
+	for (int32 i = 0; i < MaxMaskPoints; i++)
+	{
+		const FIntVector2 Offset = i < NumMaskPoints ? MaskPoints[i] : FIntVector2(0, 0);
+
+		OffsetX[i] = (float)Offset.X;
+		OffsetY[i] = (float)Offset.Y;
+		StepCost[i] = FMath::Sqrt((float)(Offset.X * Offset.X + Offset.Y * Offset.Y)) * LengthCostWeight;
+	}
+
+	Shape = Kernel == EQuantizerSuccessorKernel::Specialized ? DetectShape(MaskPoints, ShapeToMask) : EQuantizerMaskShape::Generic;
+	bScalar = Kernel == EQuantizerSuccessorKernel::Scalar;
+}
+
+
+namespace QuantizerSuccessorKernel
+{
+	/// <summary>
+	/// Whether the mask holds exactly the offsets of a shape, and where each of them is
+	/// </summary>
+	template<EQuantizerMaskShape Shape>
+	static bool MatchShape(const TArray<FIntVector2>& MaskPoints, uint8* OutShapeToMask)
+	{
+		using FShape = TQuantizerMaskShape<Shape>;
+
+		if (MaskPoints.Num() != FShape::Num)
+		{
+			return false;
+		}
+
+		//Every offset of the shape found in a mask of the same size means the mask is that shape, duplicates would leave one missing
+		for (int32 i = 0; i < FShape::Num; i++)
+		{
+			const int32 MaskIndex = MaskPoints.Find(FIntVector2((int32)FShape::OffsetX[i], (int32)FShape::OffsetY[i]));
+
+			if (MaskIndex == INDEX_NONE)
+			{
+				return false;
+			}
+
+			OutShapeToMask[i] = (uint8)MaskIndex;
+		}
+
+		return true;
+	}
+}
+
+
+EQuantizerMaskShape FQuantizerSuccessorKernel::DetectShape(const TArray<FIntVector2>& MaskPoints, uint8* OutShapeToMask)
+{
+	using namespace QuantizerSuccessorKernel;
+
+	if (MatchShape<EQuantizerMaskShape::Connected4>(MaskPoints, OutShapeToMask))
+	{
+		return EQuantizerMaskShape::Connected4;
+	}
+
+	if (MatchShape<EQuantizerMaskShape::Connected8>(MaskPoints, OutShapeToMask))
+	{
+		return EQuantizerMaskShape::Connected8;
+	}
+
+	if (MatchShape<EQuantizerMaskShape::Connected16>(MaskPoints, OutShapeToMask))
+	{
+		return EQuantizerMaskShape::Connected16;
+	}
+
+	return EQuantizerMaskShape::Generic;
+}
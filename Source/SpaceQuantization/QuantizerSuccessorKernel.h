@@ -0,0 +1,295 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "QuantizerEdgeMask.h"
+
+#include "QuantizerSuccessorKernel.generated.h"
+
+/// <summary>
+/// Successor loop a search uses, only changed from Specialized to measure the loops against each other
+/// </summary>
+UENUM()
+enum class EQuantizerSuccessorKernel : uint8
+{
+	//Compile time tables for 4, 8 and 16-connected masks, Vector for any other mask
+	Specialized,
+	//Mask tables, four neighbors per vector instruction
+	Vector,
+	//Mask tables, one neighbor at a time
+	Scalar
+};
+
+/// <summary>
+/// A neighbor accepted by FQuantizerSuccessorKernel
+/// </summary>
+struct FQuantizerSuccessor
+{
+	int32 MaskIndex;	//Index of the neighbor's offset in the grid mask
+	float DistanceFromStart;	//g
+	float Cost;	//g + h
+};
+
+/// <summary>
+/// Grid masks with a specialised successor loop, any other mask uses the generic tables
+/// </summary>
+enum class EQuantizerMaskShape : uint8
+{
+	Generic,
+	//The four straight neighbors
+	Connected4,
+	//Straight and diagonal neighbors
+	Connected8,
+	//Connected8 plus the eight knight moves
+	Connected16
+};
+
+/// <summary>
+/// Offsets and step lengths of a mask shape known at compile time, so the successor loop has a fixed trip count
+/// and constant operands
+/// </summary>
+template<EQuantizerMaskShape Shape>
+struct TQuantizerMaskShape;
+
+template<>
+struct TQuantizerMaskShape<EQuantizerMaskShape::Connected4>
+{
+	static constexpr int32 Num = 4;
+	static constexpr float OffsetX[Num] = { 1.f, 0.f, -1.f, 0.f };
+	static constexpr float OffsetY[Num] = { 0.f, 1.f, 0.f, -1.f };
+	static constexpr float StepLength[Num] = { 1.f, 1.f, 1.f, 1.f };
+};
+
+template<>
+struct TQuantizerMaskShape<EQuantizerMaskShape::Connected8>
+{
+	static constexpr int32 Num = 8;
+	static constexpr float OffsetX[Num] = { 1.f, 1.f, 0.f, -1.f, -1.f, -1.f, 0.f, 1.f };
+	static constexpr float OffsetY[Num] = { 0.f, 1.f, 1.f, 1.f, 0.f, -1.f, -1.f, -1.f };
+	static constexpr float StepLength[Num] = { 1.f, UE_SQRT_2, 1.f, UE_SQRT_2, 1.f, UE_SQRT_2, 1.f, UE_SQRT_2 };
+};
+
+template<>
+struct TQuantizerMaskShape<EQuantizerMaskShape::Connected16>
+{
+	static constexpr int32 Num = 16;
+	static constexpr float OffsetX[Num] = { 1.f, 1.f, 0.f, -1.f, -1.f, -1.f, 0.f, 1.f, 2.f, 1.f, -1.f, -2.f, -2.f, -1.f, 1.f, 2.f };
+	static constexpr float OffsetY[Num] = { 0.f, 1.f, 1.f, 1.f, 0.f, -1.f, -1.f, -1.f, 1.f, 2.f, 2.f, 1.f, -1.f, -2.f, -2.f, -1.f };
+	static constexpr float StepLength[Num] =
+	{
+		1.f, UE_SQRT_2, 1.f, UE_SQRT_2, 1.f, UE_SQRT_2, 1.f, UE_SQRT_2,
+		2.23606798f, 2.23606798f, 2.23606798f, 2.23606798f, 2.23606798f, 2.23606798f, 2.23606798f, 2.23606798f
+	};
+};
+
+/// <summary>
+/// Evaluates every neighbor of a cell at once. The grid mask is kept as padded float tables so step lengths,
+/// euclidean heuristics and g + h of four neighbors are computed per vector instruction, then the neighbors whose
+/// edges are traversable are compacted into a list
+/// </summary>
+class SPACEQUANTIZATION_API FQuantizerSuccessorKernel
+{
+public:
+
+	static constexpr int32 MaxMaskPoints = FQuantizerEdgeMask::MaxMaskPoints;
+
+	/// <summary>
+	/// Build the offset and step cost tables for a grid mask and pick the specialised loop if the mask is a known shape
+	/// </summary>
+	/// <param name="MaskPoints">Only the first MaxMaskPoints are used</param>
+	/// <param name="InLengthCostWeight"></param>
+	/// <param name="Kernel"></param>
+	void Init(const TArray<FIntVector2>& MaskPoints, float InLengthCostWeight, EQuantizerSuccessorKernel Kernel = EQuantizerSuccessorKernel::Specialized);
+
+	FORCEINLINE int32 Num() const
+	{
+		return NumMaskPoints;
+	}
+
+	//One bit for every mask point
+	FORCEINLINE uint32 GetValidBits() const
+	{
+		return ValidBits;
+	}
+
+	FORCEINLINE EQuantizerMaskShape GetShape() const
+	{
+		return Shape;
+	}
+
+	/// <summary>
+	/// Shape of a grid mask, in any order
+	/// </summary>
+	/// <param name="MaskPoints"></param>
+	/// <param name="OutShapeToMask">Room for MaxMaskPoints entries, gets the mask index of every offset of the shape. Not meaningful for Generic</param>
+	static EQuantizerMaskShape DetectShape(const TArray<FIntVector2>& MaskPoints, uint8* OutShapeToMask);
+
+	/// <summary>
+	/// Cost every traversable neighbor of a cell, all in grid units
+	/// </summary>
+	/// <param name="Cell">Cell being expanded</param>
+	/// <param name="DistanceFromStart">g of the expanded cell</param>
+	/// <param name="Edges">Traversable edges of the cell from FQuantizerEdgeMask</param>
+	/// <param name="Goal">Cell the heuristic measures to</param>
+	/// <param name="OutSuccessors">Room for MaxMaskPoints entries, filled in mask order or in shape order for known shapes</param>
+	/// <returns>Number of successors written</returns>
+	FORCEINLINE int32 Evaluate(const FIntVector2& Cell, float DistanceFromStart, uint32 Edges, const FIntVector2& Goal, FQuantizerSuccessor* OutSuccessors) const
+	{
+		//Same for the whole search so the branch is always predicted
+		switch (Shape)
+		{
+		case EQuantizerMaskShape::Connected4:
+			return EvaluateShape<EQuantizerMaskShape::Connected4>(Cell, DistanceFromStart, Edges, Goal, OutSuccessors);
+		case EQuantizerMaskShape::Connected8:
+			return EvaluateShape<EQuantizerMaskShape::Connected8>(Cell, DistanceFromStart, Edges, Goal, OutSuccessors);
+		case EQuantizerMaskShape::Connected16:
+			return EvaluateShape<EQuantizerMaskShape::Connected16>(Cell, DistanceFromStart, Edges, Goal, OutSuccessors);
+		default:
+			return EvaluateGeneric(Cell, DistanceFromStart, Edges, Goal, OutSuccessors);
+		}
+	}
+
+private:
+
+	/// <summary>
+	/// Evaluate with the offsets and step lengths of a known shape, the first loop has no branches and a constant trip
+	/// count so the compiler unrolls and vectorises it
+	/// </summary>
+	template<EQuantizerMaskShape KnownShape>
+	FORCEINLINE int32 EvaluateShape(const FIntVector2& Cell, float DistanceFromStart, uint32 Edges, const FIntVector2& Goal, FQuantizerSuccessor* OutSuccessors) const
+	{
+		using FShape = TQuantizerMaskShape<KnownShape>;
+
+		float NextDistanceFromStart[FShape::Num];
+		float NextCost[FShape::Num];
+
+		const float ToGoalX = (float)(Cell.X - Goal.X);
+		const float ToGoalY = (float)(Cell.Y - Goal.Y);
+
+		for (int32 i = 0; i < FShape::Num; i++)
+		{
+			const float DeltaX = ToGoalX + FShape::OffsetX[i];
+			const float DeltaY = ToGoalY + FShape::OffsetY[i];
+
+			NextDistanceFromStart[i] = DistanceFromStart + FShape::StepLength[i] * LengthCostWeight;
+			NextCost[i] = NextDistanceFromStart[i] + FMath::Sqrt(DeltaX * DeltaX + DeltaY * DeltaY) * LengthCostWeight;
+		}
+
+		//Always write and only advance for traversable edges, OutSuccessors has room for every lane
+		int32 NumSuccessors = 0;
+
+		for (int32 i = 0; i < FShape::Num; i++)
+		{
+			const uint32 MaskIndex = ShapeToMask[i];
+
+			OutSuccessors[NumSuccessors].MaskIndex = (int32)MaskIndex;
+			OutSuccessors[NumSuccessors].DistanceFromStart = NextDistanceFromStart[i];
+			OutSuccessors[NumSuccessors].Cost = NextCost[i];
+			NumSuccessors += (int32)((Edges >> MaskIndex) & 1u);
+		}
+
+		return NumSuccessors;
+	}
+
+	/// <summary>
+	/// Evaluate with the tables built from an arbitrary mask, with vector instructions unless bScalar is set
+	/// </summary>
+	FORCEINLINE int32 EvaluateGeneric(const FIntVector2& Cell, float DistanceFromStart, uint32 Edges, const FIntVector2& Goal, FQuantizerSuccessor* OutSuccessors) const
+	{
+		float NextDistanceFromStart[MaxMaskPoints];
+		float NextCost[MaxMaskPoints];
+
+		//Subtract in integers first so the float math stays exact on large grids
+		const float ToGoalX = (float)(Cell.X - Goal.X);
+		const float ToGoalY = (float)(Cell.Y - Goal.Y);
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS
+		if (!bScalar)
+		{
+			const VectorRegister4Float VecToGoalX = VectorSetFloat1(ToGoalX);
+			const VectorRegister4Float VecToGoalY = VectorSetFloat1(ToGoalY);
+			const VectorRegister4Float VecDistanceFromStart = VectorSetFloat1(DistanceFromStart);
+			const VectorRegister4Float VecWeight = VectorSetFloat1(LengthCostWeight);
+
+			for (int32 Block = 0; Block < NumPadded; Block += 4)
+			{
+				//No traversable edges in these four lanes
+				if (((Edges >> Block) & 0xF) == 0)
+				{
+					continue;
+				}
+
+				const VectorRegister4Float DeltaX = VectorAdd(VecToGoalX, VectorLoad(&OffsetX[Block]));
+				const VectorRegister4Float DeltaY = VectorAdd(VecToGoalY, VectorLoad(&OffsetY[Block]));
+
+				//h = |goal - next| * weight
+				const VectorRegister4Float Heuristic = VectorMultiply(VectorSqrt(VectorMultiplyAdd(DeltaX, DeltaX, VectorMultiply(DeltaY, DeltaY))), VecWeight);
+
+				//g = g of current + |offset| * weight
+				const VectorRegister4Float Distance = VectorAdd(VecDistanceFromStart, VectorLoad(&StepCost[Block]));
+
+				VectorStore(Distance, &NextDistanceFromStart[Block]);
+				VectorStore(VectorAdd(Distance, Heuristic), &NextCost[Block]);
+			}
+		}
+		else
+#endif
+		{
+			for (int32 i = 0; i < NumMaskPoints; i++)
+			{
+				if (!(Edges & (1u << i)))
+				{
+					continue;
+				}
+
+				const float DeltaX = ToGoalX + OffsetX[i];
+				const float DeltaY = ToGoalY + OffsetY[i];
+
+				NextDistanceFromStart[i] = DistanceFromStart + StepCost[i];
+				NextCost[i] = NextDistanceFromStart[i] + FMath::Sqrt(DeltaX * DeltaX + DeltaY * DeltaY) * LengthCostWeight;
+			}
+		}
+
+		//Compact the accepted lanes, one iteration per set bit
+		int32 NumSuccessors = 0;
+
+		for (uint32 Remaining = Edges & ValidBits; Remaining != 0; Remaining &= Remaining - 1)
+		{
+			const int32 i = (int32)FMath::CountTrailingZeros(Remaining);
+
+			OutSuccessors[NumSuccessors].MaskIndex = i;
+			OutSuccessors[NumSuccessors].DistanceFromStart = NextDistanceFromStart[i];
+			OutSuccessors[NumSuccessors].Cost = NextCost[i];
+			NumSuccessors++;
+		}
+
+		return NumSuccessors;
+	}
+
+	EQuantizerMaskShape Shape = EQuantizerMaskShape::Generic;
+
+	//Generic masks are evaluated one neighbor at a time, set by EQuantizerSuccessorKernel::Scalar
+	bool bScalar = false;
+
+	//Mask index of every offset of Shape, masks list their points in any order
+	uint8 ShapeToMask[MaxMaskPoints];
+
+	int32 NumMaskPoints = 0;
+
+	//NumMaskPoints rounded up to a whole number of vectors, padding lanes have zero offsets
+	int32 NumPadded = 0;
+
+	//Bits of the mask points that exist
+	uint32 ValidBits = 0;
+
+	float LengthCostWeight = 1.f;
+
+	//Mask offsets in cells
+	float OffsetX[MaxMaskPoints];
+	float OffsetY[MaxMaskPoints];
+
+	//Length of every offset in cells times LengthCostWeight
+	float StepCost[MaxMaskPoints];
+};
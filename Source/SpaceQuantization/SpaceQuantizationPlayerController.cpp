@@ -111,6 +111,12 @@ void ASpaceQuantizationPlayerController::OnSetDestinationTriggered()
 	{
 		DestinationMarker->SetActorLocation(CachedDestination);
 	}
+
+	//Incremental search only repairs what the move changed, cheap enough to run every frame
+	if (bRepathWhileDragging && Quantizer)
+	{
+		Quantizer->ComputePath(CachedSource, CachedDestination);
+	}
 }
 
 void ASpaceQuantizationPlayerController::OnSetDestinationReleased()
@@ -146,6 +152,11 @@ void ASpaceQuantizationPlayerController::OnSetSourceTriggered()
 	{
 		SourceMarker->SetActorLocation(CachedSource);
 	}
+
+	if (bRepathWhileDragging && Quantizer)
+	{
+		Quantizer->ComputePath(CachedSource, CachedDestination);
+	}
 }
 
 
@@ -180,7 +191,6 @@ bool ASpaceQuantizationPlayerController::ComputePath()
 		return false;
 	}
 
-	Quantizer->ComputePath(CachedSource, CachedDestination);
-
-	return true;
+	//Search runs on a worker thread, the Quantizer draws the path once it finishes
+	return Quantizer->ComputePathAsync(CachedSource, CachedDestination).IsValid();
 }
@@ -43,6 +43,10 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Input, meta = (AllowPrivateAccess = "true"))
 	class AQuantizer* Quantizer;
 
+	//Recompute the path every frame while a marker is dragged, meant for the Quantizer's Incremental search mode
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Input)
+	bool bRepathWhileDragging = false;
+
 	//Used to mark position and destination of path
 	AActor* SourceMarker;
 	AActor* DestinationMarker;